@@ -0,0 +1,142 @@
+/**
+ * @file    bench.h
+ * @author  qufeiyan
+ * @brief   Common helpers of the benchmarks, results are printed as a table and appended
+ *          as JSON lines to the file named by $BENCH_RESULTS.
+ * @version 1.0.0
+ * @date    2026/10/18 18:05:33
+ * @version Copyright (c) 2023
+ */
+
+/* Define to prevent recursive inclusion ---------------------------------------------------*/
+#ifndef __QLOG_BENCH_H
+#define __QLOG_BENCH_H
+/* Include ---------------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static inline uint64_t bench_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int bench_compare(const void *a, const void *b){
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief   open the file of machine-readable results.
+ * @return  NULL if $BENCH_RESULTS is not set.
+ */
+static FILE *bench_results(void){
+    static FILE *file;
+    static int opened;
+    const char *path;
+
+    if(!opened){
+        opened = 1;
+        path = getenv("BENCH_RESULTS");
+        file = (path && *path) ? fopen(path, "a") : NULL;
+    }
+    return file;
+}
+
+/**
+ * @brief   print the common fields of a result.
+ * @param   bench is the name of the benchmark program.
+ * @param   config is the configuration of the case, "key=value" separated by spaces.
+ */
+static void bench_record(FILE *file, const char *bench, const char *config){
+    const char *revision = getenv("BENCH_REVISION");
+
+    fprintf(file, "{\"bench\":\"%s\",\"config\":\"%s\"", bench, config);
+    if(revision && *revision){
+        fprintf(file, ",\"revision\":\"%s\"", revision);
+    }
+}
+
+/**
+ * @brief   print the header of the latency table.
+ */
+static inline void bench_header(void){
+    printf("%-44s %7s %12s %8s %8s %8s %10s\n",
+        "config", "threads", "msgs/s", "p50(ns)", "p99(ns)", "p999(ns)", "max(ns)");
+}
+
+/**
+ * @brief   report the throughput and the caller-side latency of a case.
+ * @param   bench is the name of the benchmark program.
+ * @param   config is the configuration of the case.
+ * @param   threads is the number of producer threads.
+ * @param   latency is the latency of each message in ns, it is sorted.
+ * @param   total is the number of messages.
+ * @param   elapsed is the wall time of the case in ns.
+ */
+static inline void bench_latency(const char *bench, const char *config, int threads,
+                                 uint64_t *latency, size_t total, uint64_t elapsed){
+    double rate;
+    uint64_t p50, p99, p999, max;
+    FILE *file;
+
+    qsort(latency, total, sizeof(*latency), bench_compare);
+    rate = total * 1e9 / elapsed;
+    p50 = latency[total / 2];
+    p99 = latency[total * 99 / 100];
+    p999 = latency[total * 999 / 1000];
+    max = latency[total - 1];
+
+    printf("%-44s %7d %12.0f %8lu %8lu %8lu %10lu\n", config, threads, rate, p50, p99, p999, max);
+    fflush(stdout);
+
+    if((file = bench_results()) != NULL){
+        bench_record(file, bench, config);
+        fprintf(file, ",\"threads\":%d,\"messages\":%zu,\"msgs_per_sec\":%.0f,"
+            "\"p50_ns\":%lu,\"p99_ns\":%lu,\"p999_ns\":%lu,\"max_ns\":%lu}\n",
+            threads, total, rate, p50, p99, p999, max);
+        fflush(file);
+    }
+}
+
+/**
+ * @brief   report the average cost of an operation.
+ * @param   bench is the name of the benchmark program.
+ * @param   config is the configuration of the case.
+ * @param   nsPerOp is the average cost in ns.
+ */
+static inline void bench_cost(const char *bench, const char *config, double nsPerOp){
+    FILE *file;
+
+    printf("%-44s %8.2f ns/op\n", config, nsPerOp);
+    fflush(stdout);
+
+    if((file = bench_results()) != NULL){
+        bench_record(file, bench, config);
+        fprintf(file, ",\"ns_per_op\":%.2f}\n", nsPerOp);
+        fflush(file);
+    }
+}
+
+/**
+ * @brief   report the average size written per log.
+ * @param   bench is the name of the benchmark program.
+ * @param   config is the configuration of the case.
+ * @param   bytesPerLog is the average size in bytes.
+ */
+static inline void bench_size(const char *bench, const char *config, double bytesPerLog){
+    FILE *file;
+
+    printf("%-44s %8.2f bytes/log\n", config, bytesPerLog);
+    fflush(stdout);
+
+    if((file = bench_results()) != NULL){
+        bench_record(file, bench, config);
+        fprintf(file, ",\"bytes_per_log\":%.2f}\n", bytesPerLog);
+        fflush(file);
+    }
+}
+
+#endif	//  __QLOG_BENCH_H
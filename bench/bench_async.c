@@ -0,0 +1,87 @@
+/**
+ * @file    bench_async.c
+ * @author  qufeiyan
+ * @brief   Compare the caller-side latency of synchronous, asynchronous and deferred output.
+ * @version 1.0.0
+ * @date    2026/10/18 10:02:51
+ * @version Copyright (c) 2023
+ */
+
+#include "bench.h"
+#include "qlog_api.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TAG_NAME "bench"
+
+#define COUNT_OF_MESSAGE    (20000)     //! messages per thread.
+#define COUNT_OF_RECORD     (4096)      //! records in the ring of each thread.
+
+static const int threads[] = {1, 2, 4, 8};
+
+static void *producer(void *args){
+    uint64_t *latency = (uint64_t *)args;
+    uint64_t start;
+    int i;
+
+    for(i = 0; i < COUNT_OF_MESSAGE; ++i){
+        start = bench_now();
+        logi("message %d of the benchmark, value %f\n", i, i * 0.5);
+        latency[i] = bench_now() - start;
+    }
+    return NULL;
+}
+
+static void run(const char *mode, int count){
+    pthread_t tid[count];
+    char name[32];
+    uint64_t *latency;
+    uint64_t start, elapsed;
+    size_t total;
+    int i;
+
+    total = (size_t)count * COUNT_OF_MESSAGE;
+    latency = malloc(total * sizeof(*latency));
+
+    start = bench_now();
+    for(i = 0; i < count; ++i){
+        pthread_create(&tid[i], NULL, producer, latency + (size_t)i * COUNT_OF_MESSAGE);
+    }
+    for(i = 0; i < count; ++i){
+        pthread_join(tid[i], NULL);
+    }
+    elapsed = bench_now() - start;
+
+    snprintf(name, sizeof(name), "mode=%s writer=file", mode);
+    bench_latency("bench_async", name, count, latency, total, elapsed);
+    free(latency);
+}
+
+int main(void){
+    size_t i;
+
+    qlog_init(LOG_LEVEL_DEBUG, false, true, 1);
+    qlog_registerFileWriter("bench", "./bench_logs", 4, 1 << 20);
+    qlog_setConsoleWriter(false);
+    qlog_setFileWriter(true);
+
+    bench_header();
+    for(i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i){
+        run("sync", threads[i]);
+    }
+
+    qlog_startAsync(COUNT_OF_RECORD);
+    for(i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i){
+        run("async", threads[i]);
+    }
+
+    qlog_setDeferred(true);
+    for(i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i){
+        run("defer", threads[i]);
+    }
+    qlog_stopAsync();
+    return 0;
+}
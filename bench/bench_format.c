@@ -0,0 +1,68 @@
+/**
+ * @file    bench_format.c
+ * @author  qufeiyan
+ * @brief   Measure the cost of formatting a log with different timestamp and layout settings.
+ * @version 1.0.0
+ * @date    2026/10/18 14:05:10
+ * @version Copyright (c) 2023
+ */
+
+#include "bench.h"
+#include "qlog_api.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define TAG_NAME "bench"
+
+#define COUNT_OF_LOOP   (2000000)
+
+static void run(const char *name){
+    char config[64];
+    uint64_t start = bench_now();
+    for(int i = 0; i < COUNT_OF_LOOP; ++i){
+        logi("message %d of the benchmark\n", i);
+    }
+    snprintf(config, sizeof(config), "case=%s", name);
+    bench_cost("bench_format", config, (double)(bench_now() - start) / COUNT_OF_LOOP);
+}
+
+int main(void){
+    static const struct{
+        const char *name;
+        log_clock_t clock;
+        log_precision_t precision;
+    } clocks[] = {
+        {"realtime ms",         LOG_CLOCK_REALTIME,         LOG_PRECISION_MS},
+        {"realtime ns",         LOG_CLOCK_REALTIME,         LOG_PRECISION_NS},
+        {"realtime coarse ms",  LOG_CLOCK_REALTIME_COARSE,  LOG_PRECISION_MS},
+        {"monotonic us",        LOG_CLOCK_MONOTONIC,        LOG_PRECISION_US},
+        {"tsc us",              LOG_CLOCK_TSC,              LOG_PRECISION_US},
+    };
+
+    static const char * const layouts[] = {
+        "%d %L/%T: %m",
+        "%d %l %T [%t] %m",
+        "%d %l %T [%t:%N] %m",
+        "%d %p/%t #%n cpu%c %L/%T: %m",
+    };
+
+    //! no writer is enabled, so only filter and formatter are measured.
+    qlog_init(LOG_LEVEL_DEBUG, false, false, 1);
+    qlog_setConsoleWriter(false);
+    run("no timestamp");
+
+    qlog_init(LOG_LEVEL_DEBUG, false, true, 1);
+    qlog_setConsoleWriter(false);
+    for(size_t i = 0; i < sizeof(clocks) / sizeof(clocks[0]); ++i){
+        qlog_setClock(clocks[i].clock, clocks[i].precision);
+        run(clocks[i].name);
+    }
+
+    qlog_setClock(LOG_CLOCK_REALTIME, LOG_PRECISION_MS);
+    for(size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); ++i){
+        qlog_setLayout(layouts[i]);
+        run(layouts[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+/**
+ * @file    bench_level.c
+ * @author  qufeiyan
+ * @brief   Measure the cost of disabled log statements, of tag filtering, and of logs
+ *          suppressed by the rate limits or as repeats.
+ * @version 1.0.0
+ * @date    2026/10/18 12:21:35
+ * @version Copyright (c) 2023
+ */
+
+#include "bench.h"
+#include "qlog_api.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TAG_NAME "bench"
+
+#define COUNT_OF_LOOP   (100000000)
+#define COUNT_OF_STORM  (10000000)  //! logs of a storm, each is suppressed after the first.
+
+static int evaluated;   //! how many times the arguments are evaluated.
+
+static int argument(void){
+    return ++evaluated;
+}
+
+static void report(const char *name, uint64_t start, int count){
+    char config[64];
+    double cost = (double)(bench_now() - start) / count;
+
+    snprintf(config, sizeof(config), "case=%s evaluated=%d", name, evaluated);
+    bench_cost("bench_level", config, cost);
+    evaluated = 0;
+}
+
+static void direct(void){
+    uint64_t start = bench_now();
+    for(int i = 0; i < COUNT_OF_LOOP; ++i){
+        qlog(TAG_NAME, LOG_LEVEL_DEBUG, "value %d\n", argument());
+    }
+    report("qlog() disabled", start, COUNT_OF_LOOP);
+}
+
+static void cached(void){
+    uint64_t start = bench_now();
+    for(int i = 0; i < COUNT_OF_LOOP; ++i){
+        logd("value %d\n", argument());
+        __asm__ volatile("" ::: "memory");
+    }
+    report("logd() disabled", start, COUNT_OF_LOOP);
+}
+
+static void instance(logger_t *logger){
+    uint64_t start = bench_now();
+    for(int i = 0; i < COUNT_OF_LOOP; ++i){
+        logd_ex(logger, "value %d\n", argument());
+        __asm__ volatile("" ::: "memory");
+    }
+    report("logd_ex() disabled", start, COUNT_OF_LOOP);
+}
+
+static void filtered(const char *tag, int numberOfTags){
+    char name[32];
+    uint64_t start = bench_now();
+    for(int i = 0; i < COUNT_OF_LOOP; ++i){
+        qlog_info(tag, "value %d\n", argument());
+    }
+    snprintf(name, sizeof(name), "tag filtered tags=%d", numberOfTags);
+    report(name, start, COUNT_OF_LOOP);
+}
+
+static void storm(const char *name){
+    uint64_t start = bench_now();
+    for(int i = 0; i < COUNT_OF_STORM; ++i){
+        qlog_err("storm", "peer %s down, error %d\n", "10.0.0.1", argument() > 0);
+    }
+    report(name, start, COUNT_OF_STORM);
+}
+
+static void toggled(void){
+    qlog_info("site", "toggled %d\n", argument());
+}
+
+/**
+ * @brief   check that the callsite of {@code toggled} is listed, and that turning it off
+ *          by its location skips its arguments, then turning it on again logs it.
+ * @return  true if the callsite behaves so.
+ */
+static bool callsites(void){
+    const qlog_site_t *sites, *site = NULL;
+    size_t count;
+    int off, on;
+
+    sites = qlog_callsites(&count);
+    for(size_t i = 0; i < count; ++i){
+        if(strcmp(sites[i].format, "toggled %d\n") == 0){
+            site = &sites[i];
+        }
+    }
+    if(site == NULL || qlog_callsiteId(site) == 0 || strcmp(site->function, "toggled") != 0){
+        fprintf(stderr, "callsite of toggled() is not listed among %zu\n", count);
+        return false;
+    }
+
+    evaluated = 0;
+    if(qlog_setCallsite("bench_level.c", site->line, false) != 1){
+        fprintf(stderr, "callsite %s:%u is not matched\n", site->file, site->line);
+        return false;
+    }
+    toggled();
+    off = evaluated;
+    qlog_setCallsite("bench_level.c", site->line, true);
+    toggled();
+    on = evaluated - off;
+    evaluated = 0;
+
+    printf("callsites=%zu off evaluated=%d on evaluated=%d\n", count, off, on);
+    return off == 0 && on == 1;
+}
+
+static void tagged(const char *tag){
+    qlog_dbg(tag, "tagged %d\n", argument());
+}
+
+/**
+ * @brief   check that a callsite whose tag is not constant lets a log pass by the level of
+ *          its tag, more verbose than the global level, and filters the other tags.
+ * @param   tag is a tag given {@code LOG_LEVEL_DEBUG}, the global level is less verbose.
+ * @return  true if only the log of {@code tag} is accepted.
+ */
+static bool runtimeTag(const char *tag){
+    char other[] = "runtime";
+    log_stats_t stats[3];
+
+    qlog_stats(&stats[0]);
+    tagged(tag);
+    qlog_stats(&stats[1]);
+    tagged(other);
+    qlog_stats(&stats[2]);
+
+    printf("runtime tag accepted=%llu other accepted=%llu\n",
+        (unsigned long long)(stats[1].accepted - stats[0].accepted),
+        (unsigned long long)(stats[2].accepted - stats[1].accepted));
+    evaluated = 0;
+    return stats[1].accepted - stats[0].accepted == 1 && stats[2].accepted == stats[1].accepted;
+}
+
+#undef QLOG_MIN_LEVEL
+#define QLOG_MIN_LEVEL LOG_LEVEL_INFO
+
+static void stripped(void){
+    uint64_t start = bench_now();
+    for(int i = 0; i < COUNT_OF_LOOP; ++i){
+        logd("value %d\n", argument());
+        __asm__ volatile("" ::: "memory");
+    }
+    report("logd() compiled out", start, COUNT_OF_LOOP);
+}
+
+int main(void){
+    logger_t *logger;
+
+    qlog_init(LOG_LEVEL_INFO, false, true, 31);
+    qlog_setConsoleWriter(false);
+
+    if(!callsites()){
+        return 1;
+    }
+
+    direct();
+    cached();
+    stripped();
+
+    logger = qlog_create(LOG_LEVEL_INFO, false, true, 1);
+    qlog_setConsoleWriter_ex(logger, false);
+    instance(logger);
+    qlog_destroy(logger);
+
+    //! one log of the storm is output at most, the console is disabled anyway.
+    qlog_limit("storm", 1, 1);
+    storm("rate limited");
+    qlog_limit("storm", 0, 0);
+    qlog_setRepeatSuppression(true);
+    storm("repeat suppressed");
+    qlog_setRepeatSuppression(false);
+
+    //! the tag is not constant, so it is filtered for every log.
+    char tag[] = "runtime";
+    char name[16];
+    qlog_filter("tag0", LOG_LEVEL_DEBUG);
+    snprintf(name, sizeof(name), "tag0");
+    if(!runtimeTag(name)){
+        return 1;
+    }
+    filtered(tag, 1);
+    for(int i = 1; i < 31; ++i){
+        snprintf(name, sizeof(name), "tag%d", i);
+        qlog_filter(name, LOG_LEVEL_DEBUG);
+    }
+    filtered(tag, 31);
+    return 0;
+}
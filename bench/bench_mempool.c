@@ -0,0 +1,148 @@
+/**
+ * @file    bench_mempool.c
+ * @author  qufeiyan
+ * @brief   Measure the cost of taking and giving back a block of the memory pool from
+ *          several threads at once, with and without the magazines of threads, and check
+ *          that no block is handed out twice or lost, with the pool exhausted as well.
+ * @version 1.0.0
+ * @date    2026/10/18 23:12:40
+ * @version Copyright (c) 2023
+ */
+
+#include "bench.h"
+#include "mempool.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define COUNT_OF_LOOP       (2000000)
+#define COUNT_OF_BLOCK      (4096)
+#define SIZE_OF_BLOCK       (256)
+#define COUNT_OF_BURST      (4)         //! blocks a thread holds at once.
+
+#define COUNT_OF_STRESS_THREAD  (16)
+#define COUNT_OF_STRESS_LOOP    (20000)
+#define COUNT_OF_STRESS_BLOCK   (256)   //! fewer than the threads hold at most, so it runs out.
+#define COUNT_OF_STRESS_BURST   (64)
+
+static memoryPool_t pool;
+static uint8_t region[MEMORY_POOL_SIZE(COUNT_OF_BLOCK, SIZE_OF_BLOCK)] __attribute__((aligned(8)));
+
+static void *worker(void *args){
+    void *blocks[COUNT_OF_BURST];
+    (void)args;
+
+    for(int i = 0; i < COUNT_OF_LOOP / COUNT_OF_BURST; ++i){
+        for(int j = 0; j < COUNT_OF_BURST; ++j){
+            blocks[j] = memoryPoolAlloc(&pool);
+        }
+        for(int j = 0; j < COUNT_OF_BURST; ++j){
+            if(blocks[j] != NULL){
+                memoryPoolFree(&pool, blocks[j]);
+            }
+        }
+    }
+    return NULL;
+}
+
+static memoryPool_t stressPool;
+static uint64_t stressRegion[MEMORY_POOL_SIZE(COUNT_OF_STRESS_BLOCK, SIZE_OF_BLOCK) / sizeof(uint64_t)];
+static uint64_t stressErrors;
+static pthread_barrier_t stressStart;  //! the threads start at once, so their bursts overlap.
+
+/**
+ * @brief   take and give back bursts of blocks, each block is stamped by its owner and
+ *          checked before it is given back, so a block handed out twice is caught.
+ * @param   args is the id of the thread.
+ */
+static void *stressWorker(void *args){
+    uint64_t *blocks[COUNT_OF_STRESS_BURST];
+    uint64_t id = (uintptr_t)args, stamp;
+    int count;
+
+    pthread_barrier_wait(&stressStart);
+    for(int i = 0; i < COUNT_OF_STRESS_LOOP; ++i){
+        //! the bursts vary, so the magazines fill and drain at different times.
+        count = 1 + (i * 7 + (int)id) % COUNT_OF_STRESS_BURST;
+        for(int j = 0; j < count; ++j){
+            blocks[j] = (uint64_t *)memoryPoolAlloc(&stressPool);
+            if(blocks[j] != NULL){
+                stamp = id << 48 | (uint64_t)i << 8 | j;
+                blocks[j][0] = stamp;
+                blocks[j][SIZE_OF_BLOCK / sizeof(uint64_t) - 1] = stamp;
+            }
+        }
+        for(int j = 0; j < count; ++j){
+            if(blocks[j] == NULL){
+                continue;
+            }
+            stamp = id << 48 | (uint64_t)i << 8 | j;
+            if(blocks[j][0] != stamp || blocks[j][SIZE_OF_BLOCK / sizeof(uint64_t) - 1] != stamp){
+                __atomic_fetch_add(&stressErrors, 1, __ATOMIC_RELAXED);
+            }
+            memoryPoolFree(&stressPool, blocks[j]);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief   run the threads of the stress check against a pool they exhaust.
+ * @return  false if a block is handed out twice, or not given back once the threads exit.
+ */
+static bool stress(void){
+    pthread_t tid[COUNT_OF_STRESS_THREAD];
+    memoryPoolStats_t stats;
+
+    memoryPoolInit(&stressPool, "stress", COUNT_OF_STRESS_BLOCK, SIZE_OF_BLOCK, stressRegion);
+    pthread_barrier_init(&stressStart, NULL, COUNT_OF_STRESS_THREAD);
+    for(uintptr_t i = 0; i < COUNT_OF_STRESS_THREAD; ++i){
+        pthread_create(&tid[i], NULL, stressWorker, (void *)i);
+    }
+    for(int i = 0; i < COUNT_OF_STRESS_THREAD; ++i){
+        pthread_join(tid[i], NULL);
+    }
+    pthread_barrier_destroy(&stressStart);
+
+    //! the magazines of the threads are given back as they exit.
+    memoryPoolStats(&stressPool, &stats);
+    printf("%-44s used=%zu highWater=%zu/%zu failures=%llu errors=%llu\n", "stress threads=16",
+        stats.used, stats.highWater, stats.total, (unsigned long long)stats.failures,
+        (unsigned long long)stressErrors);
+    return stressErrors == 0 && stats.used == 0 && stats.failures > 0;
+}
+
+static void run(int threads, bool magazine){
+    pthread_t tid[threads];
+    char config[64];
+    uint64_t start;
+
+    memoryPoolInit(&pool, "bench", COUNT_OF_BLOCK, SIZE_OF_BLOCK, region);
+    if(!magazine){
+        pool.magazine = 0;
+    }
+
+    start = bench_now();
+    for(int i = 0; i < threads; ++i){
+        pthread_create(&tid[i], NULL, worker, NULL);
+    }
+    for(int i = 0; i < threads; ++i){
+        pthread_join(tid[i], NULL);
+    }
+
+    //! a pair of alloc and free per op, each thread runs COUNT_OF_LOOP ops concurrently.
+    snprintf(config, sizeof(config), "threads=%d magazine=%d", threads, magazine);
+    bench_cost("bench_mempool", config, (double)(bench_now() - start) / COUNT_OF_LOOP);
+}
+
+int main(void){
+    static const int threads[] = { 1, 2, 4, 8 };
+
+    for(size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i){
+        run(threads[i], false);
+        run(threads[i], true);
+    }
+    return stress() ? 0 : 1;
+}
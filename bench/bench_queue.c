@@ -0,0 +1,102 @@
+/**
+ * @file    bench_queue.c
+ * @author  qufeiyan
+ * @brief   Measure the caller-side latency with a slow writer in the chain, written inline
+ *          or behind a queue with each policy, and the logs each policy drops.
+ * @version 1.0.0
+ * @date    2026/10/18 22:05:37
+ * @version Copyright (c) 2023
+ */
+
+#include "bench.h"
+#include "qlog.h"
+#include "qlog_api.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TAG_NAME "bench"
+
+#define COUNT_OF_MESSAGE    (20000)
+#define SLOW_WRITE_NS       (20000)     //! time a log takes on the slow writer, e.g. a serial console.
+#define SIZE_OF_QUEUE       (64 * 1024)
+
+/**
+ * @brief   a writer spinning for {@code SLOW_WRITE_NS} per log.
+ */
+static void slowWrite(writer_t *writer){
+    uint64_t deadline;
+
+    if(writer->enable && writer->length > 0){
+        deadline = bench_now() + SLOW_WRITE_NS;
+        while(bench_now() < deadline);
+        statsAdd(&writer->stats.records, 1);
+    }
+
+    writer_t *nextWriter = writer->next;
+    if(nextWriter){
+        nextWriter->length = writer->length;
+        nextWriter->color = writer->color;
+        nextWriter->level = writer->level;
+        nextWriter->record = writer->record;
+        nextWriter->write(nextWriter);
+    }
+}
+
+static void run(const char *config, int policy){
+    static uint64_t latency[COUNT_OF_MESSAGE];
+    writer_t *slow;
+    logger_t *logger;
+    log_stats_t stats;
+    char name[48];
+    uint64_t start, elapsed;
+    int i;
+
+    logger = qlog_create(LOG_LEVEL_DEBUG, false, true, 1);
+    qlog_setConsoleWriter_ex(logger, false);
+    slow = (writer_t *)calloc(1, sizeof(writer_t));
+    strcpy(slow->name, "slow");
+    slow->buffer = logger->buffer;
+    slow->enable = true;
+    slow->write = slowWrite;
+    qlog_registerWriter_ex(logger, slow);
+    if(policy >= 0){
+        qlog_setWriterQueue_ex(logger, "slow", SIZE_OF_QUEUE, (log_queue_policy_t)policy, LOG_LEVEL_WARNING);
+    }
+
+    start = bench_now();
+    for(i = 0; i < COUNT_OF_MESSAGE; ++i){
+        latency[i] = bench_now();
+        if(i % 16 == 0){
+            logw_ex(logger, "message %d of the benchmark, value %f\n", i, i * 0.5);
+        }else{
+            logi_ex(logger, "message %d of the benchmark, value %f\n", i, i * 0.5);
+        }
+        latency[i] = bench_now() - latency[i];
+    }
+    elapsed = bench_now() - start;
+
+    snprintf(name, sizeof(name), "queue=%s", config);
+    bench_latency("bench_queue", name, 1, latency, COUNT_OF_MESSAGE, elapsed);
+
+    qlog_stats_ex(logger, &stats);
+    for(i = 0; i < (int)stats.numberOfWriters; ++i){
+        if(strcmp(stats.writers[i].name, "slow") == 0){
+            printf("  dropped %llu of %d\n", (unsigned long long)stats.writers[i].dropped, COUNT_OF_MESSAGE);
+        }
+    }
+    qlog_destroy(logger);
+    free(slow);
+}
+
+int main(void){
+    bench_header();
+    run("none", -1);
+    run("block", LOG_QUEUE_BLOCK);
+    run("drop_newest", LOG_QUEUE_DROP_NEWEST);
+    run("drop_oldest", LOG_QUEUE_DROP_OLDEST);
+    run("drop_below_warning", LOG_QUEUE_DROP_BELOW_LEVEL);
+    return 0;
+}
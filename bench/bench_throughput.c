@@ -0,0 +1,154 @@
+/**
+ * @file    bench_throughput.c
+ * @author  qufeiyan
+ * @brief   Measure the throughput and the caller-side latency across threads, writers,
+ *          color, timestamp and message sizes.
+ * @version 1.0.0
+ * @date    2026/10/18 18:20:16
+ * @version Copyright (c) 2023
+ */
+
+#include "bench.h"
+#include "qlog_api.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define TAG_NAME "bench"
+
+#define COUNT_OF_MESSAGE    (20000)     //! messages per thread.
+#define SIZE_OF_MESSAGE     (480)       //! maximum size of message body.
+
+enum writerType{
+    WRITER_NULL,                //! no writer is enabled, filter, formatter and lock only.
+    WRITER_CONSOLE,             //! console writer, stdout is redirected to /dev/null.
+    WRITER_FILE,                //! file writer.
+};
+
+static const char * const writers[] = {"null", "console", "file"};
+
+struct config{
+    enum writerType writer;
+    bool color;
+    bool timestamp;
+    int size;                   //! size of message body.
+    int threads;
+};
+
+static char payload[SIZE_OF_MESSAGE + 1];
+
+struct producer{
+    const struct config *config;
+    uint64_t *latency;
+};
+
+static void *producer(void *args){
+    struct producer *producer = (struct producer *)args;
+    int size = producer->config->size;
+    uint64_t start;
+
+    for(int i = 0; i < COUNT_OF_MESSAGE; ++i){
+        start = bench_now();
+        logi("%.*s\n", size, payload);
+        producer->latency[i] = bench_now() - start;
+    }
+    return NULL;
+}
+
+/**
+ * @brief   run a case in a child process, so every case starts from a fresh logger.
+ */
+static void run(const struct config *config){
+    struct producer producers[config->threads];
+    pthread_t tid[config->threads];
+    char name[64];
+    uint64_t *latency, start, elapsed;
+    size_t total;
+    int out = -1, status;
+    pid_t pid;
+
+    fflush(stdout);
+    pid = fork();
+    if(pid != 0){
+        waitpid(pid, &status, 0);
+        return;
+    }
+
+    qlog_init(LOG_LEVEL_DEBUG, config->color, config->timestamp, 1);
+    qlog_setConsoleWriter(config->writer == WRITER_CONSOLE);
+    if(config->writer == WRITER_FILE){
+        qlog_registerFileWriter("throughput", "./bench_logs", 4, 16 << 20);
+        qlog_setFileWriter(true);
+    }
+    if(config->writer == WRITER_CONSOLE){
+        out = dup(STDOUT_FILENO);
+        dup2(open("/dev/null", O_WRONLY), STDOUT_FILENO);
+    }
+
+    total = (size_t)config->threads * COUNT_OF_MESSAGE;
+    latency = malloc(total * sizeof(*latency));
+    start = bench_now();
+    for(int i = 0; i < config->threads; ++i){
+        producers[i].config = config;
+        producers[i].latency = latency + (size_t)i * COUNT_OF_MESSAGE;
+        pthread_create(&tid[i], NULL, producer, &producers[i]);
+    }
+    for(int i = 0; i < config->threads; ++i){
+        pthread_join(tid[i], NULL);
+    }
+    elapsed = bench_now() - start;
+
+    if(out >= 0){
+        fflush(stdout);
+        dup2(out, STDOUT_FILENO);
+    }
+
+    snprintf(name, sizeof(name), "writer=%s color=%d timestamp=%d size=%d",
+        writers[config->writer], config->color, config->timestamp, config->size);
+    bench_latency("bench_throughput", name, config->threads, latency, total, elapsed);
+    free(latency);
+    exit(0);
+}
+
+int main(void){
+    static const int threads[] = {1, 2, 4, 8};
+    static const int sizes[] = {16, 64, 256, SIZE_OF_MESSAGE};
+    static const enum writerType sizeWriters[] = {WRITER_NULL, WRITER_FILE};
+    struct config config;
+
+    memset(payload, 'x', SIZE_OF_MESSAGE);
+    bench_header();
+
+    //! threads and writers.
+    for(int w = WRITER_NULL; w <= WRITER_FILE; ++w){
+        for(size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t){
+            config = (struct config){ .writer = w, .color = false, .timestamp = true, .size = 64, .threads = threads[t] };
+            run(&config);
+        }
+    }
+
+    //! color and timestamp.
+    for(int w = WRITER_NULL; w <= WRITER_CONSOLE; ++w){
+        for(int c = 0; c < 2; ++c){
+            for(int ts = 0; ts < 2; ++ts){
+                config = (struct config){ .writer = w, .color = c, .timestamp = ts, .size = 64, .threads = 1 };
+                run(&config);
+            }
+        }
+    }
+
+    //! message sizes.
+    for(size_t w = 0; w < sizeof(sizeWriters) / sizeof(sizeWriters[0]); ++w){
+        for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s){
+            config = (struct config){ .writer = sizeWriters[w], .color = false, .timestamp = true, .size = sizes[s], .threads = 1 };
+            run(&config);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,360 @@
+/**
+ * @file    bench_writer.c
+ * @author  qufeiyan
+ * @brief   Compare the caller-side latency of the stdio file writer, the mmap writer, the
+ *          binary writer, the flight recorder and the socket writer, and the bytes each of
+ *          them writes per log. check that the logs of the mmap writer survive a SIGKILL, and
+ *          that the collector gets every log the socket writer sends, across a restart of it.
+ * @version 1.0.0
+ * @date    2026/10/18 16:40:18
+ * @version Copyright (c) 2023
+ */
+
+#include "bench.h"
+#include "qlog_api.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define TAG_NAME "bench"
+
+#define COUNT_OF_MESSAGE    (200000)
+#define SIZE_OF_FILE        (16 << 20)
+#define COLLECTOR_PATH      "./bench_logs/collector.sock"
+#define CRASH_DIRECTORY     "./bench_logs/crash"
+#define COUNT_OF_CRASH_LOG  (100)
+#define COUNT_OF_RESTART_LOG (100)  //! logs before, while and after the collector is down.
+#define COLLECTOR_TIMEOUT   (10)    //! seconds to wait for the collector to get the logs.
+
+/**
+ * a stand-in of the local collector, it takes one connection of the socket writer at a time
+ * and parses its frames, each is the text prefixed by its length in 4 bytes of big endian.
+ */
+struct collector{
+    int listener;
+    int connection;                 //! -1 until the socket writer connects.
+    pthread_t thread;
+    uint32_t frames;                //! frames parsed, read atomically.
+    uint32_t broken;                //! frames of an invalid length, the connection is closed then.
+    bool stopping;
+};
+
+static void *collectorRun(void *args){
+    struct collector *collector = (struct collector *)args;
+    char buffer[64 * 1024];         //! larger than any frame.
+    struct pollfd pollfd;
+    uint32_t length, offset;
+    size_t filled = 0;
+    ssize_t ret;
+
+    while(!__atomic_load_n(&collector->stopping, __ATOMIC_ACQUIRE)){
+        pollfd.fd = collector->connection >= 0 ? collector->connection : collector->listener;
+        pollfd.events = POLLIN;
+        if(poll(&pollfd, 1, 50) <= 0){
+            continue;
+        }
+        if(collector->connection < 0){
+            collector->connection = accept(collector->listener, NULL, NULL);
+            filled = 0;
+            continue;
+        }
+
+        ret = read(collector->connection, buffer + filled, sizeof(buffer) - filled);
+        if(ret <= 0){
+            close(collector->connection);
+            collector->connection = -1;
+            continue;
+        }
+        filled += ret;
+        for(offset = 0; filled - offset >= sizeof(length); offset += sizeof(length) + length){
+            length = (uint32_t)(uint8_t)buffer[offset] << 24 | (uint32_t)(uint8_t)buffer[offset + 1] << 16 |
+                     (uint32_t)(uint8_t)buffer[offset + 2] << 8 | (uint8_t)buffer[offset + 3];
+            if(length == 0 || length > sizeof(buffer) - sizeof(length)){
+                __atomic_add_fetch(&collector->broken, 1, __ATOMIC_RELAXED);
+                close(collector->connection);
+                collector->connection = -1;
+                offset = filled = 0;
+                break;
+            }
+            if(filled - offset < sizeof(length) + length){
+                break;
+            }
+            __atomic_add_fetch(&collector->frames, 1, __ATOMIC_RELAXED);
+        }
+        memmove(buffer, buffer + offset, filled - offset);
+        filled -= offset;
+    }
+
+    if(collector->connection >= 0){
+        close(collector->connection);
+    }
+    close(collector->listener);
+    unlink(COLLECTOR_PATH);
+    return NULL;
+}
+
+/**
+ * @brief   bind the stand-in collector and start parsing the frames sent to it.
+ * @return  false if the socket can not be bound.
+ */
+static bool startCollector(struct collector *collector){
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+
+    memset(collector, 0, sizeof(*collector));
+    collector->connection = -1;
+    unlink(COLLECTOR_PATH);
+    strcpy(address.sun_path, COLLECTOR_PATH);
+    collector->listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(collector->listener < 0 || bind(collector->listener, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+        listen(collector->listener, 4) < 0){
+        return false;
+    }
+    return pthread_create(&collector->thread, NULL, collectorRun, collector) == 0;
+}
+
+/**
+ * @brief   take the collector down, the connection of the socket writer is closed.
+ */
+static void stopCollector(struct collector *collector){
+    __atomic_store_n(&collector->stopping, true, __ATOMIC_RELEASE);
+    pthread_join(collector->thread, NULL);
+}
+
+/**
+ * @brief   get the logs sent and dropped by the socket writer.
+ */
+static void socketStats(uint64_t *records, uint64_t *dropped){
+    log_stats_t stats;
+
+    qlog_stats(&stats);
+    *records = *dropped = 0;
+    for(uint32_t i = 0; i < stats.numberOfWriters; ++i){
+        if(strcmp(stats.writers[i].name, "socket") == 0){
+            *records = stats.writers[i].records;
+            *dropped = stats.writers[i].dropped;
+        }
+    }
+}
+
+/**
+ * @brief   wait for the socket writer to be done with {@code count} logs, and the collector
+ *          to get all of those sent.
+ * @param   frames is the frames the collector had got before the logs.
+ * @param   records is the logs the socket writer had sent before the logs.
+ * @param   dropped is the logs the socket writer had dropped before the logs.
+ * @return  false if the collector does not get them in time, or gets a frame broken.
+ */
+static bool waitCollector(struct collector *collector, uint32_t frames, uint64_t records, uint64_t dropped,
+                          uint32_t count){
+    uint64_t sent, lost, deadline = bench_now() + COLLECTOR_TIMEOUT * 1000000000ull;
+    uint32_t got;
+
+    do{
+        socketStats(&sent, &lost);
+        sent -= records;
+        lost -= dropped;
+        got = __atomic_load_n(&collector->frames, __ATOMIC_RELAXED) - frames;
+        if(sent + lost == count && got == sent){
+            return __atomic_load_n(&collector->broken, __ATOMIC_RELAXED) == 0;
+        }
+        usleep(10000);
+    }while(bench_now() < deadline);
+
+    fprintf(stderr, "collector got %u logs, the socket writer sent %llu and dropped %llu of %u\n",
+        got, (unsigned long long)sent, (unsigned long long)lost, count);
+    return false;
+}
+
+/**
+ * @brief   log while the collector is up, down and up again, the logs framed meanwhile are
+ *          kept by the socket writer and sent once it reconnects.
+ * @return  false if some log is lost.
+ */
+static bool checkRestart(struct collector *collector){
+    uint64_t records, dropped;
+    uint32_t frames;
+    int i;
+
+    socketStats(&records, &dropped);
+    frames = __atomic_load_n(&collector->frames, __ATOMIC_RELAXED);
+    for(i = 0; i < COUNT_OF_RESTART_LOG; ++i){
+        loge("before restart %d\n", i);
+    }
+    if(!waitCollector(collector, frames, records, dropped, COUNT_OF_RESTART_LOG)){
+        return false;
+    }
+
+    stopCollector(collector);
+    for(i = 0; i < COUNT_OF_RESTART_LOG; ++i){
+        loge("while down %d\n", i);
+    }
+    //! the logs are kept in the ring while the sender fails to reconnect.
+    usleep(200000);
+    if(!startCollector(collector)){
+        return false;
+    }
+    for(i = 0; i < COUNT_OF_RESTART_LOG; ++i){
+        loge("after restart %d\n", i);
+    }
+    if(!waitCollector(collector, 0, records + COUNT_OF_RESTART_LOG, dropped, 2 * COUNT_OF_RESTART_LOG)){
+        return false;
+    }
+
+    printf("%-44s %u/%d logs kept\n", "writer=socket collector=restarted",
+        __atomic_load_n(&collector->frames, __ATOMIC_RELAXED), 2 * COUNT_OF_RESTART_LOG);
+    return true;
+}
+
+/**
+ * @brief   count the logs of a directory written by {@code checkCrash}.
+ * @param   remove means to remove the files instead.
+ */
+static int countCrashLogs(bool remove){
+    char path[512], line[256];
+    struct dirent *entry;
+    FILE *file;
+    DIR *dir;
+    int count = 0;
+
+    dir = opendir(CRASH_DIRECTORY);
+    if(dir == NULL){
+        return 0;
+    }
+    while((entry = readdir(dir)) != NULL){
+        if(entry->d_name[0] == '.'){
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", CRASH_DIRECTORY, entry->d_name);
+        if(remove){
+            unlink(path);
+            continue;
+        }
+        //! a file left by a crash ends with zeros instead of being truncated.
+        if((file = fopen(path, "r")) != NULL){
+            while(fgets(line, sizeof(line), file) != NULL){
+                count += strstr(line, "crash line") != NULL;
+            }
+            fclose(file);
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+/**
+ * @brief   log from a child process killed by SIGKILL right after, through the mmap writer.
+ * @return  false if some log of the child is lost.
+ */
+static bool checkCrash(void){
+    int count, status;
+    pid_t pid;
+
+    mkdir("./bench_logs", S_IRWXU | S_IRWXG | S_IRWXO);
+    countCrashLogs(true);
+
+    pid = fork();
+    if(pid == 0){
+        qlog_init(LOG_LEVEL_DEBUG, false, true, 1);
+        qlog_setConsoleWriter(false);
+        qlog_registerMmapWriter("crash", CRASH_DIRECTORY, 2, SIZE_OF_FILE);
+        qlog_setMmapWriter(true);
+        for(int i = 0; i < COUNT_OF_CRASH_LOG; ++i){
+            logi("crash line %d\n", i);
+        }
+        kill(getpid(), SIGKILL);
+        _exit(1);
+    }
+    if(pid < 0 || waitpid(pid, &status, 0) != pid || !WIFSIGNALED(status)){
+        fprintf(stderr, "crash check: the child was not killed\n");
+        return false;
+    }
+
+    count = countCrashLogs(false);
+    printf("%-44s %d/%d logs kept\n", "writer=mmap kill=SIGKILL", count, COUNT_OF_CRASH_LOG);
+    return count == COUNT_OF_CRASH_LOG;
+}
+
+static void run(const char *writer){
+    static uint64_t latency[COUNT_OF_MESSAGE];
+    log_stats_t stats;
+    char name[32];
+    uint64_t start, elapsed;
+    int i;
+
+    start = bench_now();
+    for(i = 0; i < COUNT_OF_MESSAGE; ++i){
+        latency[i] = bench_now();
+        logi("message %d of the benchmark, value %f\n", i, i * 0.5);
+        latency[i] = bench_now() - latency[i];
+    }
+    elapsed = bench_now() - start;
+
+    snprintf(name, sizeof(name), "writer=%s", writer);
+    bench_latency("bench_writer", name, 1, latency, COUNT_OF_MESSAGE, elapsed);
+
+    qlog_stats(&stats);
+    for(i = 0; i < (int)stats.numberOfWriters; ++i){
+        if(strcmp(stats.writers[i].name, writer) == 0 && stats.writers[i].records > 0){
+            bench_size("bench_writer", name, (double)stats.writers[i].bytes / stats.writers[i].records);
+        }
+    }
+}
+
+int main(void){
+    struct collector collector;
+
+    //! before the logger of this process is initialised, the child initialises its own.
+    if(!checkCrash()){
+        return 1;
+    }
+
+    qlog_init(LOG_LEVEL_DEBUG, false, true, 1);
+    qlog_setConsoleWriter(false);
+    qlog_registerFileWriter("file", "./bench_logs", 4, SIZE_OF_FILE);
+    qlog_registerMmapWriter("mmap", "./bench_logs", 4, SIZE_OF_FILE);
+    qlog_registerBinaryWriter("binary", "./bench_logs", 4, SIZE_OF_FILE);
+    qlog_registerFlightWriter("flight", "./bench_logs", 0);
+
+    bench_header();
+    run("none");
+
+    qlog_setFileWriter(true);
+    run("file");
+    qlog_setFileWriter(false);
+
+    qlog_setMmapWriter(true);
+    run("mmap");
+    qlog_setMmapWriter(false);
+
+    qlog_setBinaryWriter(true);
+    run("binary");
+    qlog_setBinaryWriter(false);
+
+    if(!startCollector(&collector) ||
+        !qlog_registerSocketWriter(LOG_SOCKET_UNIX_STREAM, COLLECTOR_PATH, LOG_FRAMING_LENGTH, 0)){
+        fprintf(stderr, "failed to start the collector\n");
+        return 1;
+    }
+    qlog_setSocketWriter(true);
+    run("socket");
+    //! the logs the ring has no room for are dropped by the caller, the rest reach the collector.
+    if(!waitCollector(&collector, 0, 0, 0, COUNT_OF_MESSAGE) || !checkRestart(&collector)){
+        return 1;
+    }
+    qlog_setSocketWriter(false);
+
+    qlog_setFlightWriter(true);
+    run("flight");
+    return 0;
+}
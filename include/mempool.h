@@ -18,23 +18,102 @@
 extern "C" {
 #endif
 
+#define COUNT_OF_ARENA_CLASS    (8)     //! maximum number of size classes of an arena.
+
+#define COUNT_OF_MAGAZINE       (8)     //! number of pools each thread caches blocks of.
+
+#define SIZE_OF_MAGAZINE        (8)     //! maximum number of blocks a thread caches of a pool.
+
+//! bytes of a pool of {@code total} blocks of {@code size} bytes, a multiple of the pointer size.
+#define MEMORY_POOL_SIZE(total, size)   ((total) * (sizeof(uint8_t *) + (size)))
+//! bytes of an arena of {@code classes} size classes from {@code size} bytes, {@code total} blocks each.
+#define MEMORY_ARENA_SIZE(total, size, classes) \
+    ((total) * ((classes) * sizeof(uint8_t *) + (size) * ((1u << (classes)) - 1)))
+
+/**
+ * the free blocks are a Treiber stack, its head is tagged with a counter bumped by each
+ * update, so a block taken and given back meanwhile never lets a stale CAS succeed.
+ * each thread caches a few blocks of a pool in a magazine, so a thread taking and giving
+ * back blocks touches the shared stack only when its magazine is empty or full.
+ */
 struct memoryPool{
     const char* name;
     void *start;
     size_t size;
     size_t block_size;
     size_t block_total;
-    size_t block_free;
-    uint8_t *block_list;
+    size_t block_free;              //! blocks in the stack, those cached by threads are counted as used.
+    size_t block_free_min;          //! the least blocks free ever, the high-water mark is the total minus it.
+    uint64_t block_list;            //! head of the stack, a tag in high 32 bits and the index of block + 1 in low 32 bits.
+    uint32_t magazine;              //! blocks a thread caches at most, 0 if the pool is too small to cache.
+    uint64_t failures;              //! requests no block was left for.
 
     void *(*alloc)(struct memoryPool *);
     void (*free)(struct memoryPool *, void *pointer);
 };
 typedef struct memoryPool memoryPool_t;
 
+/**
+ * usage of a pool, read without stopping the threads using it.
+ */
+struct memoryPoolStats{
+    size_t total;
+    size_t used;                    //! blocks taken from the stack, including those cached by threads.
+    size_t highWater;               //! the most blocks used ever.
+    uint64_t failures;
+};
+typedef struct memoryPoolStats memoryPoolStats_t;
+
+/**
+ * pools of blocks doubling in size carved from one region, a request takes a block of the
+ * smallest class fitting it, or of a larger class if that one is exhausted.
+ */
+struct memoryArena{
+    const char *name;
+    void *start;
+    size_t size;
+    size_t numberOfPools;
+    uint64_t failures;              //! requests no block was left for.
+    memoryPool_t pools[COUNT_OF_ARENA_CLASS];
+};
+typedef struct memoryArena memoryArena_t;
+
+/**
+ * @brief   initialise a pool in a region of {@code MEMORY_POOL_SIZE} bytes.
+ * @note    the blocks cached by a thread are given back when it exits, so a pool used by
+ *          several threads must outlive them.
+ */
 void memoryPoolInit(struct memoryPool *mp, const char *name, 
     size_t block_total, size_t block_size, void *start);
 
+/**
+ * @brief   read the usage of a pool.
+ */
+void memoryPoolStats(const struct memoryPool *mp, memoryPoolStats_t *stats);
+
+/**
+ * @brief   initialise an arena in a region of {@code MEMORY_ARENA_SIZE} bytes.
+ * @param   arena is pointer to arena.
+ * @param   name is the name of arena.
+ * @param   block_total is the number of blocks of each class.
+ * @param   block_size is the size of the smallest class, a multiple of the pointer size.
+ * @param   classes is the number of classes, each doubles the size of the last one.
+ * @param   start is the region.
+ */
+void memoryArenaInit(struct memoryArena *arena, const char *name, size_t block_total,
+    size_t block_size, size_t classes, void *start);
+
+/**
+ * @brief   take a block of {@code size} bytes at least.
+ * @return  NULL if it is larger than the largest class or no block is left.
+ */
+void *memoryArenaAlloc(struct memoryArena *arena, size_t size);
+
+/**
+ * @brief   give back a block taken by {@code memoryArenaAlloc}.
+ */
+void memoryArenaFree(struct memoryArena *arena, void *pointer);
+
 
 #define memoryPoolAlloc(mp) ({\
     void *ptr;\
@@ -43,9 +122,9 @@ void memoryPoolInit(struct memoryPool *mp, const char *name,
     ptr;\
 })
 
-#define memoryPoolFree(mp) ({\
+#define memoryPoolFree(mp, pointer) ({\
     typeof((mp)) _mp = (memoryPool_t *)(mp);\
-    _mp->free(_mp);\
+    _mp->free(_mp, (pointer));\
 })
 
 
@@ -16,9 +16,11 @@
 #include "mempool.h"
 #include "qlog_def.h"
 #include "qlog_slist.h"
+#include "qlog_stats.h"
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <sys/uio.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -39,78 +41,288 @@ extern "C" {
 struct locker{
     void *locker;
     void (*lock)(struct locker *);
+    bool (*tryLock)(struct locker *);
     void (*unlock)(struct locker *);
 };
 typedef struct locker locker_t;
 
+/**
+ * an interned tag, {@code hash} is published last so that lock-free readers
+ * always see a complete entry.
+ */
 struct filter_tag{
+    uint32_t hash;                  //! hash of the tag, 0 means the entry is empty.
+    level_t level;                  //! level of the tag, updated atomically.
     char tag[SIZE_OF_NAME];
-    level_t level;
-    slist_t list_tag_current;
 };
 typedef struct filter_tag filter_tag_t;
 
+#define FILTER_LEVEL_NONE       (-1)    //! the level of the tags filtered out.
+
+/**
+ * a snapshot of the levels of tags, a filter swaps in a new one to replace all the tags at
+ * once, so that readers always see either the old tags or the new ones, without lock.
+ */
+struct filter_table{
+    filter_tag_t *tags;             //! open addressing table of the interned tags.
+    uint32_t mask;                  //! size of the table - 1, the size is a power of 2.
+    uint32_t count;                 //! number of tags in the table.
+    int32_t others;                 //! level of the tags not in the table, {@code FILTER_LEVEL_NONE} by default.
+};
+typedef struct filter_table filter_table_t;
+
+/**
+ * the tags are replaced by rebuilding the table not in use and swapping the two, a reader
+ * still in the table being rebuilt sees {@code sequence} changed and reads again.
+ */
 struct filter{
-    memoryPool_t *tagMemoryPool;  //! used to alloc memory for filter_tag.
-    slist_t list_tag;  //! all the tags to be filtered.
-    char *buffer;      //! pointer to the log buffer.
-    level_t level;     //! global level.
-    //! append tag to be filtered to the list_tag.
-    void (*append)(struct filter *, const char *tag, level_t level);  
+    filter_table_t *table;          //! current table, swapped atomically.
+    filter_table_t *tables[2];      //! the first one is given by {@code filterInit}, the other is
+                                    //! allocated by the first replacement.
+    uint32_t sequence;              //! bumped before a table is rebuilt.
+    uint32_t capacity;              //! maximum number of tags.
+    level_t level;                  //! global level, of the logs without tag or when no tag is given.
+    //! set the level of a tag, the tag is interned at the first time.
+    bool (*append)(struct filter *, const char *tag, level_t level);  
+    //! find the handle of a tag in current table, -1 if the tag is not interned.
+    int32_t (*find)(struct filter *, const char *tag);
     //! filter tag.
     bool (*invoke)(struct filter *, const char *tag, level_t level);
+    //! replace all the tags, {@code others} is the level of the tags not given.
+    bool (*replace)(struct filter *, const char (*tags)[SIZE_OF_NAME], const level_t *levels, uint32_t count,
+                    int32_t others);
+    //! the least important level a log may pass with, whatever its tag.
+    level_t (*ceiling)(struct filter *);
 };
 typedef struct filter filter_t;
 
+struct deferredRecord;
+
+/**
+ * identity of a thread rendered as text once, so that a log only copies it.
+ */
+struct threadIdentity{
+    uint8_t tidLength;
+    uint8_t nameLength;
+    char tid[10];                   //! id of the thread in decimal, not ended by '\0'.
+    char name[SIZE_OF_THREAD_NAME]; //! name of the thread, not ended by '\0'.
+};
+
+/**
+ * context of a log captured on the calling thread, only the fields used by the layout are set.
+ */
+struct logContext{
+    const struct layout *layout;    //! the layout the context is captured for, the log is rendered by it.
+    uint64_t time;                  //! nanoseconds since the epoch, see {@code formatter->now}.
+    uint64_t sequence;              //! sequence number of the log.
+    int32_t cpu;                    //! cpu of the calling thread.
+    struct threadIdentity thread;   //! identity of the calling thread.
+};
+typedef struct logContext logContext_t;
+
+enum layoutCode{
+    LAYOUT_LITERAL,                 //! text of the pattern.
+    LAYOUT_TIMESTAMP,               //! %d
+    LAYOUT_LEVEL,                   //! %L, level letter.
+    LAYOUT_LEVEL_NAME,              //! %l, level name.
+    LAYOUT_TAG,                     //! %T
+    LAYOUT_TID,                     //! %t
+    LAYOUT_THREAD_NAME,             //! %N
+    LAYOUT_PID,                     //! %p
+    LAYOUT_SEQUENCE,                //! %n
+    LAYOUT_CPU,                     //! %c
+    LAYOUT_MESSAGE,                 //! %m
+    LAYOUT_BUTT
+};
+
+/* the default layouts. */
+#define LAYOUT_DEFAULT              "%L/%T: %m"
+#define LAYOUT_DEFAULT_TIMESTAMP    "%d %L/%T: %m"
+
+struct layoutOp{
+    uint8_t code;                   //! {@code enum layoutCode}.
+    uint8_t length;                 //! length of literal text.
+    uint16_t offset;                //! offset of literal text in {@code layout->literals}.
+};
+
+/**
+ * a layout pattern compiled into a flat program, the ops before %m form the header of
+ * a log, and the rest form the trailer.
+ */
+struct layout{
+    struct layoutOp ops[COUNT_OF_LAYOUT_OP];
+    uint8_t numberOfHeaderOps;
+    uint8_t numberOfOps;
+    uint32_t fields;                //! mask of (1 << layoutCode) used by the layout.
+    char literals[SIZE_OF_LAYOUT];
+    struct layout *retired;         //! the layout replaced by this one, NULL for the first layout.
+};
+typedef struct layout layout_t;
+
+/**
+ * a clock source of timestamp. a formatter keeps two copies and a sequence, so that a reader
+ * always finds one copy complete while the other is changed, even from a signal handler.
+ */
+struct logClock{
+    log_clock_t source;
+    int64_t offset;                 //! offset from the clock to realtime, in nanoseconds.
+    uint64_t ticksBase;             //! cpu counter at calibration.
+    uint64_t nsPerTick;             //! nanoseconds per tick of cpu counter, 32.32 fixed point.
+};
+
 struct formatter{
-    bool timestamp;
     bool color;
-    char *buffer;  //! pointer to the log buffer.
+    layout_t *layout;               //! compiled layout of log, swapped atomically, see {@code formatterSetLayout}.
+    layout_t first;                 //! storage of the first layout, the others are allocated.
+    uint64_t sequence;              //! sequence number of the next log.
+    struct logClock clocks[2];      //! the clock in use is {@code clocks[clockSequence & 1]}.
+    uint32_t clockSequence;         //! bumped before each copy is changed, see {@code formatterSetClock}.
+    log_precision_t precision;      //! precision of timestamp, it only affects rendering.
+    bool deferred;  //! capture arguments on the calling thread and format in the backend, asynchronous mode only.
+    char *buffer;  //! pointer to the log buffer of logger, logs are formatted into the buffer of calling thread.
+    memoryArena_t *arena;           //! blocks for the logs longer than the log buffer, NULL means they are cut off.
 
-    int32_t (*invoke)(struct formatter *formatter, const char *tag, level_t level, const char *format, va_list args);
+    //! read the clock in nanoseconds since the epoch, async-signal-safe.
+    uint64_t (*now)(struct formatter *formatter);
+    //! capture the context used by the layout on the calling thread.
+    void (*capture)(struct formatter *formatter, logContext_t *context);
+    //! format a log into {@code *buffer}, which is {@code SIZE_OF_LOG_BUFFER} bytes at least. a longer log
+    //! is formatted into a block of arena instead, {@code *buffer} is set to it and given back by release.
+    //! the location of {@code site} is put before the message, NULL means none.
+    int32_t (*invoke)(struct formatter *formatter, char **buffer, const qlog_site_t *site, const char *tag,
+                      level_t level, const char *format, va_list args);
+    //! format a log captured by {@code deferredCapture} into {@code buffer}.
+    int32_t (*render)(struct formatter *formatter, char *buffer, level_t level, const struct deferredRecord *record);
+    //! give back a log formatted by invoke, if it is not in the buffer given.
+    void (*release)(struct formatter *formatter, char *buffer);
 };
 typedef struct formatter formatter_t;
 
 struct writer{
     char name[SIZE_OF_NAME];
-    char *buffer;                   //! pointer to the log buffer.
+    char *buffer;                   //! pointer to the log buffer, the text of the log without color.
     int32_t length;                 //! length of the buffer.
     bool enable;                    //! whether to enable this writer.
-    bool color;                     //! whether the current log buffer is colored. 
+    bool color;                     //! whether the current log is shown colored, see {@code writerSegments}.
+    level_t level;                  //! level of the current log.
+    uint32_t skipped;               //! mask of (1 << level) of the logs the writer skips, 0 means none.
+    bool binary;                    //! the writer consumes {@code record} instead of the text.
+    const struct deferredRecord *record;    //! raw arguments of the current log, NULL if not captured.
+    writerStats_t stats;
+    //! the writer decorated by this one, e.g. a queue writer, NULL if it writes by itself.
+    //! the kind and the counters of the chain are those of the writer decorated.
+    struct writer *inner;
 
     void (*init)(struct writer*);
     void (*deInit)(struct writer*);
     void (*write)(struct writer*);
     void (*flush)(struct writer*);
+    //! free the resources of a writer stopped by {@code deInit}, NULL if there is nothing to free.
+    void (*release)(struct writer*);
+    //! write the logs kept by the writer if {@code text} is NULL, or {@code text} otherwise, straight
+    //! to its sink, called by the crash handler with async-signal-safe calls only and without lock.
+    //! NULL if the writer keeps nothing a crash loses.
+    void (*emergency)(struct writer*, const char *text, int32_t length);
 
     struct writer *next;
 };
 typedef struct writer writer_t;
 
 struct logger{
-    level_t level;
+    level_t level;                  //! {@code filter->ceiling}, the logs less important are rejected at once.
     char buffer[SIZE_OF_LOG_BUFFER];
 
-    void (*run)(struct logger *logger, const char *tag, level_t level, const char *fmt, va_list args);
+    //! output a log which has passed {@code loggerFilter}, {@code site} is its callsite, NULL means none.
+    void (*run)(struct logger *logger, const qlog_site_t *site, const char *tag, level_t level,
+                const char *fmt, va_list args);
     void (*registerWriter)(struct logger *logger, writer_t *target);
     formatter_t *formatter;
     filter_t *filter;
     writer_t *writer;
 
     locker_t *locker;
+    struct asyncLogger *async;      //! asynchronous backend, NULL means synchronous output.
+    struct limiter *limiter;        //! rate limits and suppression of repeats, NULL means none.
+    loggerStats_t stats;
 };
 
 typedef struct logger logger_t;
 
+/**
+ * the segments of a log handed to a writer. the color codes are static strings, so a
+ * writer showing color writes them around the text, and the others write the text only.
+ */
+enum logSegment{
+    LOG_SEGMENT_COLOR,              //! the color code of the level.
+    LOG_SEGMENT_TEXT,               //! the text in {@code writer->buffer}.
+    LOG_SEGMENT_RESET,              //! the code resetting the color.
+    LOG_SEGMENT_BUTT
+};
+
+extern const struct iovec logColors[LOG_LEVEL_BUTT];
+extern const struct iovec logColorReset;
+
+/**
+ * @brief   get the segments of current log of a writer showing color.
+ * @param   writer is pointer to writer.
+ * @param   segments is where the segments are written to.
+ * @return  the number of segments, 1 if the log is not colored.
+ */
+static inline int writerSegments(const struct writer *writer, struct iovec segments[LOG_SEGMENT_BUTT]){
+    struct iovec text = { writer->buffer, (size_t)writer->length };
+
+    if(!writer->color){
+        segments[0] = text;
+        return 1;
+    }
+    segments[LOG_SEGMENT_COLOR] = logColors[writer->level];
+    segments[LOG_SEGMENT_TEXT] = text;
+    segments[LOG_SEGMENT_RESET] = logColorReset;
+    return LOG_SEGMENT_BUTT;
+}
+
+/**
+ * @brief   check whether a writer takes its current log.
+ * @param   writer is pointer to writer.
+ * @return  false if the writer is disabled or skips the level of the log.
+ */
+static inline bool writerAccepts(const struct writer *writer){
+    return __atomic_load_n(&writer->enable, __ATOMIC_RELAXED) &&
+        !(__atomic_load_n(&writer->skipped, __ATOMIC_RELAXED) & (1u << writer->level));
+}
+
+/* the kinds of writers enabled, see {@code loggerSinks}. */
+#define LOGGER_SINK_TEXT        (1 << 0)    //! some writer consumes the formatted text.
+#define LOGGER_SINK_RECORD      (1 << 1)    //! some writer consumes the raw arguments.
+
 void loggerInit(logger_t *logger, level_t level, 
                 formatter_t *formatter, writer_t *writer, filter_t *filter,
                 locker_t *locker);
 void loggerDeInit(logger_t *logger);
+void loggerOutput(logger_t *logger, level_t level, const char *buffer, int32_t length,
+                  const struct deferredRecord *record);
+uint32_t loggerSinks(logger_t *logger, level_t level);
+bool loggerCapture(logger_t *logger, struct deferredRecord *record, int32_t size,
+                   const qlog_site_t *site, const char *tag, const char *fmt, va_list args);
+void loggerLock(logger_t *logger);
+bool loggerFilter(logger_t *logger, const char *tag, level_t level);
+uint32_t loggerHashTag(const char *tag);
+bool loggerLimit(logger_t *logger, const qlog_site_t *site, const char *tag, level_t level,
+                 const char *fmt, va_list args);
+void loggerEmergency(logger_t *logger, const char *text, int32_t length);
+bool writerWriteAll(int fd, const char *data, int32_t size);
 
-void filterInit(struct filter *filter, memoryPool_t *mp, char *buffer, level_t level);
+void filterInit(struct filter *filter, filter_table_t *table, filter_tag_t *tags, uint32_t sizeOfTable,
+                uint32_t capacity, level_t level);
+void filterDeInit(struct filter *filter);
 void formatterInit(struct formatter *formatter, bool color, bool timestamp, char *buffer);
+void formatterSetClock(struct formatter *formatter, log_clock_t clock, log_precision_t precision);
+bool formatterSetLayout(struct formatter *formatter, const char *pattern);
+void formatterDeInit(struct formatter *formatter);
+void formatterSetThreadName(const char *name);
 void consoleWriterInit(struct writer *writer, char *buffer, bool enable);
 void lockerInit(struct locker *locker, void *mutex);
+void lockerDeInit(struct locker *locker);
 
 void fileWriterInit(writer_t *writer, char *buffer, const char *fileName, const char *directory, 
                       int numberOfFiles, int sizeOfFile);
@@ -14,6 +14,8 @@
 
 // #include "qlog.h"
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <unistd.h>
 #ifdef __cplusplus
 extern "C" {
@@ -28,33 +30,260 @@ enum level{
     LOG_LEVEL_BUTT
 };
 typedef enum level level_t;
+
+enum log_clock{
+    LOG_CLOCK_REALTIME,             //! CLOCK_REALTIME.
+    LOG_CLOCK_REALTIME_COARSE,      //! CLOCK_REALTIME_COARSE, cheaper with a resolution of a tick.
+    LOG_CLOCK_MONOTONIC,            //! CLOCK_MONOTONIC, shown as the wall clock time at start plus elapsed time.
+    LOG_CLOCK_TSC,                  //! cpu counter calibrated against CLOCK_MONOTONIC, converted by a multiply.
+    LOG_CLOCK_BUTT
+};
+typedef enum log_clock log_clock_t;
+
+enum log_precision{
+    LOG_PRECISION_MS,
+    LOG_PRECISION_US,
+    LOG_PRECISION_NS,
+    LOG_PRECISION_BUTT
+};
+typedef enum log_precision log_precision_t;
+
+/**
+ * what a writer queue does with a log when it is full, see {@code qlog_setWriterQueue}.
+ */
+enum log_queue_policy{
+    LOG_QUEUE_BLOCK,                //! wait for the writer, the logging threads are slowed down.
+    LOG_QUEUE_DROP_NEWEST,          //! drop the log.
+    LOG_QUEUE_DROP_OLDEST,          //! drop the oldest logs queued to make room.
+    LOG_QUEUE_DROP_BELOW_LEVEL,     //! drop the log if it is less important than a level, or wait.
+    LOG_QUEUE_BUTT
+};
+typedef enum log_queue_policy log_queue_policy_t;
+
+/**
+ * the transport of a socket writer, see {@code qlog_registerSocketWriter}.
+ */
+enum log_socket{
+    LOG_SOCKET_UNIX_DGRAM,          //! a unix domain datagram socket, e.g. "/dev/log".
+    LOG_SOCKET_UNIX_STREAM,         //! a unix domain stream socket.
+    LOG_SOCKET_UDP,                 //! "host:port", or "[v6 address]:port".
+    LOG_SOCKET_TCP,                 //! "host:port", or "[v6 address]:port".
+    LOG_SOCKET_BUTT
+};
+typedef enum log_socket log_socket_t;
+
+/**
+ * how a socket writer frames a log.
+ */
+enum log_framing{
+    LOG_FRAMING_SYSLOG,             //! a RFC 5424 message, prefixed by its length as RFC 6587 on streams.
+    LOG_FRAMING_LENGTH,             //! the text prefixed by its length in 4 bytes of big endian.
+    LOG_FRAMING_BUTT
+};
+typedef enum log_framing log_framing_t;
 typedef struct logger logger_t;
 
-#define qlog_err(tag, fmt, ...) do{\
-    qlog(tag, LOG_LEVEL_ERROR, "[%s:%d](#%s) " fmt, \
-        __FILE__, __LINE__, __FUNCTION__, ##__VA_ARGS__);\
-} while(0)
+#define COUNT_OF_STATS_BUCKET   (32)    //! number of buckets of a latency histogram.
+#define COUNT_OF_STATS_WRITER   (8)     //! maximum number of writers in a snapshot.
+#define COUNT_OF_STATS_CLASS    (8)     //! maximum number of size classes of the arena in a snapshot.
 
-#define qlog_warn(tag, fmt, ...) do{\
-    qlog(tag, LOG_LEVEL_WARNING, "[%s:%d](#%s) " fmt, \
-        __FILE__, __LINE__, __FUNCTION__, ##__VA_ARGS__);\
-} while(0)
+/**
+ * a latency histogram in ns, bucket 0 counts 0 ns, bucket i counts [2^(i-1), 2^i) ns,
+ * and the last bucket counts the rest.
+ */
+struct log_histogram{
+    uint64_t count;
+    uint64_t sum;                   //! total ns.
+    uint64_t max;                   //! maximum ns.
+    uint64_t buckets[COUNT_OF_STATS_BUCKET];
+};
+typedef struct log_histogram log_histogram_t;
 
-#define qlog_info(tag, fmt, ...) do{\
-    qlog(tag, LOG_LEVEL_INFO, "[%s:%d](#%s) " fmt, \
-        __FILE__, __LINE__, __FUNCTION__, ##__VA_ARGS__);\
+struct log_writer_stats{
+    char name[16];
+    bool enable;
+    uint64_t records;               //! logs written.
+    uint64_t bytes;                 //! bytes written.
+    uint64_t dropped;               //! logs the writer failed to write.
+    uint64_t flushes;               //! batches flushed to the sink.
+    log_histogram_t flushLatency;   //! time of each flush.
+};
+typedef struct log_writer_stats log_writer_stats_t;
+
+/**
+ * a size class of the arena holding the logs longer than the log buffer, shared by all the loggers.
+ */
+struct log_arena_stats{
+    uint32_t size;                  //! bytes of each block.
+    uint32_t total;                 //! blocks of the class.
+    uint32_t used;                  //! blocks in use.
+    uint32_t highWater;             //! the most blocks in use ever.
+};
+typedef struct log_arena_stats log_arena_stats_t;
+
+struct log_stats{
+    uint64_t accepted;              //! logs handed to the writers.
+    uint64_t filtered;              //! logs rejected by the level or the tag filter.
+    uint64_t suppressed;            //! logs rejected by the rate limits or as repeats.
+    uint64_t dropped;               //! logs lost before reaching the writers.
+    uint64_t truncated;             //! logs cut off, as they are too long or the arena is exhausted.
+    log_histogram_t lockWait;       //! time waiting for the lock of logger.
+    uint32_t numberOfWriters;
+    log_writer_stats_t writers[COUNT_OF_STATS_WRITER];
+    uint64_t arenaFailures;         //! long logs no block of the arena was left for.
+    uint32_t numberOfClasses;
+    log_arena_stats_t arena[COUNT_OF_STATS_CLASS];
+};
+typedef struct log_stats log_stats_t;
+
+#ifndef QLOG_MIN_LEVEL
+#define QLOG_MIN_LEVEL      LOG_LEVEL_DEBUG     //! logs whose level is above it are compiled out.
+#endif
+
+extern uint32_t qlog_generation;    //! changes whenever the configuration of any logger changes.
+
+/**
+ * the cached state of a callsite logging to a logger handle, see {@code _qlog_enabled_ex}.
+ */
+struct qlog_callsite{
+    logger_t *logger;               //! the logger the state is cached for, bound at the first log.
+    uint32_t state;
+};
+typedef struct qlog_callsite qlog_callsite_t;
+
+#define QLOG_SITE_SECTION   "qlog_sites"    //! the section the descriptors of callsites are emitted into.
+
+/**
+ * the descriptor of a callsite of the qlog_xxx macros, a static object emitted into the
+ * section {@code QLOG_SITE_SECTION}, so that all the callsites of a program can be listed
+ * and turned off one by one. its location is rendered once at its first log, and each log
+ * only copies the text.
+ */
+struct qlog_site{
+    const char *file;
+    const char *function;
+    const char *format;             //! the format string given to the macro.
+    const char *tag;                //! the tag, NULL if it may vary.
+    uint32_t line;
+    uint8_t level;
+    bool disabled;                  //! turned off by {@code qlog_setCallsite}.
+    uint16_t prefixLength;
+    const char *prefix;             //! "[file:line](#function) ", NULL until it is rendered.
+    qlog_callsite_t cache;          //! cached state of the callsite.
+};
+typedef struct qlog_site qlog_site_t;
+
+uint32_t qlog_callsite(logger_t *logger, qlog_site_t *site);
+void _qlog_output(qlog_site_t *site, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+void _qlog_output_ex(logger_t *logger, qlog_site_t *site, const char *tag, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+/**
+ * @brief   check whether a callsite is enabled with its cached state.
+ * @param   site is the callsite, its cached state is the generation with the lowest bit
+ *          set if the callsite is enabled.
+ * @param   logger is the logger of callsite, NULL means the default logger.
+ * @note    a disabled callsite costs only one comparison until the generation changes.
+ */
+static inline __attribute__((always_inline)) bool _qlog_enabled(qlog_site_t *site, logger_t *logger){
+    uint32_t generation = __atomic_load_n(&qlog_generation, __ATOMIC_RELAXED);
+    uint32_t cached = __atomic_load_n(&site->cache.state, __ATOMIC_RELAXED);
+
+    if(__builtin_expect(cached == generation, 1)){
+        return false;
+    }
+    if(cached != (generation | 1)){
+        cached = qlog_callsite(logger, site);
+        __atomic_store_n(&site->cache.state, cached, __ATOMIC_RELAXED);
+    }
+    return cached & 1;
+}
+
+/**
+ * @brief   check whether a callsite logging to a logger handle is enabled.
+ * @param   site is the callsite.
+ * @param   logger is the logger of current log.
+ * @note    the state is cached for the first logger the callsite logs to, so it is never
+ *          mixed up between loggers. logs to any other logger are filtered every time.
+ */
+static inline __attribute__((always_inline)) bool _qlog_enabled_ex(qlog_site_t *site, logger_t *logger){
+    logger_t *bound = __atomic_load_n(&site->cache.logger, __ATOMIC_RELAXED);
+
+    if(__builtin_expect(bound != logger, 0)){
+        if(bound != NULL || !__atomic_compare_exchange_n(&site->cache.logger, &bound, logger,
+            false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+            return qlog_callsite(logger, site) & 1;
+        }
+    }
+    return _qlog_enabled(site, logger);
+}
+
+/**
+ * define the descriptor of a callsite, a constant tag (e.g. a string literal) is kept by it,
+ * so that its filter result is cached by the callsite as well.
+ */
+#define _qlog_site(name, _tag, _level, _format) \
+    static qlog_site_t name __attribute__((section(QLOG_SITE_SECTION), used, aligned(sizeof(void *)))) = {\
+        .file = __FILE__, .function = __FUNCTION__, .format = _format,\
+        .tag = __builtin_constant_p(_tag) ? (_tag) : NULL, .line = __LINE__, .level = _level,\
+    }
+
+/**
+ * arguments are not evaluated if the callsite is disabled, and the whole statement
+ * is compiled out if {@code level} is above {@code QLOG_MIN_LEVEL}.
+ */
+#define _qlog_callsite(tag, level, fmt, ...) do{\
+    _qlog_site(_qlog_site, tag, level, fmt);\
+    if((level) <= QLOG_MIN_LEVEL && _qlog_enabled(&_qlog_site, NULL)){\
+        _qlog_output(&_qlog_site, tag, fmt, ##__VA_ARGS__);\
+    }\
 } while(0)
 
-#define qlog_dbg(tag, fmt, ...) do{\
-    qlog(tag, LOG_LEVEL_DEBUG, "[%s:%d](#%s) " fmt, \
-        __FILE__, __LINE__, __FUNCTION__, ##__VA_ARGS__);\
+/**
+ * the same as {@code _qlog_callsite}, but the log is output through {@code logger},
+ * which is evaluated once, NULL means the default logger.
+ */
+#define _qlog_callsite_ex(logger, tag, level, fmt, ...) do{\
+    _qlog_site(_qlog_site, tag, level, fmt);\
+    logger_t *_qlog_logger = (logger);\
+    if((level) <= QLOG_MIN_LEVEL && _qlog_enabled_ex(&_qlog_site, _qlog_logger)){\
+        _qlog_output_ex(_qlog_logger, &_qlog_site, tag, fmt, ##__VA_ARGS__);\
+    }\
 } while(0)
 
+#define qlog_err(tag, fmt, ...) \
+    _qlog_callsite(tag, LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+
+#define qlog_warn(tag, fmt, ...) \
+    _qlog_callsite(tag, LOG_LEVEL_WARNING, fmt, ##__VA_ARGS__)
+
+#define qlog_info(tag, fmt, ...) \
+    _qlog_callsite(tag, LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+
+#define qlog_dbg(tag, fmt, ...) \
+    _qlog_callsite(tag, LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+
+#define qlog_err_ex(logger, tag, fmt, ...) \
+    _qlog_callsite_ex(logger, tag, LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+
+#define qlog_warn_ex(logger, tag, fmt, ...) \
+    _qlog_callsite_ex(logger, tag, LOG_LEVEL_WARNING, fmt, ##__VA_ARGS__)
+
+#define qlog_info_ex(logger, tag, fmt, ...) \
+    _qlog_callsite_ex(logger, tag, LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+
+#define qlog_dbg_ex(logger, tag, fmt, ...) \
+    _qlog_callsite_ex(logger, tag, LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+
 #undef TAG_NAME
 #undef loge
 #undef logi
 #undef logd
 #undef logw
+#undef loge_ex
+#undef logi_ex
+#undef logd_ex
+#undef logw_ex
 
 #define loge(fmt, ...) \
     qlog_err(TAG_NAME, fmt, ##__VA_ARGS__)
@@ -67,6 +296,18 @@ typedef struct logger logger_t;
 
 #define logd(fmt, ...) \
     qlog_dbg(TAG_NAME, fmt, ##__VA_ARGS__)
+
+#define loge_ex(logger, fmt, ...) \
+    qlog_err_ex(logger, TAG_NAME, fmt, ##__VA_ARGS__)
+
+#define logw_ex(logger, fmt, ...) \
+    qlog_warn_ex(logger, TAG_NAME, fmt, ##__VA_ARGS__)
+
+#define logi_ex(logger, fmt, ...) \
+    qlog_info_ex(logger, TAG_NAME, fmt, ##__VA_ARGS__)
+
+#define logd_ex(logger, fmt, ...) \
+    qlog_dbg_ex(logger, TAG_NAME, fmt, ##__VA_ARGS__)
     
 
 /**
@@ -81,13 +322,52 @@ typedef struct logger logger_t;
 logger_t *qlog_init(level_t level, bool color, bool timestamp, size_t tag_count);
 
 /**
- * @brief   append a tag to filter list.
- * @param   tag is pointer to the tag.
+ * @brief   set the level of a tag, the tag is interned at the first time.
+ * @param   tag is pointer to the tag, shorter than {@code SIZE_OF_NAME}.
  * @param   level is level of the tag.
- * @note    logs with this tag will be filtered later.
+ * @note    once any tag is set, only logs with the tags set will be output. the level of a
+ *          tag overrides the global level, which still applies to the logs without tag.
+ *          it can be called at runtime, and the level of a tag can be raised or lowered.
  */
 void qlog_filter(const char *tag, level_t level);
 
+/**
+ * @brief   set the global level of log.
+ * @param   level is the new global level.
+ */
+void qlog_setLevel(level_t level);
+
+/**
+ * @brief   limit the rate of the logs of a tag with a token bucket.
+ * @param   tag is pointer to the tag, shorter than {@code SIZE_OF_NAME}.
+ * @param   rate is the logs per second, 0 means unlimited.
+ * @param   burst is the logs allowed at once, 0 means 1.
+ * @return  false if too many tags are limited, see {@code COUNT_OF_LIMIT_TAG}.
+ * @note    the logs beyond the limit are dropped before they are formatted, and their
+ *          count is output with the next log of the tag allowed.
+ */
+bool qlog_limit(const char *tag, uint32_t rate, uint32_t burst);
+
+/**
+ * @brief   limit the rate of the logs of each callsite with its own token bucket.
+ * @param   rate is the logs per second, 0 means unlimited.
+ * @param   burst is the logs allowed at once, 0 means 1.
+ * @note    a callsite is identified by its format string, the callsites beyond
+ *          {@code COUNT_OF_LIMIT_SITE} may not be limited.
+ */
+void qlog_limitCallsite(uint32_t rate, uint32_t burst);
+
+/**
+ * @brief   set the suppression of repeated logs enable or disable.
+ * @param   enable true means a log from the same callsite with the same arguments as
+ *          the last one is counted instead of output, and "last message repeated N times"
+ *          is output before the next different log, or after {@code LIMIT_REPEAT_INTERVAL}.
+ * @note    the repeats are found by hashing the raw arguments before formatting, logs
+ *          whose format can not be deferred are never suppressed. the counts not reported
+ *          yet are output by the periodic dump, see {@code qlog_setStatsInterval}.
+ */
+void qlog_setRepeatSuppression(bool enable);
+
 /**
  * @brief   qlog api for output log. 
  * @param   tag is tag of current log.
@@ -96,11 +376,340 @@ void qlog_filter(const char *tag, level_t level);
  */
 void qlog(const char *tag, level_t level, const char *format, ...) __attribute__((format(printf, 3, 4)));
 
+/**
+ * @brief   get the callsites of the qlog_xxx macros in the program, including those not
+ *          reached yet.
+ * @param   count is where the number of callsites is returned.
+ * @return  the callsites, NULL if there is none.
+ */
+const qlog_site_t *qlog_callsites(size_t *count);
+
+/**
+ * @brief   get the id of a callsite, the same in each run of the same program, it is the id
+ *          of the callsite in the log files of binary writer.
+ * @return  the id, 0 if it is not a callsite of the qlog_xxx macros.
+ */
+uint32_t qlog_callsiteId(const qlog_site_t *site);
+
+/**
+ * @brief   turn on or off the callsites at a location, a callsite turned off outputs nothing.
+ * @param   file is the file of the callsites, matched against the trailing components of
+ *          their __FILE__, e.g. "b.c" matches "a/b.c", NULL means any file.
+ * @param   line is the line of the callsites, 0 means any line.
+ * @param   enable is true to turn them on.
+ * @return  the number of callsites matched.
+ */
+uint32_t qlog_setCallsite(const char *file, uint32_t line, bool enable);
+
+/**
+ * @brief   set the clock source and the precision of timestamp.
+ * @param   clock is the clock source, {@code LOG_CLOCK_TSC} falls back to
+ *          {@code LOG_CLOCK_MONOTONIC} if the cpu counter is not supported.
+ * @param   precision is the precision of the fraction of second.
+ */
+void qlog_setClock(log_clock_t clock, log_precision_t precision);
+
+/**
+ * @brief   set the layout of logs, it may be changed while other threads are logging.
+ * @param   pattern is the layout pattern, NULL means the default one "[%d ]%L/%T: %m".
+ *          %d timestamp, %L level letter, %l level name, %T tag, %t thread id, %N thread name,
+ *          %p process id, %n sequence number, %c cpu ("-" if unknown), %m message, %% a '%'.
+ * @return  false if the pattern is invalid or out of memory, and the layout is not changed.
+ * @note    the logs captured before are still rendered by the layout they are captured for,
+ *          which is kept until the logger is destroyed.
+ */
+bool qlog_setLayout(const char *pattern);
+
+/**
+ * @brief   set the name of the calling thread shown by %N, the name of the thread in the
+ *          system is not changed.
+ * @param   name is the name, it is cut off to {@code SIZE_OF_THREAD_NAME} bytes, NULL means
+ *          the name given by the system, read again, e.g. after pthread_setname_np.
+ * @note    the id and the name of a thread are read once, at its first log, and kept as text.
+ */
+void qlog_setThreadName(const char *name);
+
 void qlog_setConsoleWriter(bool enable);
 void qlog_setFileWriter(bool enable);
 void qlog_registerWriter(void *writer);
 void qlog_registerFileWriter(const char *name, const char *dir, int numberOfFiles, int sizeOfFile);
 
+/**
+ * @brief   register a writer copying logs into memory-mapped log files, it is disabled
+ *          until {@code qlog_setMmapWriter(true)}.
+ * @param   name is the name of log file.
+ * @param   dir is the directory of log file.
+ * @param   numberOfFiles is the number of log files.
+ * @param   sizeOfFile is size of log file, each log file is preallocated to it, it must hold
+ *          the longest log, {@code SIZE_OF_LOG_TEXT} (8 KB by default).
+ * @note    logs written survive a crash of the process, the file is truncated to its
+ *          content when it is rotated or closed at exit.
+ */
+void qlog_registerMmapWriter(const char *name, const char *dir, int numberOfFiles, int sizeOfFile);
+void qlog_setMmapWriter(bool enable);
+
+/**
+ * @brief   register a writer storing logs as binary frames, it is disabled until
+ *          {@code qlog_setBinaryWriter(true)}.
+ * @param   name is the name of log file, the suffix is ".qlb".
+ * @param   dir is the directory of log file.
+ * @param   numberOfFiles is the number of log files.
+ * @param   sizeOfFile is the maximum size of log file, at least 2 * {@code SIZE_OF_BINARY_LOG}.
+ * @note    a log only carries the ids of its format string and tag and its raw arguments,
+ *          so the format strings must be string literals as in asynchronous deferred mode.
+ *          the files are converted to text by tools/qlog_decode.c.
+ */
+void qlog_registerBinaryWriter(const char *name, const char *dir, int numberOfFiles, int sizeOfFile);
+void qlog_setBinaryWriter(bool enable);
+
+/**
+ * @brief   register a flight recorder keeping the latest logs in memory, it is disabled
+ *          until {@code qlog_setFlightWriter(true)}.
+ * @param   name is the name of the file dumped to, the suffix is ".flight".
+ * @param   dir is the directory of the file dumped to.
+ * @param   size is the size of the ring in bytes, 0 means {@code SIZE_OF_FLIGHT_RING}.
+ * @return  false if out of memory.
+ * @note    recording a log is only a copy of its raw arguments into the ring, where the
+ *          oldest logs are overwritten. the ring is rendered and appended to the file by a
+ *          FATAL log, by {@code qlog_dumpFlightWriter}, by the signal set by
+ *          {@code qlog_setFlightSignal}, and at crash if {@code qlog_setCrashHandler} is set.
+ *          to record DEBUG logs without writing them elsewhere, set the level of the logger
+ *          to DEBUG and that of the other writers higher by {@code qlog_setWriterLevel}.
+ */
+bool qlog_registerFlightWriter(const char *name, const char *dir, size_t size);
+void qlog_setFlightWriter(bool enable);
+
+/**
+ * @brief   dump the logs in the ring of flight recorder to its file, and empty the ring.
+ * @return  false if the flight recorder is not registered or the file can not be opened.
+ */
+bool qlog_dumpFlightWriter(void);
+
+/**
+ * @brief   register a socket writer sending logs to a local collector, it is disabled until
+ *          {@code qlog_setSocketWriter(true)}.
+ * @param   transport is the transport of the socket.
+ * @param   address is the path of a unix socket, e.g. "/dev/log", or "host:port" of UDP
+ *          and TCP, e.g. "127.0.0.1:514" or "[::1]:514".
+ * @param   framing is how a log is framed, the trailing line breaks of a log are removed.
+ * @param   size is the size of the ring in bytes, 0 means {@code SIZE_OF_SOCKET_RING}.
+ * @return  false if the address is invalid or out of memory.
+ * @note    a log is only framed into the ring by the caller, a sender thread sends the
+ *          logs in batches, by one sendmmsg on datagram sockets, or by one gathering send
+ *          on stream sockets. while the collector is unavailable, the logs are kept in the
+ *          ring, the newest ones are dropped once it is full and counted in the {@code
+ *          dropped} of the writer, and the sender reconnects with a backoff doubling from
+ *          {@code SOCKET_RETRY_MIN} to {@code SOCKET_RETRY_MAX} ms. the logs left at exit are
+ *          dropped if the collector is still unavailable.
+ */
+bool qlog_registerSocketWriter(log_socket_t transport, const char *address, log_framing_t framing, size_t size);
+void qlog_setSocketWriter(bool enable);
+
+/**
+ * @brief   set the signal dumping the flight recorders of all the loggers.
+ * @param   sig is the signal, e.g. SIGUSR1, 0 means none.
+ * @return  false if the handler can not be installed.
+ * @note    the handler only wakes the dumper thread of each flight recorder.
+ */
+bool qlog_setFlightSignal(int sig);
+
+/**
+ * @brief   set the rotation policy of file writer, mmap writer and binary writer.
+ * @param   interval is the seconds between rotations, aligned to the wall clock, 0 means
+ *          rotating by size only.
+ * @param   budget is the maximum total size of the segments of a log file, 0 means only
+ *          the number of files is limited.
+ * @note    logs are written to $(logfile).log.$(sequence), a rotation opens the next sequence
+ *          without renaming, the oldest segments are deleted in background.
+ */
+void qlog_setRotation(uint32_t interval, uint64_t budget);
+
+/**
+ * @brief   set the buffers and the flush policy of file writer.
+ * @param   sizeOfBuffer is the size of each buffer, 0 means {@code SIZE_OF_FILE_BUFFER}.
+ * @param   numberOfBuffers is the number of buffers, 0 means {@code COUNT_OF_FILE_BUFFER}.
+ * @param   interval is the maximum time in ms a log stays in buffer.
+ * @param   level is the level at or above which a log is written at once.
+ * @return  false if out of memory.
+ * @note    the buffers are written by a background flusher when full, when the oldest
+ *          log is older than {@code interval}, or when a log at or above {@code level} comes.
+ */
+bool qlog_setFilePolicy(size_t sizeOfBuffer, uint32_t numberOfBuffers, uint32_t interval, level_t level);
+
+/**
+ * @brief   put a bounded queue and a worker in front of a writer, so that a slow writer
+ *          only delays its own logs instead of the other writers and the logging threads.
+ * @param   name is the name of the writer, "console", "file", "mmap", "binary", or the
+ *          name of a writer registered by {@code qlog_registerWriter}.
+ * @param   size is the size of the queue in bytes, 0 means {@code SIZE_OF_WRITER_QUEUE}.
+ * @param   policy is what to do when the queue is full.
+ * @param   level is the level of {@code LOG_QUEUE_DROP_BELOW_LEVEL}, the logs at or above
+ *          it wait for room, and the others are dropped.
+ * @return  false if the writer is not registered, it is queued already, or out of memory.
+ * @note    a writer is queued once and stays queued. the logs dropped are counted in the
+ *          {@code dropped} of the writer, see {@code qlog_stats}, and the logs queued are
+ *          written at exit.
+ */
+bool qlog_setWriterQueue(const char *name, size_t size, log_queue_policy_t policy, level_t level);
+
+/**
+ * @brief   set the level of a writer, the logs less important than it are skipped by the
+ *          writer, and the other writers still take them.
+ * @param   name is the name of the writer, as {@code qlog_setWriterQueue} takes.
+ * @param   level is the level of the writer, {@code LOG_LEVEL_DEBUG} means all the logs.
+ * @return  false if the writer is not registered.
+ * @note    it only narrows the level of logger, a log is not formatted if no writer takes it
+ *          as text, e.g. the DEBUG logs only recorded by the flight recorder.
+ */
+bool qlog_setWriterLevel(const char *name, level_t level);
+
+/**
+ * @brief   switch the logger to asynchronous mode.
+ * @param   numberOfRecords is the number of records in the ring of each thread,
+ *          0 means {@code COUNT_OF_ASYNC_RECORD}.
+ * @note    logs are formatted by the calling thread and written by a background thread,
+ *          all the pending logs are written when {@code qlog_stopAsync} is called or at exit.
+ */
+void qlog_startAsync(size_t numberOfRecords);
+
+/**
+ * @brief   write all the pending logs and switch the logger back to synchronous mode.
+ */
+void qlog_stopAsync(void);
+
+/**
+ * @brief   set deferred formatting enable or disable.
+ * @param   enable true means the calling thread only captures the format string and
+ *          the raw arguments, and the text is rendered by the background thread.
+ * @note    it takes effect in asynchronous mode only, the format string must be a string
+ *          literal (as the qlog_xxx macros use), and formats which can not be deferred
+ *          (%n, %m, %ls, positional arguments) are formatted on the calling thread.
+ */
+void qlog_setDeferred(bool enable);
+
+/**
+ * @brief   take a snapshot of the counters of logger and its writers.
+ * @param   stats is where the snapshot is written to.
+ * @note    the counters are updated with relaxed atomics, so the fields are not taken
+ *          at exactly the same instant. logs rejected by the cached state of a callsite
+ *          cost nothing and are not counted as filtered.
+ */
+void qlog_stats(log_stats_t *stats);
+
+/**
+ * @brief   dump the counters through the logger periodically, with the tag "qlog".
+ * @param   interval is the seconds between dumps, 0 means stop dumping.
+ * @note    the counts of logs suppressed by the rate limits or as repeats and not
+ *          reported yet are output as well.
+ */
+void qlog_setStatsInterval(uint32_t interval);
+
+/**
+ * @brief   load a config file of levels per tag, writers and rate limits, and apply it.
+ * @param   path is the path of the config file, e.g.
+ *
+ *              level = info
+ *              tag.net = debug         # the tags given replace all the tags filtered.
+ *              tag.* = warning         # the other tags, off filters them out (default).
+ *              writer.console = off
+ *              writer.file.level = warning
+ *              limit.tag.net = 100/20  # logs per second, and the burst.
+ *              limit.callsite = 10
+ *              repeat = on
+ *
+ * @return  false if the file can not be read or is invalid, the logger is unchanged then.
+ * @note    the settings not given are left as they are, except those given by the config
+ *          loaded last, which are reset, a writer turned on or off by it is turned on. the
+ *          level of a tag overrides the global level. the logging threads never take a
+ *          lock to see it.
+ */
+bool qlog_loadConfig(const char *path);
+
+/**
+ * @brief   load a config file, and reload it each time it is written or replaced.
+ * @param   path is the path of the config file, NULL means stop watching.
+ * @return  false if the file is invalid or can not be watched.
+ * @see     {@code qlog_loadConfig}
+ */
+bool qlog_watchConfig(const char *path);
+
+/**
+ * @brief   set the crash handler of SIGSEGV, SIGABRT, SIGBUS and SIGFPE enable or disable.
+ * @param   enable true means the logs buffered or queued by all the loggers are written
+ *          straight to their files at crash, followed by a crash mark, and the signal is
+ *          raised again to the handler replaced.
+ * @return  false if a handler can not be installed.
+ * @note    only async-signal-safe calls are made at crash, so the logs captured for deferred
+ *          formatting and not rendered yet are counted in the mark instead, and the logs
+ *          buffered by stdio for console are lost. the handler runs on an alternate stack
+ *          in the thread enabling it, so a stack overflow of that thread is caught too.
+ */
+bool qlog_setCrashHandler(bool enable);
+
+/**
+ * @brief   create a logger with its own filter, formatter, writers and lock, so that it
+ *          never contends with the other loggers.
+ * @param   level is the global level of log.
+ * @param   color means wether to output log with color.
+ * @param   timestamp means wether to output log with timestamp.
+ * @param   tag_count is the number of tag.
+ * @return  the logger, NULL if out of memory. it has a console writer enabled, like the
+ *          default logger initialised by {@code qlog_init}.
+ * @note    the logger is configured by the _ex functions below, and logs are output by
+ *          the _ex macros, e.g. {@code qlog_info_ex(logger, tag, fmt, ...)}.
+ */
+logger_t *qlog_create(level_t level, bool color, bool timestamp, size_t tag_count);
+
+/**
+ * @brief   destroy a logger created by {@code qlog_create}.
+ * @param   logger is the logger to destroy.
+ * @note    the pending logs are written and the log files are closed. no other thread may
+ *          use the logger any more, the writers registered by {@code qlog_registerWriter_ex}
+ *          are left to the caller.
+ */
+void qlog_destroy(logger_t *logger);
+
+/**
+ * the functions below do the same as those without _ex to the logger given, a NULL logger
+ * means the default logger initialised by {@code qlog_init}.
+ */
+void qlog_ex(logger_t *logger, const char *tag, level_t level, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+void qlog_filter_ex(logger_t *logger, const char *tag, level_t level);
+void qlog_setLevel_ex(logger_t *logger, level_t level);
+bool qlog_limit_ex(logger_t *logger, const char *tag, uint32_t rate, uint32_t burst);
+void qlog_limitCallsite_ex(logger_t *logger, uint32_t rate, uint32_t burst);
+void qlog_setRepeatSuppression_ex(logger_t *logger, bool enable);
+void qlog_setClock_ex(logger_t *logger, log_clock_t clock, log_precision_t precision);
+bool qlog_setLayout_ex(logger_t *logger, const char *pattern);
+void qlog_setConsoleWriter_ex(logger_t *logger, bool enable);
+void qlog_setFileWriter_ex(logger_t *logger, bool enable);
+void qlog_registerWriter_ex(logger_t *logger, void *writer);
+void qlog_registerFileWriter_ex(logger_t *logger, const char *name, const char *dir, int numberOfFiles, int sizeOfFile);
+void qlog_registerMmapWriter_ex(logger_t *logger, const char *name, const char *dir, int numberOfFiles, int sizeOfFile);
+void qlog_setMmapWriter_ex(logger_t *logger, bool enable);
+void qlog_registerBinaryWriter_ex(logger_t *logger, const char *name, const char *dir, int numberOfFiles, int sizeOfFile);
+void qlog_setBinaryWriter_ex(logger_t *logger, bool enable);
+bool qlog_registerFlightWriter_ex(logger_t *logger, const char *name, const char *dir, size_t size);
+void qlog_setFlightWriter_ex(logger_t *logger, bool enable);
+bool qlog_dumpFlightWriter_ex(logger_t *logger);
+bool qlog_registerSocketWriter_ex(logger_t *logger, log_socket_t transport, const char *address,
+                                  log_framing_t framing, size_t size);
+void qlog_setSocketWriter_ex(logger_t *logger, bool enable);
+void qlog_setRotation_ex(logger_t *logger, uint32_t interval, uint64_t budget);
+bool qlog_setWriterQueue_ex(logger_t *logger, const char *name, size_t size,
+                            log_queue_policy_t policy, level_t level);
+bool qlog_setWriterLevel_ex(logger_t *logger, const char *name, level_t level);
+bool qlog_setFilePolicy_ex(logger_t *logger, size_t sizeOfBuffer, uint32_t numberOfBuffers,
+                           uint32_t interval, level_t level);
+void qlog_startAsync_ex(logger_t *logger, size_t numberOfRecords);
+void qlog_stopAsync_ex(logger_t *logger);
+void qlog_setDeferred_ex(logger_t *logger, bool enable);
+void qlog_stats_ex(logger_t *logger, log_stats_t *stats);
+void qlog_setStatsInterval_ex(logger_t *logger, uint32_t interval);
+bool qlog_loadConfig_ex(logger_t *logger, const char *path);
+bool qlog_watchConfig_ex(logger_t *logger, const char *path);
+
 
 #ifdef __cplusplus
 }
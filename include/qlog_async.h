@@ -0,0 +1,75 @@
+/**
+ * @file    qlog_async.h
+ * @author  qufeiyan
+ * @brief   Define an asynchronous backend for logger.
+ * @version 1.0.0
+ * @date    2026/10/18 09:12:40
+ * @version Copyright (c) 2023
+ */
+
+/* Define to prevent recursive inclusion ---------------------------------------------------*/
+#ifndef __QLOG_ASYNC_H
+#define __QLOG_ASYNC_H
+/* Include ---------------------------------------------------------------------------------*/
+#include "qlog.h"
+#include "qlog_port.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct asyncRecord{
+    int32_t length;                 //! length of the formatted log.
+    level_t level;                  //! level of the log.
+    bool deferred;                  //! buffer holds a {@code deferredRecord_t} to be formatted by backend.
+    char *text;                     //! the log if it is longer than the buffer, released by backend.
+    char buffer[SIZE_OF_LOG_BUFFER] __attribute__((aligned(MEMORY_ALIGN)));
+};
+typedef struct asyncRecord asyncRecord_t;
+
+/**
+ * single-producer single-consumer ring, the owner thread is the only producer
+ * and the backend thread is the only consumer.
+ */
+struct asyncRing{
+    uint32_t head __attribute__((aligned(SIZE_OF_CACHE_LINE))); //! next record to consume.
+    uint32_t tail __attribute__((aligned(SIZE_OF_CACHE_LINE))); //! next record to produce.
+    uint32_t mask;                  //! number of records - 1.
+    bool closed;                    //! the owner thread has exited.
+    struct asyncLogger *async;      //! the asynchronous logger owning the ring.
+    struct asyncRing *next;
+    asyncRecord_t records[];
+};
+typedef struct asyncRing asyncRing_t;
+
+struct asyncLogger{
+    logger_t *logger;
+    uint32_t numberOfRecords;       //! number of records in the ring of each thread.
+
+    pthread_key_t key;              //! ring of the current thread.
+    pthread_t backend;
+    pthread_mutex_t ringsLock;      //! protect the ring list against the producers adding rings.
+    asyncRing_t *rings;
+    bool running;
+
+    uint32_t producers;             //! threads touching their rings, the rings are freed at zero.
+    bool stopped;                   //! the producers fall back to {@code run}, set before quiescing.
+
+    //! the synchronous run method of logger, restored when stop.
+    void (*run)(struct logger *logger, const qlog_site_t *site, const char *tag, level_t level,
+                const char *fmt, va_list args);
+};
+typedef struct asyncLogger asyncLogger_t;
+
+void asyncLoggerInit(asyncLogger_t *async, logger_t *logger, uint32_t numberOfRecords);
+void asyncLoggerDeInit(asyncLogger_t *async);
+uint32_t asyncLoggerEmergency(asyncLogger_t *async);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	//  __QLOG_ASYNC_H
@@ -0,0 +1,134 @@
+/**
+ * @file    qlog_binaryWriter.h
+ * @author  qufeiyan
+ * @brief   Define a writer storing logs as compact binary frames, see tools/qlog_decode.c.
+ * @version 1.0.0
+ * @date    2026/10/18 20:05:18
+ * @version Copyright (c) 2023
+ */
+
+/* Define to prevent recursive inclusion ---------------------------------------------------*/
+#ifndef __QLOG_BINARYWRITER_H
+#define __QLOG_BINARYWRITER_H
+/* Include ---------------------------------------------------------------------------------*/
+#include "qlog.h"
+#include "qlog_port.h"
+#include "qlog_segment.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * each segment starts with a header, followed by frames:
+ *
+ *      header: "QLGB", version, byte order, sizeof(long, void *, size_t, intmax_t,
+ *              ptrdiff_t, long double), 4 reserved bytes, the realtime of the segment in ns.
+ *      frame:  type (1 byte), varint length of payload, payload, crc32 of all the above.
+ *
+ * the payloads of frames:
+ *
+ *      BINARY_FRAME_FORMAT:    varint id, format string.
+ *      BINARY_FRAME_TAG:       varint id, tag string.
+ *      BINARY_FRAME_LOG:       zigzag varint ns since the last log, level (1 byte),
+ *                              varint tag id, varint format id, raw arguments.
+ *      BINARY_FRAME_TEXT:      zigzag varint ns since the last log, level (1 byte), text.
+ *      BINARY_FRAME_SITE:      varint format id, varint callsite id, location '\0', format string.
+ *
+ * the ids of formats and tags are defined in the segment before the first use, so each
+ * segment is decoded on its own. a format of a callsite of the qlog_xxx macros is defined
+ * with its location, which is put before the message, and the id of {@code qlog_callsiteId}.
+ * the raw arguments are those of {@code deferredCapture}, in the byte order and sizes of
+ * the header.
+ */
+#define BINARY_MAGIC            "QLGB"
+#define BINARY_VERSION          (2)     //! version 1 has no BINARY_FRAME_SITE.
+#define SIZE_OF_BINARY_HEADER   (24)
+#define SIZE_OF_BINARY_VARINT   (10)    //! maximum size of a varint of 64 bits.
+#define SIZE_OF_BINARY_FRAME    (1 + SIZE_OF_BINARY_VARINT + 4)     //! frame without payload.
+//! the most bytes a log takes, with the frames defining its format string and tag.
+#define SIZE_OF_BINARY_LOG      (SIZE_OF_LOG_BUFFER + SIZE_OF_LOG_TEXT + SIZE_OF_NAME + \
+                                 3 * (SIZE_OF_BINARY_FRAME + 3 * SIZE_OF_BINARY_VARINT + 1))
+
+enum binaryFrame{
+    BINARY_FRAME_FORMAT = 1,
+    BINARY_FRAME_TAG,
+    BINARY_FRAME_LOG,
+    BINARY_FRAME_TEXT,
+    BINARY_FRAME_SITE,
+};
+
+/**
+ * a format string, interned by its address, or by the address of its callsite.
+ */
+struct binaryFormat{
+    const void *key;
+    uint32_t id;
+    uint32_t epoch;                 //! the entry is empty unless it is the current epoch.
+};
+
+/**
+ * a tag, interned by its content.
+ */
+struct binaryTag{
+    uint32_t hash;
+    uint32_t id;
+    uint32_t epoch;                 //! the entry is empty unless it is the current epoch.
+    char tag[SIZE_OF_NAME];
+};
+
+/**
+ * the logs are written as frames to $(logfile).qlb.$(sequence), the format strings and
+ * the tags are written once per segment, and a log only carries their ids and the raw
+ * arguments. a log whose arguments are not captured is written as text.
+ */
+struct binaryWriter{
+    writer_t super;
+
+    char filePath[SIZE_OF_FILE_PATH];
+    char directory[SIZE_OF_FILE_PATH];
+    int numberOfFiles;
+    int sizeOfFile;
+
+    int fd;                         //! current log file, -1 if not opened.
+    int positionToWrite;            //! bytes written to current log file, including {@code buffer}.
+    segment_t segment;              //! the segments of log file.
+    formatter_t *formatter;         //! converts the time of logs and renders the text.
+
+    char *buffer;                   //! frames not written yet.
+    int32_t length;                 //! length of {@code buffer}.
+    int32_t sizeOfBuffer;
+    uint64_t firstTime;             //! realtime in ns of the first log in {@code buffer}.
+    uint64_t lastTime;              //! realtime in ns of the last log.
+    bool running;                   //! false after deInit, each log is written at once.
+
+    struct binaryFormat formats[COUNT_OF_BINARY_FORMAT];
+    struct binaryTag tags[COUNT_OF_BINARY_TAG];
+    uint32_t numberOfFormats;
+    uint32_t numberOfTags;
+    uint32_t epoch;                 //! changes when a segment is opened.
+
+    void (*fileRotate)(struct binaryWriter *);
+};
+typedef struct binaryWriter binaryWriter_t;
+
+void binaryWriterInit(writer_t *writer, char *buffer, formatter_t *formatter, const char *fileName,
+                      const char *directory, int numberOfFiles, int sizeOfFile);
+
+/**
+ * @brief   update a crc32 (IEEE 802.3).
+ * @param   crc is the crc of the data before, 0 at the beginning.
+ * @param   data is the data to check.
+ * @param   size is the size of {@code data}.
+ * @return  the crc of all the data.
+ */
+uint32_t binaryCrc32(uint32_t crc, const void *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	//  __QLOG_BINARYWRITER_H
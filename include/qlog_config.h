@@ -0,0 +1,158 @@
+/**
+ * @file    qlog_config.h
+ * @author  qufeiyan
+ * @brief   Define the config file of a logger, and the watcher applying it once it changes.
+ * @version 1.0.0
+ * @date    2026/10/19 02:41:06
+ * @version Copyright (c) 2023
+ */
+
+/* Define to prevent recursive inclusion ---------------------------------------------------*/
+#ifndef __QLOG_CONFIG_H
+#define __QLOG_CONFIG_H
+/* Include ---------------------------------------------------------------------------------*/
+#include "qlog.h"
+#include "qlog_def.h"
+#include "qlog_port.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONFIG_UNSET            (-1)    //! the setting is not given, it is left as it is.
+
+/**
+ * the settings of a writer.
+ */
+struct configWriter{
+    char name[SIZE_OF_NAME];
+    int8_t enable;                  //! 1 on, 0 off, {@code CONFIG_UNSET} if not given.
+    int8_t level;                   //! level of the writer, {@code CONFIG_UNSET} if not given.
+};
+
+/**
+ * the rate limit of a tag.
+ */
+struct configLimit{
+    char tag[SIZE_OF_NAME];
+    uint32_t rate;                  //! logs per second.
+    uint32_t burst;                 //! logs allowed at once.
+};
+
+/**
+ * the settings of a config file, one per line as "key = value", '#' starts a comment:
+ *
+ *      level = info                    the global level, a tag given a level is not bound by it.
+ *      tag.<tag> = debug               the level of a tag, the tags given replace all the
+ *                                      tags of the filter, those not given are removed.
+ *      tag.* = warning|off             the level of the tags not given, off filters them
+ *                                      out, which is the default once any tag is given.
+ *      writer.<name> = on|off          e.g. writer.console = off.
+ *      writer.<name>.level = error     the level of a writer.
+ *      limit.tag.<tag> = 100[/20]      logs per second of a tag, and the burst.
+ *      limit.callsite = 10[/5]         logs per second of each callsite, and the burst.
+ *      repeat = on|off                 suppression of repeated logs.
+ *
+ * levels are fatal, error, warning (or warn), info and debug. a tag, a writer level, a
+ * writer turned on or off or a limit given by the config applied last and missing from
+ * the new one is reset, a writer is turned on then.
+ */
+struct config{
+    int32_t level;                  //! global level, {@code CONFIG_UNSET} if not given.
+    int32_t others;                 //! level of the tags not given, {@code FILTER_LEVEL_NONE} if not given.
+    bool tagged;                    //! any tag is given, including "tag.*".
+    uint32_t numberOfTags;
+    char tags[COUNT_OF_TAG][SIZE_OF_NAME];
+    level_t levels[COUNT_OF_TAG];
+
+    uint32_t numberOfWriters;
+    struct configWriter writers[COUNT_OF_CONFIG_WRITER];
+
+    uint32_t numberOfLimits;
+    struct configLimit limits[COUNT_OF_LIMIT_TAG / 2];
+    bool siteLimited;               //! the limit of callsites is given.
+    uint32_t siteRate;
+    uint32_t siteBurst;
+
+    int8_t repeat;                  //! 1 on, 0 off, {@code CONFIG_UNSET} if not given.
+};
+typedef struct config config_t;
+
+/**
+ * applies a config to a logger.
+ * @param context is the context given to {@code configWatcherInit}.
+ * @param previous is the config applied last, all unset if none.
+ * @param config is the config to apply.
+ */
+typedef void (*configApply_t)(void *context, const config_t *previous, const config_t *config);
+
+/**
+ * loads a config file, and reloads it from a thread each time it is written or replaced.
+ * the file is parsed aside and applied only if it is valid, so a logger never sees a
+ * config half written.
+ */
+struct configWatcher{
+    configApply_t apply;
+    void *context;
+    pthread_mutex_t mutex;          //! serialize the loads, protect {@code applied}.
+    config_t applied;               //! the config applied last.
+
+    char path[SIZE_OF_CONFIG_PATH]; //! the file watched.
+    pthread_t watcher;
+    int inotify;                    //! watches the directory of the file, so it may be replaced.
+    int wakeup[2];                  //! a pipe waking the watcher up to stop.
+    bool running;
+};
+typedef struct configWatcher configWatcher_t;
+
+/**
+ * @brief   initialise a config with all the settings unset.
+ */
+void configInit(config_t *config);
+
+/**
+ * @brief   parse a config file.
+ * @param   config is where the settings are written to.
+ * @param   path is the path of the file.
+ * @return  false if the file can not be read or is invalid, the error is printed to stderr.
+ */
+bool configParse(config_t *config, const char *path);
+
+/**
+ * @brief   initialise a config watcher.
+ * @param   watcher is pointer to config watcher.
+ * @param   apply applies a config to the logger.
+ * @param   context is passed to {@code apply}.
+ */
+void configWatcherInit(configWatcher_t *watcher, configApply_t apply, void *context);
+void configWatcherDeInit(configWatcher_t *watcher);
+
+/**
+ * @brief   parse a config file and apply it.
+ * @param   watcher is pointer to config watcher.
+ * @param   path is the path of the file.
+ * @return  false if the file can not be read or is invalid, nothing is applied then.
+ */
+bool configWatcherLoad(configWatcher_t *watcher, const char *path);
+
+/**
+ * @brief   load a config file, then reload it each time it changes.
+ * @param   watcher is pointer to config watcher.
+ * @param   path is the path of the file, the file watched before is no longer watched.
+ * @return  false if the path is too long, the file is invalid or it can not be watched.
+ */
+bool configWatcherStart(configWatcher_t *watcher, const char *path);
+
+/**
+ * @brief   stop watching, it does nothing if the watcher is not started.
+ */
+void configWatcherStop(configWatcher_t *watcher);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	//  __QLOG_CONFIG_H
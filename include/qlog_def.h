@@ -55,6 +55,9 @@ extern "C" {
 #define __weak __attribute__((weak))
 
 
+//! ends a log cut off, in place of its last bytes.
+#define LOG_TRUNCATION_MARK     " [truncated]\n"
+
 #undef MEMORY_ALIGN_UP
 #define MEMORY_ALIGN_UP(addr, size) ({\
     (((addr) + (size) - 1) & ~((size) - 1));\
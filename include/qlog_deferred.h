@@ -0,0 +1,70 @@
+/**
+ * @file    qlog_deferred.h
+ * @author  qufeiyan
+ * @brief   Capture the raw arguments of a log and format them later.
+ * @version 1.0.0
+ * @date    2026/10/18 11:03:27
+ * @version Copyright (c) 2023
+ */
+
+/* Define to prevent recursive inclusion ---------------------------------------------------*/
+#ifndef __QLOG_DEFERRED_H
+#define __QLOG_DEFERRED_H
+/* Include ---------------------------------------------------------------------------------*/
+#include "qlog.h"
+#include <stdarg.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * a log captured on the hot path, the format string must have static storage
+ * (a string literal, as used by the qlog_xxx macros).
+ */
+struct deferredRecord{
+    logContext_t context;           //! context of the log captured on the calling thread.
+    const qlog_site_t *site;        //! callsite of the log, NULL means none, set by {@code loggerCapture}.
+    const char *format;             //! format string of the log.
+    int32_t size;                   //! size of {@code data}.
+    char data[];                    //! tag string with '\0', followed by the raw arguments.
+};
+typedef struct deferredRecord deferredRecord_t;
+
+/**
+ * @brief   capture the raw arguments of a log.
+ * @param   record is where the log is captured to.
+ * @param   size is the size of {@code record} in bytes.
+ * @param   tag is the tag of the log.
+ * @param   format is the format string of the log.
+ * @param   args is the arguments list, it is consumed.
+ * @return  bytes used by the record, -1 if the arguments do not fit or the format
+ *          can not be deferred (%n, %m, %ls, positional arguments).
+ */
+int32_t deferredCapture(deferredRecord_t *record, int32_t size, const char *tag, const char *format, va_list args);
+
+/**
+ * @brief   format the captured arguments as vsnprintf does.
+ * @param   buffer is where the string is formatted to.
+ * @param   size is the size of {@code buffer}.
+ * @param   format is the format string of the log.
+ * @param   args is the raw arguments captured by {@code deferredCapture}.
+ * @param   sizeOfArgs is the size of {@code args}, nothing beyond it is read.
+ * @return  the length of the whole string, as vsnprintf returns, -1 if the arguments do not
+ *          match the format, e.g. read from a damaged file, the text formatted so far is kept.
+ */
+int32_t deferredFormat(char *buffer, int32_t size, const char *format, const char *args, int32_t sizeOfArgs);
+
+/**
+ * @brief   get the tag of a captured log.
+ */
+static inline const char *deferredTag(const deferredRecord_t *record){
+    return record->data;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	//  __QLOG_DEFERRED_H
@@ -13,12 +13,26 @@
 /* Include ---------------------------------------------------------------------------------*/
 #include "qlog.h"
 #include "qlog_port.h"
+#include "qlog_segment.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#ifndef FILE_FLUSH_LEVEL
+#define FILE_FLUSH_LEVEL        LOG_LEVEL_ERROR //! logs with level <= it are handed to the flusher at once.
+#endif
+
+struct fileBuffer{
+    char *data;
+    int32_t length;                 //! length of the logs buffered.
+};
+typedef struct fileBuffer fileBuffer_t;
+
 struct fileWriter{
     writer_t super;
     
@@ -28,17 +42,46 @@ struct fileWriter{
     int sizeOfFile; 
 
     FILE *file;                     //! current log file pointer.  
+    int fd;                         //! descriptor of {@code file}, -1 if not opened, used at crash.
     int positionToWrite;            //! current position of file to write.
-    int currentNumberOfFiles;      
+    segment_t segment;              //! the segments of log file.
 
-    char fileBuffer[SIZE_OF_FILE_BUFFER];
-    char *ptrBufferCurrent;
+    /**
+     * the buffers are used in turn, the caller fills {@code filling}, the flusher writes
+     * the {@code numberOfReady} full buffers before it, the oldest one first.
+     */
+    fileBuffer_t *buffers;
+    uint32_t numberOfBuffers;
+    int32_t sizeOfBuffer;
+    uint32_t filling;               //! the buffer being filled.
+    uint32_t numberOfReady;         //! number of full buffers waiting to be written.
+    uint64_t firstTime;             //! monotonic time in ns of the first log in the filling buffer.
+    uint32_t interval;              //! maximum time in ms a log stays in the filling buffer.
+    level_t flushLevel;             //! logs with level <= it are handed to the flusher at once.
+
+    pthread_t flusher;
+    pthread_mutex_t mutex;          //! protect the buffers.
+    pthread_cond_t ready;           //! signalled when a buffer is handed to the flusher.
+    pthread_cond_t done;            //! signalled when the flusher has written a buffer.
+    bool running;                   //! false means the caller writes the buffers itself.
 
     void (*fileRotate)(struct fileWriter *);
-    // locker_t *locker;
 };
 typedef struct fileWriter fileWriter_t;
 
+/**
+ * @brief   set the buffers and the flush policy of a file writer.
+ * @param   writer is pointer to file writer.
+ * @param   sizeOfBuffer is the size of each buffer, it is no more than the size of a log file.
+ * @param   numberOfBuffers is the number of buffers, at least 2.
+ * @param   interval is the maximum time in ms a log stays in buffer.
+ * @param   flushLevel is the level at or above which a log is handed to the flusher at once.
+ * @return  false if out of memory, and the writer is not changed.
+ * @note    the logs buffered are written before the buffers are changed.
+ */
+bool fileWriterSetPolicy(writer_t *writer, int32_t sizeOfBuffer, uint32_t numberOfBuffers, 
+                         uint32_t interval, level_t flushLevel);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,99 @@
+/**
+ * @file    qlog_flightWriter.h
+ * @author  qufeiyan
+ * @brief   Define a flight recorder, a writer keeping the latest logs in memory and
+ *          dumping them to a file on demand.
+ * @version 1.0.0
+ * @date    2026/10/19 00:07:52
+ * @version Copyright (c) 2023
+ */
+
+/* Define to prevent recursive inclusion ---------------------------------------------------*/
+#ifndef __QLOG_FLIGHTWRITER_H
+#define __QLOG_FLIGHTWRITER_H
+/* Include ---------------------------------------------------------------------------------*/
+#include "qlog.h"
+#include "qlog_port.h"
+#include "qlog_ring.h"
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FLIGHT_DUMP_LEVEL
+#define FLIGHT_DUMP_LEVEL       LOG_LEVEL_FATAL //! logs with level <= it dump the flight recorder at once.
+#endif
+
+/**
+ * the header of a log in the ring, followed by the record if the arguments are captured,
+ * or by the text otherwise.
+ */
+struct flightEntry{
+    ringEntry_t super;
+    int32_t length;                 //! length of the text, 0 if the record is kept.
+    int32_t sizeOfRecord;           //! bytes of the record, 0 if the text is kept.
+    uint8_t level;
+};
+
+/**
+ * keeps the latest logs in a ring, the oldest ones are overwritten. recording a log is only
+ * a copy of its raw arguments, or of its text if they are not captured, the logs are
+ * rendered when the ring is dumped to $(directory)/$(name).flight, by a log at or above
+ * {@code FLIGHT_DUMP_LEVEL}, by {@code flightWriterDump}, or by the dumper thread when it
+ * is requested from a signal handler.
+ */
+struct flightWriter{
+    writer_t super;
+
+    char filePath[SIZE_OF_FILE_PATH];
+    formatter_t *formatter;         //! renders the records when the ring is dumped.
+
+    ring_t ring;                    //! the latest logs, the oldest is overwritten first.
+    char *output;                   //! the text of a dump is gathered here before written.
+
+    pthread_mutex_t mutex;          //! protect the ring and the dumps.
+    pthread_t dumper;
+    sem_t request;                  //! posted to dump the ring by the dumper, async-signal-safe.
+    const char *reason;             //! the reason of the dump requested.
+    uint32_t dumps;                 //! number of dumps done.
+    bool running;
+};
+typedef struct flightWriter flightWriter_t;
+
+/**
+ * @brief   initialise a flight writer and start its dumper.
+ * @param   writer is pointer to flight writer.
+ * @param   buffer is pointer to log string.
+ * @param   formatter is the formatter of logger, it renders the records.
+ * @param   fileName is the name of the file dumped to.
+ * @param   directory is the directory of the file dumped to.
+ * @param   size is the size of the ring in bytes, it is raised to hold a few logs at least.
+ * @return  false if out of memory.
+ */
+bool flightWriterInit(writer_t *writer, char *buffer, formatter_t *formatter, const char *fileName,
+                      const char *directory, uint32_t size);
+
+/**
+ * @brief   dump the logs in the ring to the file, the oldest first, and empty the ring.
+ * @param   writer is pointer to flight writer.
+ * @param   reason is the reason written in the head of the dump.
+ * @return  false if the file can not be opened.
+ */
+bool flightWriterDump(writer_t *writer, const char *reason);
+
+/**
+ * @brief   ask the dumper to dump the ring, async-signal-safe.
+ * @param   writer is pointer to flight writer.
+ * @param   reason is the reason written in the head of the dump, a string literal.
+ */
+void flightWriterRequest(writer_t *writer, const char *reason);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	//  __QLOG_FLIGHTWRITER_H
@@ -0,0 +1,121 @@
+/**
+ * @file    qlog_limiter.h
+ * @author  qufeiyan
+ * @brief   Define the rate limits and the suppression of repeated logs of a logger.
+ * @version 1.0.0
+ * @date    2026/10/18 22:31:09
+ * @version Copyright (c) 2023
+ */
+
+/* Define to prevent recursive inclusion ---------------------------------------------------*/
+#ifndef __QLOG_LIMITER_H
+#define __QLOG_LIMITER_H
+/* Include ---------------------------------------------------------------------------------*/
+#include "qlog.h"
+#include "qlog_port.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * a token bucket in the form of GCRA, a single word updated by CAS: a log is allowed
+ * unless {@code due} is ahead of now by more than the burst, and each log allowed
+ * pushes {@code due} one interval ahead.
+ */
+struct limitBucket{
+    uint64_t due;                   //! monotonic time in ns when the bucket is full again.
+    uint64_t suppressed;            //! logs suppressed since the last report.
+};
+
+/**
+ * the limit of a tag, {@code hash} is published last so that lock-free readers always
+ * see a complete entry.
+ */
+struct limitTag{
+    uint32_t hash;                  //! hash of the tag, 0 means the entry is empty.
+    uint64_t interval;              //! ns per log, 0 means unlimited.
+    uint64_t tolerance;             //! ns of the burst beyond the first log.
+    struct limitBucket bucket;
+    char tag[SIZE_OF_NAME];
+};
+
+/**
+ * the bucket of a callsite, a callsite is identified by its descriptor, or by its format
+ * string if it has none.
+ */
+struct limitSite{
+    const void *key;                //! the descriptor or the format string, NULL means the entry is empty, claimed by CAS.
+    const qlog_site_t *site;        //! set once claimed, NULL if the callsite has no descriptor.
+    const char *format;             //! set once claimed, after {@code site}.
+    struct limitBucket bucket;
+};
+
+/**
+ * the last log allowed, repeats of it are counted instead of output.
+ */
+struct limitRepeat{
+    uint64_t hash;                  //! hash of the callsite and the raw arguments, 0 if unknown.
+    uint64_t count;                 //! repeats suppressed.
+    uint64_t since;                 //! monotonic time in ns of the first repeat suppressed.
+    level_t level;
+    char tag[SIZE_OF_NAME];
+};
+
+struct limiter{
+    struct limitTag tags[COUNT_OF_LIMIT_TAG];
+    uint32_t numberOfTags;
+    uint64_t siteInterval;          //! ns per log of each callsite, 0 means unlimited.
+    uint64_t siteTolerance;
+    struct limitSite sites[COUNT_OF_LIMIT_SITE];
+
+    bool repeat;                    //! suppress the repeats of the last log.
+    pthread_mutex_t mutex;          //! protect {@code last} and the updates of {@code tags}.
+    struct limitRepeat last;
+
+    //! check whether a log which has passed the filter is output, the reports due are output first.
+    bool (*invoke)(struct limiter *limiter, logger_t *logger, const qlog_site_t *site, const char *tag,
+                   level_t level, const char *format, va_list args);
+    //! output the counts of logs suppressed and not reported yet.
+    void (*report)(struct limiter *limiter, logger_t *logger);
+};
+typedef struct limiter limiter_t;
+
+void limiterInit(limiter_t *limiter);
+void limiterDeInit(limiter_t *limiter);
+
+/**
+ * @brief   set the rate limit of a tag.
+ * @param   limiter is pointer to limiter.
+ * @param   tag is the tag.
+ * @param   rate is the logs per second, 0 means unlimited.
+ * @param   burst is the logs allowed at once, at least 1.
+ * @return  false if there are too many tags.
+ */
+bool limiterSetTag(limiter_t *limiter, const char *tag, uint32_t rate, uint32_t burst);
+
+/**
+ * @brief   set the rate limit of each callsite.
+ * @param   limiter is pointer to limiter.
+ * @param   rate is the logs per second, 0 means unlimited.
+ * @param   burst is the logs allowed at once, at least 1.
+ */
+void limiterSetSite(limiter_t *limiter, uint32_t rate, uint32_t burst);
+
+/**
+ * @brief   set the suppression of repeated logs enable or disable.
+ * @param   limiter is pointer to limiter.
+ * @param   logger is the logger the pending repeats are reported through when disabled.
+ * @param   enable true means the repeats of a log are counted instead of output.
+ */
+void limiterSetRepeat(limiter_t *limiter, logger_t *logger, bool enable);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	//  __QLOG_LIMITER_H
@@ -0,0 +1,52 @@
+/**
+ * @file    qlog_mmapWriter.h
+ * @author  qufeiyan
+ * @brief   Define a writer copying logs into memory-mapped log files.
+ * @version 1.0.0
+ * @date    2026/10/18 16:02:41
+ * @version Copyright (c) 2023
+ */
+
+/* Define to prevent recursive inclusion ---------------------------------------------------*/
+#ifndef __QLOG_MMAPWRITER_H
+#define __QLOG_MMAPWRITER_H
+/* Include ---------------------------------------------------------------------------------*/
+#include "qlog.h"
+#include "qlog_port.h"
+#include "qlog_segment.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * each log file is preallocated to {@code sizeOfFile} and mapped, logs are copied into
+ * the mapping without any syscall. the pages belong to the kernel, so the logs written
+ * survive a crash of the process. the file is truncated to its content when it is closed,
+ * a file left by a crash keeps the zeroed tail.
+ */
+struct mmapWriter{
+    writer_t super;
+
+    char filePath[SIZE_OF_FILE_PATH];
+    char directory[SIZE_OF_FILE_PATH];
+    int numberOfFiles;
+    int sizeOfFile;
+
+    int fd;                         //! current log file, -1 if not opened.
+    char *mapping;                  //! mapping of current log file.
+    int positionToWrite;            //! current position of file to write.
+    segment_t segment;              //! the segments of log file.
+
+    void (*fileRotate)(struct mmapWriter *);
+};
+typedef struct mmapWriter mmapWriter_t;
+
+void mmapWriterInit(writer_t *writer, char *buffer, const char *fileName, const char *directory,
+                    int numberOfFiles, int sizeOfFile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	//  __QLOG_MMAPWRITER_H
@@ -11,32 +11,115 @@
 #ifndef __QLOG_PORT_H
 #define __QLOG_PORT_H
 /* Include ---------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 
-#define COUNT_OF_TAG            (32)    //! maximum number of the filter tag.
+#ifndef COUNT_OF_TAG
+#define COUNT_OF_TAG            (32)    //! maximum number of the filter tag, must be a power of 2.
+#endif
 
 #define SIZE_OF_LOG_BUFFER      (512)   //！ size of the log buffer.
 
+#define SIZE_OF_LOG_BLOCK       (1024)  //! size of the smallest block of the arena holding longer logs.
+
+#define COUNT_OF_LOG_CLASS      (4)     //! number of size classes of the arena, each doubles the last, 0 means none.
+
+#define COUNT_OF_LOG_BLOCK      (4)     //! number of blocks of each size class of the arena.
+
+//! the longest log, a log longer than the log buffer takes a block of the arena, or it is cut off.
+#define SIZE_OF_LOG_TEXT        (COUNT_OF_LOG_CLASS ? SIZE_OF_LOG_BLOCK << (COUNT_OF_LOG_CLASS - 1) : SIZE_OF_LOG_BUFFER)
+
 #define SIZE_OF_FILE_PATH       (64)    //! maximum size of the file name.
 
-// #define SIZE_OF_FILE_BUFFER     (4096)  //! maximum size of the file buffer.
+#define SIZE_OF_FILE_BUFFER     (64 * 1024) //! default size of each buffer of file writer.
+
+#define COUNT_OF_FILE_BUFFER    (2)     //! default number of buffers of file writer.
+
+#define FILE_FLUSH_INTERVAL     (200)   //! default milliseconds a log stays in the buffer of file writer.
+
+#define COUNT_OF_LAYOUT_OP      (16)    //! maximum number of fields and texts in a layout pattern.
+
+#define SIZE_OF_LAYOUT          (64)    //! maximum size of the texts in a layout pattern.
+
+#define SIZE_OF_THREAD_NAME     (16)    //! maximum length of the name of thread shown in logs.
+
+#define COUNT_OF_ASYNC_RECORD   (256)   //! default number of records in the ring of each thread.
+
+#define ASYNC_IDLE_INTERVAL     (1000)  //! microseconds the backend sleeps when all rings are empty.
+
+#define SIZE_OF_CACHE_LINE      (64)
+
+#define COUNT_OF_BINARY_FORMAT  (1024)  //! size of the table of format strings per segment of binary writer, a power of 2.
+
+#define COUNT_OF_BINARY_TAG     (64)    //! size of the table of tags per segment of binary writer, a power of 2.
+
+#define SIZE_OF_WRITER_QUEUE    (256 * 1024)    //! default size of the queue of a writer.
+
+#define COUNT_OF_LIMIT_TAG      (32)    //! size of the table of rate limited tags, a power of 2, half of it is used at most.
+
+#define COUNT_OF_LIMIT_SITE     (512)   //! size of the table of rate limited callsites, a power of 2.
+
+#define LIMIT_REPEAT_INTERVAL   (30)    //! seconds a log repeats before the repeats are reported anyway.
 
-#define SIZE_OF_FILE_BUFFER     (512)
+#define COUNT_OF_STATS_STRIPE   (16)    //! number of stripes of a counter updated without the lock, at most 32.
+
+#define SIZE_OF_FLIGHT_RING     (4 * 1024 * 1024)   //! default size of the ring of flight writer.
+
+#define FLIGHT_CRASH_WAIT       (1000)  //! milliseconds the crash handler waits for the flight writer to dump.
+
+#define SIZE_OF_CRASH_STACK     (64 * 1024) //! size of the alternate stack the crash handler runs on.
+
+#define SIZE_OF_SOCKET_RING     (256 * 1024)    //! default size of the ring of socket writer.
+
+#define COUNT_OF_SOCKET_BATCH   (64)    //! maximum number of logs sent at once by socket writer.
+
+#define SOCKET_FLUSH_INTERVAL   (50)    //! maximum milliseconds a log waits for a batch of socket writer.
+
+#define SOCKET_RETRY_MIN        (100)   //! milliseconds before the first reconnection of socket writer.
+
+#define SOCKET_RETRY_MAX        (30000) //! maximum milliseconds between reconnections, doubled from the minimum.
+
+#define SOCKET_SEND_TIMEOUT     (1000)  //! milliseconds a send or a connect of socket writer may block on a stalled collector.
+
+#define SOCKET_CLOSE_TIMEOUT    (2000)  //! maximum milliseconds socket writer waits for its logs to be sent when stopped.
+
+#define SIZE_OF_CONFIG_PATH     (256)   //! maximum size of the path of the config file watched.
+
+#define COUNT_OF_CONFIG_WRITER  (8)     //! maximum number of writers set in a config file.
+
+struct iovec;
 
 /**
  * @brief   customed console output api.
- * @param   str is the string to output to console. 
- * @note    
- * @see     
+ * @param   segments are the segments of a log to output to console, e.g. color, text, reset.
+ * @param   count is the number of {@code segments}.
+ * @note    the segments of a log should be output at once.
+ * @see     {@code console_puts}
+ */
+void console_write(const struct iovec *segments, int count);
+
+/**
+ * @brief   customed console output api of the ports written before {@code console_write}.
+ * @param   str is the string to output to console, the segments of a log joined.
+ * @note    it has no default, if a port defines it, the default {@code console_write} hands
+ *          each log to it, in pieces of {@code SIZE_OF_LOG_BUFFER} bytes if it is longer.
  */
 void console_puts(const char *str);
 
+/**
+ * @brief   read the cpu counter.
+ * @return  the cpu counter, 0 if it is not supported.
+ */
+uint64_t tsc_read(void);
+
 void *locker_init(void *args);
 void locker_lock(void *args);
+bool locker_trylock(void *args);
 void locker_unlock(void *args);
 void locker_deinit(void *args);
 
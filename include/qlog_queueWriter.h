@@ -0,0 +1,79 @@
+/**
+ * @file    qlog_queueWriter.h
+ * @author  qufeiyan
+ * @brief   Define a writer putting a bounded queue and a worker in front of another writer.
+ * @version 1.0.0
+ * @date    2026/10/18 21:36:14
+ * @version Copyright (c) 2023
+ */
+
+/* Define to prevent recursive inclusion ---------------------------------------------------*/
+#ifndef __QLOG_QUEUEWRITER_H
+#define __QLOG_QUEUEWRITER_H
+/* Include ---------------------------------------------------------------------------------*/
+#include "qlog.h"
+#include "qlog_port.h"
+#include "qlog_ring.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * the header of a log in the queue, followed by the text with '\0' and the record.
+ */
+struct queueEntry{
+    ringEntry_t super;
+    int32_t length;                 //! length of the text.
+    int32_t sizeOfRecord;           //! bytes of the record, 0 if not captured.
+    uint8_t level;
+    bool color;
+};
+
+/**
+ * takes the place of a writer in the chain. a log is copied into the queue and passed to
+ * the next writer at once, the worker writes the logs queued to the writer decorated, so
+ * a slow writer only delays its own logs. the queue is only produced under the lock of
+ * logger, and only consumed by the worker.
+ */
+struct queueWriter{
+    writer_t super;                 //! {@code super.inner} is the writer decorated.
+
+    log_queue_policy_t policy;      //! what to do when the queue is full.
+    level_t level;                  //! logs less important than it are dropped by {@code LOG_QUEUE_DROP_BELOW_LEVEL}.
+
+    ring_t ring;                    //! the logs queued, the oldest is consumed first.
+
+    pthread_t worker;
+    pthread_mutex_t mutex;          //! protect the fields below and the offsets.
+    pthread_cond_t ready;           //! signaled when a log is queued or the worker is stopped.
+    pthread_cond_t done;            //! signaled when the worker has written a log.
+    uint32_t waiters;               //! threads waiting for {@code done}.
+    bool busy;                      //! the worker is writing a log taken from the queue.
+    bool running;                   //! false after deInit, each log is written at once.
+
+    char text[SIZE_OF_LOG_TEXT];    //! the buffer of the writer decorated.
+    char record[SIZE_OF_LOG_BUFFER] __attribute__((aligned(MEMORY_ALIGN)));
+};
+typedef struct queueWriter queueWriter_t;
+
+/**
+ * @brief   initialise a queue writer and start its worker.
+ * @param   writer is pointer to the queue writer.
+ * @param   target is the writer to decorate, the caller links the queue writer in its place.
+ * @param   size is the size of the queue in bytes, it is raised to hold a few logs at least.
+ * @param   policy is what to do when the queue is full.
+ * @param   level is the level of {@code LOG_QUEUE_DROP_BELOW_LEVEL}.
+ * @return  false if out of memory.
+ */
+bool queueWriterInit(writer_t *writer, writer_t *target, uint32_t size,
+                     log_queue_policy_t policy, level_t level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	//  __QLOG_QUEUEWRITER_H
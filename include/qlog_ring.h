@@ -0,0 +1,108 @@
+/**
+ * @file    qlog_ring.h
+ * @author  qufeiyan
+ * @brief   A byte ring of variable-sized entries, shared by the writers keeping logs in memory.
+ * @version 1.0.0
+ * @date    2026/10/19 09:31:05
+ * @version Copyright (c) 2023
+ */
+
+/* Define to prevent recursive inclusion ---------------------------------------------------*/
+#ifndef __QLOG_RING_H
+#define __QLOG_RING_H
+/* Include ---------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RING_ALIGN              (8)     //! entries are aligned to it, so are the records kept in them.
+
+/**
+ * the header of an entry, embedded first in the entries of a writer, and followed by
+ * what the writer keeps.
+ */
+struct ringEntry{
+    uint32_t size;                  //! bytes of the entry, a multiple of {@code RING_ALIGN}.
+    uint32_t pad;                   //! nonzero if the entry only fills the end of the ring.
+} __attribute__((aligned(RING_ALIGN)));
+typedef struct ringEntry ringEntry_t;
+
+/**
+ * an entry never wraps, the end of the ring is padded instead, and the offsets never wrap,
+ * so the ring is empty when they are equal. it is not locked, the caller serializes it.
+ */
+struct ring{
+    char *buffer;                   //! the entries.
+    uint32_t size;                  //! size of {@code buffer}.
+    uint64_t head;                  //! offset of the oldest entry.
+    uint64_t tail;                  //! offset of the next entry.
+};
+typedef struct ring ring_t;
+
+/**
+ * @brief   allocate the buffer of a ring.
+ * @param   ring is pointer to ring.
+ * @param   size is the size of the ring in bytes.
+ * @param   maximum is the most bytes of an entry, the ring is raised to hold a few of them,
+ *          so that an empty ring always has room for one, wherever its offsets are.
+ * @return  false if out of memory.
+ */
+bool ringInit(ring_t *ring, uint32_t size, uint32_t maximum);
+
+/**
+ * @brief   free the buffer of a ring.
+ */
+void ringRelease(ring_t *ring);
+
+/**
+ * @brief   reserve an entry at the tail, the end of the ring is padded if it is too short.
+ * @param   ring is pointer to ring.
+ * @param   size is the bytes of the entry with its header, raised to {@code RING_ALIGN}.
+ * @return  the entry with its size set, NULL if there is no room, the ring is unchanged
+ *          then. it is not taken by {@code ringPop} or {@code ringWalk} until committed.
+ */
+ringEntry_t *ringReserve(ring_t *ring, uint32_t size);
+
+/**
+ * @brief   append the entry reserved last to the ring.
+ */
+void ringCommit(ring_t *ring, ringEntry_t *entry);
+
+/**
+ * @brief   take the oldest entry out of the ring, the pads before it are skipped.
+ * @return  the entry, valid until an entry is reserved, NULL if the ring is empty.
+ */
+ringEntry_t *ringPop(ring_t *ring);
+
+/**
+ * @brief   get the entry at an offset without taking it, the pads are skipped.
+ * @param   ring is pointer to ring.
+ * @param   offset is the offset of the entry, moved past it, from {@code head} at first.
+ * @param   tail is where to stop, {@code tail} of the ring read once by the caller.
+ * @return  the entry, NULL at {@code tail}, or at an entry torn by a writer if the ring is
+ *          walked without lock at crash.
+ */
+ringEntry_t *ringWalk(const ring_t *ring, uint64_t *offset, uint64_t tail);
+
+/**
+ * @brief   check whether a ring has no entry.
+ */
+static inline bool ringEmpty(const ring_t *ring){
+    return ring->head == ring->tail;
+}
+
+/**
+ * @brief   drop all the entries of a ring.
+ */
+static inline void ringClear(ring_t *ring){
+    ring->head = ring->tail;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	//  __QLOG_RING_H
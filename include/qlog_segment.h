@@ -0,0 +1,104 @@
+/**
+ * @file    qlog_segment.h
+ * @author  qufeiyan
+ * @brief   Manage the sequence-numbered segment files of a log file.
+ * @version 1.0.0
+ * @date    2026/10/18 17:12:06
+ * @version Copyright (c) 2023
+ */
+
+/* Define to prevent recursive inclusion ---------------------------------------------------*/
+#ifndef __QLOG_SEGMENT_H
+#define __QLOG_SEGMENT_H
+/* Include ---------------------------------------------------------------------------------*/
+#include "qlog_port.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIZE_OF_SEGMENT_PATH    (SIZE_OF_FILE_PATH + 16)    //! file path with the sequence.
+
+/**
+ * the logs are written to $(logfile).log.$(sequence), a rotation only opens the next
+ * sequence, so nothing is renamed. the oldest segments beyond {@code numberOfFiles} or
+ * the disk budget are deleted by a reaper thread, the cost of a rotation does not depend
+ * on the number of segments retained.
+ */
+struct segment{
+    char filePath[SIZE_OF_FILE_PATH];       //! $(directory)/$(logfile).log
+    char currentPath[SIZE_OF_SEGMENT_PATH]; //! path of the current segment.
+    int numberOfFiles;                      //! maximum number of old segments retained.
+    int sizeOfFile;                         //! maximum size of a segment.
+
+    uint32_t sequence;                      //! sequence of the current segment.
+    uint32_t oldest;                        //! sequence of the oldest segment retained.
+    uint64_t *sizes;                        //! sizes of old segments, indexed by sequence % numberOfFiles.
+    uint64_t total;                         //! total size of old segments retained.
+
+    uint64_t budget;                        //! maximum total size of all segments, 0 means no limit.
+    uint32_t interval;                      //! seconds between rotations, 0 means rotating by size only.
+    time_t deadline;                        //! when the current segment expires.
+
+    uint32_t reaped;                        //! segments before it are deleted.
+    pthread_t reaper;
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+    bool running;                           //! false means segments are deleted by the caller.
+};
+typedef struct segment segment_t;
+
+/**
+ * @brief   initialise the segments of a log file, the sequence continues after the
+ *          segments left in the directory.
+ * @param   segment is pointer to segment.
+ * @param   filePath is $(directory)/$(logfile).log.
+ * @param   numberOfFiles is the maximum number of old segments retained.
+ * @param   sizeOfFile is the maximum size of a segment.
+ */
+void segmentInit(segment_t *segment, const char *filePath, int numberOfFiles, int sizeOfFile);
+
+/**
+ * @brief   delete the segments pending and stop the reaper.
+ */
+void segmentDeInit(segment_t *segment);
+
+/**
+ * @brief   free the resources of a segment stopped by {@code segmentDeInit}, it is not rotated any more.
+ */
+void segmentRelease(segment_t *segment);
+
+/**
+ * @brief   close the current segment and move to the next sequence.
+ * @param   segment is pointer to segment.
+ * @param   size is the size of the current segment.
+ * @note    the path of the next segment is {@code currentPath}.
+ */
+void segmentRotate(segment_t *segment, uint64_t size);
+
+/**
+ * @brief   set the rotation policy.
+ * @param   interval is the seconds between rotations, aligned to the wall clock, 0 means no limit.
+ * @param   budget is the maximum total size of all segments, 0 means no limit.
+ */
+void segmentSetPolicy(segment_t *segment, uint32_t interval, uint64_t budget);
+
+/**
+ * @brief   check whether the current segment should be rotated by time.
+ * @param   now is the wall-clock time.
+ * @note    lock-free, it is checked for every write.
+ */
+static inline bool segmentExpired(const segment_t *segment, time_t now){
+    return __atomic_load_n(&segment->interval, __ATOMIC_RELAXED) != 0 && 
+        now >= __atomic_load_n(&segment->deadline, __ATOMIC_RELAXED);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	//  __QLOG_SEGMENT_H
@@ -35,8 +35,8 @@ static __inline void slist_append(slist_t *head, slist_t *target){
     while(s->next){
         s = s->next;
     }
+    target->next = NULL;    //! terminate target before it is reachable from the list.
     s->next = target;
-    target->next = NULL;
 }
 
 static __inline void slist_insert(slist_t *current, slist_t *target){
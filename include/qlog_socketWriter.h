@@ -0,0 +1,104 @@
+/**
+ * @file    qlog_socketWriter.h
+ * @author  qufeiyan
+ * @brief   Define a socket writer, sending logs in batches to a local collector over a unix
+ *          domain, UDP or TCP socket.
+ * @version 1.0.0
+ * @date    2026/10/19 04:12:27
+ * @version Copyright (c) 2023
+ */
+
+/* Define to prevent recursive inclusion ---------------------------------------------------*/
+#ifndef __QLOG_SOCKETWRITER_H
+#define __QLOG_SOCKETWRITER_H
+/* Include ---------------------------------------------------------------------------------*/
+#include "qlog.h"
+#include "qlog_port.h"
+#include "qlog_ring.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef SOCKET_SYSLOG_FACILITY
+#define SOCKET_SYSLOG_FACILITY  (1)     //! facility of the syslog messages, 1 is user-level messages.
+#endif
+
+#ifndef SOCKET_FLUSH_LEVEL
+#define SOCKET_FLUSH_LEVEL      LOG_LEVEL_ERROR //! logs with level <= it are sent at once.
+#endif
+
+#define SIZE_OF_SOCKET_ADDRESS  (108)   //! maximum size of the address, the size of the path of a unix socket.
+
+/**
+ * the header of a log in the ring, followed by its frame.
+ */
+struct socketEntry{
+    ringEntry_t super;
+    int32_t length;                 //! length of the frame.
+};
+
+/**
+ * a log is framed into the ring by the caller, the sender sends the logs framed in batches,
+ * by one sendmmsg on datagram sockets, or by one gathering send on stream sockets, once a
+ * batch is full, the oldest log is older than {@code SOCKET_FLUSH_INTERVAL}, or a log at
+ * or above {@code SOCKET_FLUSH_LEVEL} is framed. while the collector is unavailable, the
+ * logs are kept in the ring, and the newest ones are dropped once it is full, the sender
+ * reconnects with a backoff doubling up to {@code SOCKET_RETRY_MAX}.
+ */
+struct socketWriter{
+    writer_t super;
+
+    log_socket_t transport;
+    log_framing_t framing;
+    char address[SIZE_OF_SOCKET_ADDRESS];
+    int fd;                         //! the socket connected, -1 if disconnected.
+    uint32_t backoff;               //! milliseconds before the next reconnection.
+    uint64_t retryTime;             //! monotonic time in ns of the next reconnection.
+
+    char identity[128];             //! "HOSTNAME APP-NAME PROCID MSGID SD " of syslog header, rendered once.
+    int32_t identityLength;
+    int64_t second;                 //! the second of {@code timestamp}.
+    char timestamp[24];             //! "YYYY-MM-DDThh:mm:ss" of {@code second} in UTC.
+
+    ring_t ring;                    //! the logs framed, the oldest is sent first.
+    uint32_t numberOfLogs;          //! logs in the ring.
+    uint64_t firstTime;             //! monotonic time in ns the logs in the ring have waited since.
+    bool urgent;                    //! the logs in the ring are sent without waiting for a batch.
+
+    pthread_t sender;
+    pthread_mutex_t mutex;          //! protect the ring and the connection.
+    pthread_cond_t ready;           //! signaled when a log is framed or the sender is stopped.
+    pthread_cond_t done;            //! signaled when the sender has sent a batch.
+    bool busy;                      //! the sender is connecting, or sending a batch taken from the ring.
+    bool running;
+    bool exited;                    //! the sender has returned, signaled by {@code done}.
+
+    struct mmsghdr *messages;       //! the batch of datagrams, {@code COUNT_OF_SOCKET_BATCH} of them.
+    struct iovec iovecs[COUNT_OF_SOCKET_BATCH];
+};
+typedef struct socketWriter socketWriter_t;
+
+/**
+ * @brief   initialise a socket writer and start its sender.
+ * @param   writer is pointer to socket writer.
+ * @param   buffer is pointer to log string.
+ * @param   transport is the transport of the socket.
+ * @param   address is the path of a unix socket, or "host:port".
+ * @param   framing is how a log is framed.
+ * @param   size is the size of the ring in bytes, it is raised to hold a few logs at least.
+ * @return  false if the address is invalid or out of memory.
+ * @note    the collector needs not be up, the sender connects once it is.
+ */
+bool socketWriterInit(writer_t *writer, char *buffer, log_socket_t transport, const char *address,
+                      log_framing_t framing, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	//  __QLOG_SOCKETWRITER_H
@@ -0,0 +1,177 @@
+/**
+ * @file    qlog_stats.h
+ * @author  qufeiyan
+ * @brief   Define the counters and latency histograms of logger and writers.
+ * @version 1.0.0
+ * @date    2026/10/18 19:02:37
+ * @version Copyright (c) 2023
+ */
+
+/* Define to prevent recursive inclusion ---------------------------------------------------*/
+#ifndef __QLOG_STATS_H
+#define __QLOG_STATS_H
+/* Include ---------------------------------------------------------------------------------*/
+#include "qlog_api.h"
+#include "qlog_port.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * a counter updated by many threads without any lock. each thread owns a stripe while it
+ * lives, so it adds without any atomic read-modify-write and never bounces a cache line
+ * with other threads. the threads beyond the stripes share the last one atomically.
+ */
+struct stripedCounter{
+    struct{
+        uint64_t value;
+    } __attribute__((aligned(SIZE_OF_CACHE_LINE))) stripes[COUNT_OF_STATS_STRIPE];
+};
+typedef struct stripedCounter stripedCounter_t;
+
+/**
+ * counters of a logger, all but {@code filtered} are updated under the lock of logger.
+ */
+struct loggerStats{
+    uint64_t accepted;
+    uint64_t dropped;
+    uint64_t truncated;
+    log_histogram_t lockWait;
+    stripedCounter_t filtered;      //! updated by the lock-free filter.
+    stripedCounter_t suppressed;    //! updated by the lock-free limiter.
+};
+typedef struct loggerStats loggerStats_t;
+
+/**
+ * counters of a writer, updated by the writer itself or by its flusher.
+ */
+struct writerStats{
+    uint64_t records;
+    uint64_t bytes;
+    uint64_t dropped;
+    uint64_t flushes;
+    log_histogram_t flushLatency;
+};
+typedef struct writerStats writerStats_t;
+
+/**
+ * periodic dump of the counters through the logger.
+ */
+struct statsReporter{
+    logger_t *logger;
+    uint32_t interval;              //! seconds between dumps.
+    pthread_t reporter;
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+    bool running;
+};
+typedef struct statsReporter statsReporter_t;
+
+extern __thread uint32_t statsStripe;     //! stripe of current thread + 1, 0 means unassigned.
+
+/**
+ * @brief   assign a free stripe to current thread, it is given back when the thread exits.
+ */
+void statsStripeAssign(void);
+
+/**
+ * @brief   get the monotonic time in ns.
+ */
+static inline uint64_t statsNow(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * @brief   add to a counter.
+ * @note    the updates must be serialized by the caller, e.g. by the lock of logger,
+ *          readers never take any lock.
+ */
+static inline void statsAdd(uint64_t *counter, uint64_t value){
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief   add to a striped counter, the stripe of current thread is assigned at the first time.
+ */
+static inline void stripedCounterAdd(stripedCounter_t *counter, uint64_t value){
+    if(__builtin_expect(statsStripe == 0, 0)){
+        statsStripeAssign();
+    }
+    if(__builtin_expect(statsStripe < COUNT_OF_STATS_STRIPE, 1)){
+        statsAdd(&counter->stripes[statsStripe - 1].value, value);
+    }else{
+        __atomic_fetch_add(&counter->stripes[COUNT_OF_STATS_STRIPE - 1].value, value, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief   record a duration into a histogram.
+ * @param   histogram is pointer to histogram.
+ * @param   ns is the duration in ns.
+ * @note    the updates must be serialized by the caller, readers never take any lock.
+ */
+static inline void histogramRecord(log_histogram_t *histogram, uint64_t ns){
+    uint32_t bucket = ns ? 64 - __builtin_clzll(ns) : 0;
+
+    if(bucket >= COUNT_OF_STATS_BUCKET){
+        bucket = COUNT_OF_STATS_BUCKET - 1;
+    }
+    statsAdd(&histogram->buckets[bucket], 1);
+    statsAdd(&histogram->count, 1);
+    statsAdd(&histogram->sum, ns);
+    if(ns > histogram->max){
+        __atomic_store_n(&histogram->max, ns, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief   read a striped counter.
+ */
+uint64_t stripedCounterRead(const stripedCounter_t *counter);
+
+/**
+ * @brief   copy a histogram updated concurrently.
+ */
+void histogramRead(log_histogram_t *to, const log_histogram_t *from);
+
+/**
+ * @brief   get the upper bound of a percentile of a histogram.
+ * @param   histogram is pointer to histogram.
+ * @param   permille is the percentile in 1/1000, e.g. 990 means p99.
+ * @return  the upper bound of the bucket where the percentile falls, in ns, no more than the maximum.
+ */
+uint64_t histogramPercentile(const log_histogram_t *histogram, uint32_t permille);
+
+/**
+ * @brief   take a snapshot of the counters of a logger and its writers.
+ * @param   logger is pointer to logger.
+ * @param   stats is where the snapshot is written to.
+ * @note    the writer list is walked under the lock of logger.
+ */
+void statsSnapshot(logger_t *logger, log_stats_t *stats);
+
+/**
+ * @brief   start dumping the counters of a logger periodically.
+ * @param   reporter is pointer to reporter.
+ * @param   logger is the logger whose counters are dumped through itself.
+ * @param   interval is the seconds between dumps.
+ */
+void statsReporterStart(statsReporter_t *reporter, logger_t *logger, uint32_t interval);
+
+/**
+ * @brief   stop dumping, it does nothing if the reporter is not started.
+ */
+void statsReporterStop(statsReporter_t *reporter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	//  __QLOG_STATS_H
@@ -10,60 +10,272 @@
 /* Includes --------------------------------------------------------------------------------*/
 #include "qlog_def.h"
 #include "mempool.h"
+#include <pthread.h>
+#include <stdbool.h>
 #include <string.h>
 
 
-#define block_list_next(list) (*(uint8_t **)(list))
+#define block_real(mp)              (sizeof(uint8_t *) + (mp)->block_size)
+//! the link of a free block to the next one, the index of block + 1, 0 means the end.
+#define block_link(block)           ((uint64_t *)(block))
+#define block_at(mp, index)         ((uint8_t *)(mp)->start + ((index) - 1) * block_real(mp))
+#define block_index(mp, block)      ((uint32_t)(((uint8_t *)(block) - (uint8_t *)(mp)->start) / block_real(mp)) + 1)
+#define block_head(tag, index)      (((uint64_t)(tag) << 32) | (index))
 
+/**
+ * the blocks a thread caches of a pool.
+ */
+struct magazine{
+    struct memoryPool *mp;
+    uint32_t count;
+    uint8_t *blocks[SIZE_OF_MAGAZINE];
+};
+
+static __thread struct magazine magazines[COUNT_OF_MAGAZINE];
+static __thread bool magazineRegistered;
+static pthread_key_t magazineKey;
+static pthread_once_t magazineOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief   take a block from the stack of a pool.
+ * @return  NULL if the stack is empty.
+ */
+static uint8_t *_pool_pop(struct memoryPool *mp){
+    uint64_t head, next;
+    uint8_t *block;
+    size_t free, least;
+
+    head = __atomic_load_n(&mp->block_list, __ATOMIC_ACQUIRE);
+    do{
+        if((uint32_t)head == 0){
+            return NULL;
+        }
+        //! the block may be taken by another thread meanwhile, then the tag has changed
+        //! and the link read is thrown away by the failed CAS.
+        block = block_at(mp, (uint32_t)head);
+        next = __atomic_load_n(block_link(block), __ATOMIC_RELAXED);
+    }while(!__atomic_compare_exchange_n(&mp->block_list, &head, block_head((head >> 32) + 1, (uint32_t)next),
+        true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    free = __atomic_sub_fetch(&mp->block_free, 1, __ATOMIC_RELAXED);
+    least = __atomic_load_n(&mp->block_free_min, __ATOMIC_RELAXED);
+    while(free < least && !__atomic_compare_exchange_n(&mp->block_free_min, &least, free,
+        true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    return block;
+}
+
+/**
+ * @brief   give back a chain of blocks linked from {@code first} to {@code last} with one CAS.
+ */
+static void _pool_push(struct memoryPool *mp, uint8_t *first, uint8_t *last, uint32_t count){
+    uint64_t head;
+    uint32_t index = block_index(mp, first);
+
+    head = __atomic_load_n(&mp->block_list, __ATOMIC_RELAXED);
+    do{
+        __atomic_store_n(block_link(last), (uint32_t)head, __ATOMIC_RELAXED);
+    }while(!__atomic_compare_exchange_n(&mp->block_list, &head, block_head((head >> 32) + 1, index),
+        true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    __atomic_add_fetch(&mp->block_free, count, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief   give back the blocks of a magazine, the newest {@code keep} ones stay.
+ */
+static void _magazine_drain(struct magazine *magazine, uint32_t keep){
+    uint32_t index;
+
+    if(magazine->count <= keep){
+        return;
+    }
+    for(index = keep; index + 1 < magazine->count; ++index){
+        __atomic_store_n(block_link(magazine->blocks[index]), block_index(magazine->mp, magazine->blocks[index + 1]),
+            __ATOMIC_RELAXED);
+    }
+    _pool_push(magazine->mp, magazine->blocks[keep], magazine->blocks[magazine->count - 1], magazine->count - keep);
+    magazine->count = keep;
+}
+
+/**
+ * @brief   give back the blocks cached by a thread exiting.
+ */
+static void _magazine_release(void *args){
+    (void)args;
+    for(int i = 0; i < COUNT_OF_MAGAZINE; ++i){
+        if(magazines[i].mp != NULL){
+            _magazine_drain(&magazines[i], 0);
+            magazines[i].mp = NULL;
+        }
+    }
+}
+
+static void _magazine_key(void){
+    pthread_key_create(&magazineKey, _magazine_release);
+}
+
+/**
+ * @brief   get the magazine of current thread for a pool.
+ * @return  NULL if the pool is not cached, or its slot is taken by another pool.
+ */
+static struct magazine *_magazine(struct memoryPool *mp){
+    struct magazine *magazine;
+
+    if(mp->magazine == 0){
+        return NULL;
+    }
+    magazine = &magazines[((uintptr_t)mp / sizeof(struct memoryPool)) % COUNT_OF_MAGAZINE];
+    if(__builtin_expect(magazine->mp != mp, 0)){
+        if(magazine->count != 0){
+            return NULL;
+        }
+        if(!magazineRegistered){
+            pthread_once(&magazineOnce, _magazine_key);
+            pthread_setspecific(magazineKey, magazines);
+            magazineRegistered = true;
+        }
+        magazine->mp = mp;
+    }
+    return magazine;
+}
+
+/**
+ * @brief   take a block from the magazine of current thread, or from the stack.
+ * @return  the block marked with the pool, NULL if the pool is exhausted.
+ */
+static uint8_t *_pool_take(struct memoryPool *mp){
+    struct magazine *magazine;
+    uint8_t *block;
+
+    magazine = _magazine(mp);
+    if(magazine != NULL && magazine->count > 0){
+        block = magazine->blocks[--magazine->count];
+    }else{
+        block = _pool_pop(mp);
+        if(block == NULL){
+            return NULL;
+        }
+    }
+
+    //! other threads may still read it as a link, see {@code _pool_pop}.
+    __atomic_store_n((uint8_t **)block, (uint8_t *)mp, __ATOMIC_RELAXED);
+    return block;
+}
 
 static void *alloc(struct memoryPool *mp){
     uint8_t *block_current;
     assert(mp != NULL && mp->start != NULL);
-    assert(mp->block_list != NULL);
-    assert(mp->block_free <= mp->block_total);
 
-    block_current = mp->block_list;
-    *(uint8_t **)block_current = (uint8_t *)mp;
-    mp->block_list = block_list_next(mp->block_list);
-    mp->block_free--;
+    block_current = _pool_take(mp);
 
+    //! exhausted.
+    if(block_current == NULL){
+        __atomic_add_fetch(&mp->failures, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
     return block_current + sizeof(uint8_t *);
 }
 
 static void mfree(struct memoryPool *mp, void *pointer){
+    struct magazine *magazine;
     uint8_t *block_current;
     assert(mp != NULL && pointer != NULL);    
     block_current = (uint8_t *)pointer - sizeof(uint8_t *);
     assert(*(uint8_t **)block_current == (uint8_t *)mp);
 
-    block_list_next(block_current) = mp->block_list;
-    mp->block_list = block_current;
-    mp->block_free++;
+    magazine = _magazine(mp);
+    if(magazine == NULL){
+        _pool_push(mp, block_current, block_current, 1);
+        return;
+    }
+    //! a full magazine gives back half of it at once, so it is not drained again by the next free.
+    if(magazine->count == mp->magazine){
+        _magazine_drain(magazine, mp->magazine / 2);
+    }
+    magazine->blocks[magazine->count++] = block_current;
+}
+
+void memoryPoolStats(const struct memoryPool *mp, memoryPoolStats_t *stats){
+    assert(mp != NULL && stats != NULL);
+    stats->total = mp->block_total;
+    stats->used = mp->block_total - __atomic_load_n(&mp->block_free, __ATOMIC_RELAXED);
+    stats->highWater = mp->block_total - __atomic_load_n(&mp->block_free_min, __ATOMIC_RELAXED);
+    stats->failures = __atomic_load_n(&mp->failures, __ATOMIC_RELAXED);
 }
 
 void memoryPoolInit(struct memoryPool *mp, const char *name, size_t block_total, size_t block_size, void *start){
-    int32_t index;
-    uint8_t *block_current;
+    uint32_t index;
     assert(mp != NULL && start != NULL);
-    assert(block_total > 0 && block_size > 0);
+    assert(block_total > 0 && block_total < UINT32_MAX && block_size > 0);
 
     mp->name = name;
     mp->block_size = MEMORY_ALIGN_UP(block_size, MEMORY_ALIGN);
-    mp->block_total = mp->block_free = block_total;
+    mp->block_total = mp->block_free = mp->block_free_min = block_total;
     mp->start = start;
-    
-    size_t block_size_real = (sizeof(uint8_t *) + mp->block_size); 
-    mp->size = block_size_real * mp->block_total;
-    mp->block_list = (uint8_t *)mp->start;
+    mp->size = block_real(mp) * mp->block_total;
+    mp->failures = 0;
+
+    //! a thread caches an eighth of the blocks at most, so the others are not starved.
+    mp->magazine = block_total / 8 < SIZE_OF_MAGAZINE ? block_total / 8 : SIZE_OF_MAGAZINE;
 
     //! initialise the block list.
-    block_current = mp->block_list;
-    for (index = 0; index < mp->block_total; ++index) {
-        *(uint8_t **)(block_current + index * block_size_real) = \
-            (block_current + (index + 1) * block_size_real);        
+    for (index = 1; index <= mp->block_total; ++index) {
+        *block_link(block_at(mp, index)) = index < mp->block_total ? index + 1 : 0;
     }
-    *(uint8_t **)(block_current + (index - 1) * block_size_real) = NULL;
+    mp->block_list = block_head(0, 1);
 
     mp->alloc = alloc;
     mp->free = mfree;
 }
+
+void memoryArenaInit(struct memoryArena *arena, const char *name, size_t block_total,
+    size_t block_size, size_t classes, void *start){
+    uint8_t *region;
+    size_t index;
+    assert(arena != NULL && start != NULL);
+    assert(classes > 0 && classes <= COUNT_OF_ARENA_CLASS);
+    assert(block_size % sizeof(uint8_t *) == 0);
+
+    arena->name = name;
+    arena->start = start;
+    arena->size = MEMORY_ARENA_SIZE(block_total, block_size, classes);
+    arena->numberOfPools = classes;
+    arena->failures = 0;
+
+    //! the pools lie one after another, from the smallest class.
+    region = (uint8_t *)start;
+    for(index = 0; index < classes; ++index){
+        memoryPoolInit(&arena->pools[index], name, block_total, block_size << index, region);
+        region += arena->pools[index].size;
+    }
+}
+
+void *memoryArenaAlloc(struct memoryArena *arena, size_t size){
+    memoryPool_t *mp;
+    uint8_t *block;
+    size_t index;
+    assert(arena != NULL);
+
+    for(index = 0; index < arena->numberOfPools; ++index){
+        mp = &arena->pools[index];
+        if(mp->block_size < size){
+            continue;
+        }
+        //! the larger classes are tried without counting a failure of each.
+        block = _pool_take(mp);
+        if(block != NULL){
+            return block + sizeof(uint8_t *);
+        }
+    }
+    __atomic_add_fetch(&arena->failures, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+void memoryArenaFree(struct memoryArena *arena, void *pointer){
+    memoryPool_t *mp;
+    assert(arena != NULL && pointer != NULL);
+
+    //! each block is marked with the pool it is taken from.
+    mp = *(memoryPool_t **)((uint8_t *)pointer - sizeof(uint8_t *));
+    assert(mp >= arena->pools && mp < arena->pools + arena->numberOfPools);
+    mp->free(mp, pointer);
+}
@@ -8,17 +8,26 @@
  */
 
 /* Includes --------------------------------------------------------------------------------*/
+#define _GNU_SOURCE     //! sched_getcpu, pthread_getname_np
 #include "qlog.h"
 #include "mempool.h"
 #include "qlog_port.h"
 #include "qlog_def.h"
 #include "qlog_slist.h"
+#include "qlog_deferred.h"
+#include "qlog_limiter.h"
+#include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 #include <time.h>
+#include <unistd.h>
 
 
 // #define LOG_CTRL_LEVEL_ERROR (1)
@@ -26,22 +35,57 @@
 // #define LOG_CTRL_LEVEL_INFO  (3)
 // #define LOG_CTRL_LEVEL_DEBUG (4)    
 
-static const char * const color_info[] = {
-    LOG_COLOR_FATAL,
-    LOG_COLOR_ERROR,
-    LOG_COLOR_WARN,
-    LOG_COLOR_INFO,
-    LOG_COLOR_DEBUG
+#define LOG_COLOR_SEGMENT(code)     { (void *)(LOG_COLOR_START code), sizeof(LOG_COLOR_START code) - 1 }
+
+const struct iovec logColors[LOG_LEVEL_BUTT] = {
+    LOG_COLOR_SEGMENT(LOG_COLOR_FATAL),
+    LOG_COLOR_SEGMENT(LOG_COLOR_ERROR),
+    LOG_COLOR_SEGMENT(LOG_COLOR_WARN),
+    LOG_COLOR_SEGMENT(LOG_COLOR_INFO),
+    LOG_COLOR_SEGMENT(LOG_COLOR_DEBUG)
 };
 
+const struct iovec logColorReset = { (void *)LOG_COLOR_END, sizeof(LOG_COLOR_END) - 1 };
+
+/* format buffer of current thread, so that logs can be formatted outside the lock. */
+static __thread char formatBuffer[SIZE_OF_LOG_BUFFER];
+
+#if COUNT_OF_LOG_CLASS
+/* the arena of the logs longer than the log buffer, shared by all the loggers. */
+static memoryArena_t logArena;
+static uint8_t logArenaMemory[MEMORY_ARENA_SIZE(COUNT_OF_LOG_BLOCK, SIZE_OF_LOG_BLOCK, COUNT_OF_LOG_CLASS)]
+    __attribute__((aligned(MEMORY_ALIGN)));
+static pthread_once_t logArenaOnce = PTHREAD_ONCE_INIT;
+
+static void _logArena_init(void){
+    memoryArenaInit(&logArena, "log", COUNT_OF_LOG_BLOCK, SIZE_OF_LOG_BLOCK, COUNT_OF_LOG_CLASS, logArenaMemory);
+}
+#endif
+
+/* raw arguments of current thread, captured for the writers consuming records. */
+static __thread char recordBuffer[SIZE_OF_LOG_BUFFER] __attribute__((aligned(MEMORY_ALIGN)));
+
+#define SIZE_OF_TIMESTAMP       (32)        //! maximum length of "MM-DD HH:MM:SS".
+#define SIZE_OF_CALIBRATION     (5000000)   //! nanoseconds to calibrate the cpu counter.
+
 /* level output info */
-static const char * const level_info[] = {
-    "F/",
-    "E/",
-    "W/",
-    "I/",
-    "D/",
-};
+static const char level_letter[] = { 'F', 'E', 'W', 'I', 'D' };
+static const char * const level_name[] = { "FATAL", "ERROR", "WARN", "INFO", "DEBUG" };
+static const uint8_t level_name_length[] = { 5, 5, 4, 4, 5 };
+
+/* identity of current thread, a length of 0 means unknown, and process id, 0 means unknown. */
+static __thread struct threadIdentity threadIdentity;
+static __thread bool threadNamed;       //! the name is resolved or set.
+static uint32_t processId;
+static bool atforkRegistered;
+
+/**
+ * @brief   forget the cached ids in the child process, the name of thread is inherited.
+ */
+static void _formatter_atfork(void){
+    threadIdentity.tidLength = 0;
+    processId = 0;
+}
 
 /**
  * @brief  provide lock api.
@@ -55,6 +99,17 @@ void _locker_lock(struct locker *locker){
     locker_lock(locker->locker);
 }
 
+/**
+ * @brief   provide trylock api.
+ * @param   locker is pointer to a locker.
+ * @return  true if the lock is acquired.
+ */
+bool _locker_tryLock(struct locker *locker){
+    assert(locker != NULL);
+    assert(locker->locker != NULL);
+    return locker_trylock(locker->locker);
+}
+
 /**
  * @brief   provide unlock api.
  * @param   locker is pointer to a locker.
@@ -97,80 +152,508 @@ void _registerWriter(logger_t *logger, writer_t *writer){
 }
 
 /**
- * @brief   output a log.
+ * @brief   hand a formatted log to the writer chain.
+ *
+ * @param   logger is pointer to the logger.
+ * @param   level is the level of the log.
+ * @param   buffer is the formatted log, it is copied to the log buffer of logger if it fits.
+ * @param   length is the length of the formatted log, 0 if no writer consumes the text.
+ * @param   record is the raw arguments of the log, NULL if they are not captured.
+ * @note    the caller must hold the locker of logger.
+ */
+void loggerOutput(logger_t *logger, level_t level, const char *buffer, int32_t length,
+                  const deferredRecord_t *record){
+    writer_t *writer;
+    char *text;
+    assert(logger != NULL && buffer != NULL);
+    assert(length >= 0 && length < SIZE_OF_LOG_TEXT); 
+    assert(length > 0 || record != NULL);
+
+    //! a long log is written from its block, which lives until the writers return.
+    text = (char *)buffer;
+    if(length < SIZE_OF_LOG_BUFFER){
+        text = logger->buffer;
+        if(buffer != logger->buffer){
+            memcpy(logger->buffer, buffer, length);
+        }
+        logger->buffer[length] = '\0';
+    }
+
+    statsAdd(&logger->stats.accepted, 1);
+    //! a log cut off fills its buffer or block, and ends with the mark.
+    if(length >= SIZE_OF_LOG_BUFFER - 1 &&
+        memcmp(text + length - (sizeof(LOG_TRUNCATION_MARK) - 1), LOG_TRUNCATION_MARK, sizeof(LOG_TRUNCATION_MARK) - 1) == 0){
+        statsAdd(&logger->stats.truncated, 1);
+    }
+
+    writer = logger->writer;
+    assert(writer != NULL);
+    if(text != logger->buffer){
+        for(writer_t *next = writer; next != NULL; next = next->next){
+            next->buffer = text;
+        }
+    }
+    writer->length = length;
+    writer->color = logger->formatter->color;  //! the writers showing color add the color segments.
+    writer->level = level;
+    writer->record = record;
+    writer->write(writer);
+
+    //! the block is given back after, so the writers never keep a pointer to it.
+    if(text != logger->buffer){
+        for(writer_t *next = writer; next != NULL; next = next->next){
+            next->buffer = logger->buffer;
+        }
+    }
+}
+
+/**
+ * @brief   find the kinds of writers taking a log.
+ * @param   logger is pointer to the logger.
+ * @param   level is the level of the log.
+ * @return  mask of {@code LOGGER_SINK_TEXT} and {@code LOGGER_SINK_RECORD}.
+ * @note    lock-free, a writer enabled concurrently takes effect from the next log.
+ */
+uint32_t loggerSinks(logger_t *logger, level_t level){
+    uint32_t sinks = 0;
+
+    for(writer_t *writer = logger->writer; writer != NULL; writer = writer->next){
+        writer_t *target = writer->inner ? writer->inner : writer;
+
+        if(__atomic_load_n(&target->enable, __ATOMIC_RELAXED) &&
+            !(__atomic_load_n(&target->skipped, __ATOMIC_RELAXED) & (1u << level))){
+            sinks |= target->binary ? LOGGER_SINK_RECORD : LOGGER_SINK_TEXT;
+        }
+    }
+    return sinks;
+}
+
+/**
+ * @brief   capture the raw arguments and the context of a log.
+ * @param   logger is pointer to the logger.
+ * @param   record is where the log is captured to.
+ * @param   size is the size of {@code record}.
+ * @param   site is the callsite of the log, NULL means none.
+ * @param   tag is the name of module.
+ * @param   format is the format string, it must have static storage.
+ * @param   args is a list of variable parameters, it is not consumed.
+ * @return  false if the format can not be captured, see {@code deferredCapture}.
+ * @note    the time is always captured, the writers consuming records rely on it.
+ */
+bool loggerCapture(logger_t *logger, deferredRecord_t *record, int32_t size, const qlog_site_t *site,
+                   const char *tag, const char *format, va_list args){
+    formatter_t *formatter = logger->formatter;
+    va_list copy;
+    bool ret;
+
+    formatter->capture(formatter, &record->context);
+    if(!(record->context.layout->fields & (1 << LAYOUT_TIMESTAMP))){
+        record->context.time = formatter->now(formatter);
+    }
+    record->site = site;
+    va_copy(copy, args);
+    ret = deferredCapture(record, size, tag, format, copy) > 0;
+    va_end(copy);
+    return ret;
+}
+
+/**
+ * @brief   check whether a log should be output.
  *
  * @param   logger is pointer to the logger.
  * @param   tag is the name of module.
  * @param   level is the level of log.
- * @param   format is the format string to ouput.
- * @param   args is a list of variable parameters.
- * @note    
- * @see     
+ * @return  true if the log passes the global level and the tag filter.
+ * @note    lock-free.
  */
-__weak void _logger_log(logger_t *logger, const char *tag, level_t level, const char *format, va_list args){
+bool loggerFilter(logger_t *logger, const char *tag, level_t level){
     filter_t *filter;
-    formatter_t *formater;
-    writer_t *writer;
-    locker_t *locker;
-    int32_t length;
-    assert(logger && format);
-    
-    //! global filter, if current level > logger.level, there is nothing to output.
-    if(level > logger->level){
-        return;
+    assert(logger != NULL);
+
+    //! if current level > logger.level, neither the global level nor any tag lets it pass.
+    if(level > __atomic_load_n(&logger->level, __ATOMIC_RELAXED)){
+        stripedCounterAdd(&logger->stats.filtered, 1);
+        return false;
     }
 
     //! filter tag.
     assert(logger->filter != NULL);
     filter = logger->filter;
-
-    assert(logger->locker != NULL);
-    locker = logger->locker;
-    
-    locker->lock(locker);
     if(filter->invoke && filter->invoke(filter, tag, level)){
+        stripedCounterAdd(&logger->stats.filtered, 1);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief   acquire the locker of logger, and record the time waiting for it.
+ * @param   logger is pointer to the logger.
+ * @note    the clock is read only if the locker is contended.
+ */
+void loggerLock(logger_t *logger){
+    locker_t *locker = logger->locker;
+    uint64_t start;
+
+    if(locker->tryLock == NULL){
+        locker->lock(locker);
+        return;
+    }
+    if(locker->tryLock(locker)){
+        histogramRecord(&logger->stats.lockWait, 0);
         return;
     }
+    start = statsNow();
+    locker->lock(locker);
+    histogramRecord(&logger->stats.lockWait, statsNow() - start);
+}
+
+/**
+ * @brief   check whether a log which has passed {@code loggerFilter} is not suppressed
+ *          by the rate limits or as a repeat.
+ * @param   logger is pointer to the logger.
+ * @param   site is the callsite of the log, NULL means it is identified by the format string.
+ * @param   tag is the name of module.
+ * @param   level is the level of log.
+ * @param   format is the format string.
+ * @param   args is a list of variable parameters, it is not consumed.
+ * @return  false if the log is suppressed, the reports due are output first.
+ */
+bool loggerLimit(logger_t *logger, const qlog_site_t *site, const char *tag, level_t level,
+                 const char *format, va_list args){
+    limiter_t *limiter;
+    assert(logger != NULL);
+
+    limiter = __atomic_load_n(&logger->limiter, __ATOMIC_ACQUIRE);
+    if(limiter == NULL || limiter->invoke(limiter, logger, site, tag, level, format, args)){
+        return true;
+    }
+    stripedCounterAdd(&logger->stats.suppressed, 1);
+    return false;
+}
+
+/**
+ * @brief   write a buffer to a file descriptor until all of it is written.
+ * @param   fd is the file descriptor.
+ * @param   data is the bytes to write.
+ * @param   size is the size of {@code data}.
+ * @return  false if the write fails.
+ * @note    async-signal-safe, it is used by the crash handler.
+ */
+bool writerWriteAll(int fd, const char *data, int32_t size){
+    ssize_t written;
 
+    while(size > 0){
+        written = write(fd, data, size);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+/**
+ * @brief   write what the writers of a logger keep, or a text, straight to their sinks.
+ * @param   logger is pointer to the logger.
+ * @param   text is the text to write, NULL means the logs kept by the writers.
+ * @param   length is the length of {@code text}.
+ * @note    for the crash handler, no lock is taken, as the crashed thread may hold it.
+ */
+void loggerEmergency(logger_t *logger, const char *text, int32_t length){
+    for(writer_t *writer = logger->writer; writer != NULL; writer = writer->next){
+        writer_t *target = writer->inner ? writer->inner : writer;
+
+        if(__atomic_load_n(&target->enable, __ATOMIC_RELAXED) && writer->emergency != NULL){
+            writer->emergency(writer, text, length);
+        }
+    }
+}
+
+/**
+ * @brief   output a log.
+ *
+ * @param   logger is pointer to the logger.
+ * @param   site is the callsite of the log, NULL means none.
+ * @param   tag is the name of module.
+ * @param   level is the level of log.
+ * @param   format is the format string to ouput.
+ * @param   args is a list of variable parameters.
+ * @note    the log has passed {@code loggerFilter}.
+ * @see     
+ */
+__weak void _logger_log(logger_t *logger, const qlog_site_t *site, const char *tag, level_t level,
+                        const char *format, va_list args){
+    formatter_t *formater;
+    locker_t *locker;
+    deferredRecord_t *record;
+    char *text;
+    uint32_t sinks;
+    int32_t length;
+    assert(logger && format);
+    
     length = 0;
-    //! formater
+    text = formatBuffer;
+    record = NULL;
+    sinks = loggerSinks(logger, level);
     assert(logger->formatter != NULL);
     formater = logger->formatter;
-    if(formater->invoke){
-        length = formater->invoke(formater, tag, level, format, args);
+
+    //! the raw arguments, the text is rendered from them if needed, so both see the same context.
+    if(sinks & LOGGER_SINK_RECORD){
+        record = (deferredRecord_t *)recordBuffer;
+        if(!loggerCapture(logger, record, sizeof(recordBuffer), site, tag, format, args)){
+            record = NULL;
+        }
+    }
+
+    //! formater, runs concurrently in the buffer of current thread.
+    if(record == NULL){
+        length = formater->invoke(formater, &text, site, tag, level, format, args);
+    }else if(sinks & LOGGER_SINK_TEXT){
+        length = formater->render(formater, formatBuffer, level, record);
     }
     
-    //! writer
-    writer = logger->writer;
-    assert(writer != NULL);
-    writer->length = length;
-    writer->color = formater->color;  //! notes that file writer will filter the color.
-    assert(writer->length > 0 && writer->length < SIZE_OF_LOG_BUFFER); 
-    writer->write(writer);
+    //! writer, only handing the formatted log to writers is serialized.
+    assert(logger->locker != NULL);
+    locker = logger->locker;
+    loggerLock(logger);
+    loggerOutput(logger, level, text, length, record);
     locker->unlock(locker);
+
+    if(text != formatBuffer){
+        formater->release(formater, text);
+    }
+}
+
+/**
+ * @brief   hash a tag with FNV-1a.
+ * @param   tag is the tag to hash.
+ * @return  the hash, never 0 as 0 means an empty entry.
+ */
+uint32_t loggerHashTag(const char *tag){
+    uint32_t hash = 2166136261u;
+
+    while(*tag){
+        hash ^= (uint8_t)*tag++;
+        hash *= 16777619u;
+    }
+    return hash ? hash : 1;
+}
+
+/**
+ * @brief   find the entry of a tag, or the empty entry where it should be interned.
+ * @param   table is the table of tags.
+ * @param   tag is the tag to find.
+ * @param   hash is the hash of the tag.
+ * @return  index of the entry, -1 if the table is full.
+ * @note    lock-free, the cost does not depend on the number of tags.
+ */
+static int32_t _filter_probe(filter_table_t *table, const char *tag, uint32_t hash){
+    filter_tag_t *entry;
+    uint32_t index, probe, current;
+
+    for(index = hash & table->mask, probe = 0; probe <= table->mask; 
+        index = (index + 1) & table->mask, probe++){
+        entry = &table->tags[index];
+        current = __atomic_load_n(&entry->hash, __ATOMIC_ACQUIRE);
+        if(current == 0 || (current == hash && strcmp(entry->tag, tag) == 0)){
+            return index;
+        }
+    }
+    return -1;
 }
 
 /**
- * @brief   append a tag to filter-tag list.
+ * @brief   find the handle of a tag.
+ * @param   filter is pointer to filter.
+ * @param   tag is the tag to find.
+ * @return  handle of the tag in current table, -1 if the tag is not interned.
+ */
+int32_t _filter_find(struct filter *filter, const char *tag){
+    filter_table_t *table;
+    uint32_t sequence;
+    int32_t index;
+    assert(filter != NULL && tag != NULL);
+
+    do{
+        sequence = __atomic_load_n(&filter->sequence, __ATOMIC_ACQUIRE);
+        table = __atomic_load_n(&filter->table, __ATOMIC_ACQUIRE);
+        index = _filter_probe(table, tag, loggerHashTag(tag));
+        if(index >= 0 && __atomic_load_n(&table->tags[index].hash, __ATOMIC_ACQUIRE) == 0){
+            index = -1;
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }while(__atomic_load_n(&filter->sequence, __ATOMIC_RELAXED) != sequence);
+    return index;
+}
+
+/**
+ * @brief   intern a tag in a table which is not published yet, or set its level.
+ * @param   table is the table of tags.
+ * @param   capacity is the maximum number of tags.
+ * @param   tag is the tag.
+ * @param   level is the level of the tag.
+ * @return  false if the tag is too long or there is no room for it.
+ */
+static bool _filter_intern(filter_table_t *table, uint32_t capacity, const char *tag, level_t level){
+    filter_tag_t *entry;
+    uint32_t hash;
+    int32_t index;
+
+    if(strlen(tag) >= SIZE_OF_NAME){
+        return false;
+    }
+
+    hash = loggerHashTag(tag);
+    index = _filter_probe(table, tag, hash);
+    if(index < 0){
+        return false;
+    }
+
+    entry = &table->tags[index];
+    if(entry->hash == 0){
+        if(table->count >= capacity){
+            return false;
+        }
+        strcpy(entry->tag, tag);
+        entry->level = level;
+        //! publish the entry.
+        __atomic_store_n(&entry->hash, hash, __ATOMIC_RELEASE);
+        __atomic_store_n(&table->count, table->count + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    __atomic_store_n(&entry->level, level, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief   set the level of a tag, the tag is interned at the first time.
  *
  * @param   filter is pointer to filter.   
  * @param   tag is pointer to tag which will be append.
  * @param   level is the level of the tag.
+ * @return  false if the tag is too long or there is no room for it.
+ * @note    writers must be serialized by the caller, readers never wait.
  */
-void _filter_append(struct filter *filter, const char *tag, level_t level){
-    filter_tag_t *filter_tag;
+bool _filter_append(struct filter *filter, const char *tag, level_t level){
     assert(filter != NULL);
     assert(tag != NULL);
     assert(level < LOG_LEVEL_BUTT);
-    assert(filter->tagMemoryPool);
 
-    filter_tag = (filter_tag_t *)memoryPoolAlloc(filter->tagMemoryPool);
-    assert(filter_tag != NULL);
-    filter_tag->level = level;
-    // filter_tag->tag = tag;
-    strcpy(filter_tag->tag, tag);
+    return _filter_intern(filter->table, filter->capacity, tag, level);
+}
 
-    slist_append(&filter->list_tag, &filter_tag->list_tag_current);    
+/**
+ * @brief   replace all the tags of a filter by a new table.
+ *
+ * @param   filter is pointer to filter.
+ * @param   tags are the tags.
+ * @param   levels are the levels of the tags.
+ * @param   count is the number of tags.
+ * @param   others is the level of the tags not given, {@code FILTER_LEVEL_NONE} filters them out.
+ * @return  false if a tag is too long, there are too many tags or out of memory, the
+ *          filter is unchanged then.
+ * @note    writers must be serialized by the caller. the table not in use is rebuilt and
+ *          swapped in, readers may still be in it from the replacement before, so
+ *          {@code sequence} is bumped before it is touched and they read again.
+ */
+bool _filter_replace(struct filter *filter, const char (*tags)[SIZE_OF_NAME], const level_t *levels,
+                     uint32_t count, int32_t others){
+    filter_table_t *table, *current;
+    uint32_t sizeOfTable;
+    bool interned;
+    assert(filter != NULL);
+    assert(count == 0 || (tags != NULL && levels != NULL));
+    assert(others >= FILTER_LEVEL_NONE && others < LOG_LEVEL_BUTT);
+
+    //! check the tags first, the table is not touched unless all of them fit.
+    if(count > filter->capacity){
+        return false;
+    }
+    for(uint32_t i = 0; i < count; ++i){
+        assert(levels[i] < LOG_LEVEL_BUTT);
+        if(strnlen(tags[i], SIZE_OF_NAME) >= SIZE_OF_NAME){
+            return false;
+        }
+    }
+
+    current = filter->table;
+    sizeOfTable = current->mask + 1;
+    table = current == filter->tables[0] ? filter->tables[1] : filter->tables[0];
+    if(table == NULL){
+        table = calloc(1, sizeof(filter_table_t) + sizeOfTable * sizeof(filter_tag_t));
+        if(table == NULL){
+            return false;
+        }
+        table->tags = (filter_tag_t *)(table + 1);
+        table->mask = current->mask;
+        filter->tables[1] = table;
+    }
+
+    __atomic_store_n(&filter->sequence, filter->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memset(table->tags, 0, sizeOfTable * sizeof(filter_tag_t));
+    __atomic_store_n(&table->count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&table->others, others, __ATOMIC_RELAXED);
+    for(uint32_t i = 0; i < count; ++i){
+        interned = _filter_intern(table, filter->capacity, tags[i], levels[i]);
+        assert(interned);
+        (void)interned;
+    }
+
+    __atomic_store_n(&filter->table, table, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief   get the least important level a log may pass a filter with.
+ *
+ * @param   filter is pointer to filter.
+ * @return  the most verbose of the global level, the levels of tags and of the others.
+ * @note    writers must be serialized by the caller, it reads the current table.
+ */
+level_t _filter_ceiling(struct filter *filter){
+    filter_table_t *table;
+    int32_t ceiling;
+    assert(filter != NULL);
+
+    table = filter->table;
+    ceiling = (int32_t)filter->level > table->others ? (int32_t)filter->level : table->others;
+    for(uint32_t i = 0; i <= table->mask; ++i){
+        if(table->tags[i].hash != 0 && (int32_t)table->tags[i].level > ceiling){
+            ceiling = table->tags[i].level;
+        }
+    }
+    return (level_t)ceiling;
+}
+
+/**
+ * @brief   get the level a log with a tag is filtered by in a table.
+ * @return  the level, the log passes if it is not less important.
+ */
+static int32_t _filter_level(struct filter *filter, filter_table_t *table, const char *tag){
+    int32_t index;
+
+    //! 1. tag is nil, or 2. no tag is interned and the others are not given a level.
+    if(tag == NULL || (__atomic_load_n(&table->count, __ATOMIC_ACQUIRE) == 0 &&
+                       __atomic_load_n(&table->others, __ATOMIC_RELAXED) == FILTER_LEVEL_NONE)){
+        return __atomic_load_n(&filter->level, __ATOMIC_RELAXED);
+    }
+
+    //! 3. find tag in the table, its level overrides the global one.
+    index = _filter_probe(table, tag, loggerHashTag(tag));
+    if(index >= 0 && __atomic_load_n(&table->tags[index].hash, __ATOMIC_ACQUIRE) != 0){
+        return __atomic_load_n(&table->tags[index].level, __ATOMIC_ACQUIRE);
+    }
+
+    //! 4. the tags not interned.
+    return __atomic_load_n(&table->others, __ATOMIC_RELAXED);
 }
 
 /**
@@ -183,115 +666,525 @@ void _filter_append(struct filter *filter, const char *tag, level_t level){
  * @see     
  */
 bool _filter_invoke(struct filter *filter, const char *tag, level_t level){
-    slist_t *current;
-    filter_tag_t *filter_tag;
+    filter_table_t *table;
+    uint32_t sequence;
+    int32_t passed;
     assert(filter);
 
-    //! 1. tag is nil.
-    if(tag == NULL && level <= filter->level){
-        return false;
+    do{
+        sequence = __atomic_load_n(&filter->sequence, __ATOMIC_ACQUIRE);
+        table = __atomic_load_n(&filter->table, __ATOMIC_ACQUIRE);
+        passed = _filter_level(filter, table, tag);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }while(__atomic_load_n(&filter->sequence, __ATOMIC_RELAXED) != sequence);
+
+    return (int32_t)level > passed;
+}
+
+/**
+ * the "MM-DD HH:MM:SS" part of timestamp is rendered once per second for each thread.
+ */
+struct timestampCache{
+    time_t second;
+    char text[SIZE_OF_TIMESTAMP];
+    uint32_t length;
+};
+static __thread struct timestampCache timestampCache = { .second = -1 };
+
+static const uint32_t precision_digits[] = { 3, 6, 9 };
+static const uint32_t precision_divisor[] = { 1000000, 1000, 1 };
+
+/**
+ * @brief   read a clock in nanoseconds.
+ */
+static __inline uint64_t _clock_ns(clockid_t id){
+    struct timespec ts;
+
+    if(clock_gettime(id, &ts) < 0){
+        return 0;
     }
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
 
-    //! 2. filter list is nil.
-    if(filter->list_tag.next == NULL && level <= filter->level){
-        return false;
+/**
+ * @brief   read the clock source of formatter.
+ * @param   formatter is pointer to formatter.
+ * @return  nanoseconds since the epoch.
+ * @note    the log keeps the time converted already, so a clock changed later does not
+ *          affect it. lock-free and async-signal-safe, the copy read is never being changed.
+ */
+uint64_t _formatter_now(struct formatter *formatter){
+    struct logClock clock;
+    uint32_t sequence;
+    uint64_t now;
+
+    do{
+        sequence = __atomic_load_n(&formatter->clockSequence, __ATOMIC_ACQUIRE);
+        clock = formatter->clocks[sequence & 1];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }while(sequence != __atomic_load_n(&formatter->clockSequence, __ATOMIC_RELAXED));
+
+    switch(clock.source){
+        case LOG_CLOCK_REALTIME_COARSE:
+            return _clock_ns(CLOCK_REALTIME_COARSE);
+        case LOG_CLOCK_MONOTONIC:
+            return _clock_ns(CLOCK_MONOTONIC) + clock.offset;
+        case LOG_CLOCK_TSC:
+            now = (uint64_t)(((unsigned __int128)(tsc_read() - clock.ticksBase) * clock.nsPerTick) >> 32);
+            return now + clock.offset;
+        default:
+            return _clock_ns(CLOCK_REALTIME);
     }
+}
 
-    //! 3. find tag in the filter tag list.
-    slist_for_each(current, &filter->list_tag){
-        filter_tag = container_of(current, filter_tag_t, list_tag_current);
-        if(strcmp(tag, filter_tag->tag) == 0   /*find the tag.*/
-            && filter_tag->level >= level){    
-            return false;
+/**
+ * @brief   render digits with leading zeros.
+ * @param   buffer is where the digits are rendered to.
+ * @param   value is the value to render.
+ * @param   digits is the number of digits.
+ */
+static __inline void _formatter_digits(char *buffer, uint32_t value, uint32_t digits){
+    while(digits--){
+        buffer[digits] = '0' + value % 10;
+        value /= 10;
+    }
+}
+
+/**
+ * @brief   append text to a log, the text is cut off if the buffer is full.
+ * @param   buffer is where the log is formatted to.
+ * @param   size is the size of {@code buffer}.
+ * @return  the length of the log as if it were not cut off, like snprintf.
+ */
+static __inline uint32_t _formatter_append(char *buffer, uint32_t size, uint32_t length, const char *text, uint32_t count){
+    if(length < size - 1){
+        memcpy(buffer + length, text, count < size - 1 - length ? count : size - 1 - length);
+    }
+    return length + count;
+}
+
+/**
+ * @brief   render an unsigned number in decimal.
+ * @param   text is where the number is rendered to, 20 bytes at least.
+ * @return  the length of the number.
+ */
+static uint32_t _formatter_number(char *text, uint64_t value){
+    char digits[20];
+    uint32_t length = 0;
+
+    do{
+        digits[length++] = '0' + value % 10;
+        value /= 10;
+    }while(value);
+
+    for(uint32_t i = 0; i < length; ++i){
+        text[i] = digits[length - 1 - i];
+    }
+    return length;
+}
+
+/**
+ * @brief   render the timestamp of a log.
+ * @param   formatter is pointer to formatter.
+ * @param   text is where the timestamp is rendered to, {@code SIZE_OF_TIMESTAMP} bytes at least.
+ * @param   ns is the time of the log in nanoseconds since the epoch.
+ * @return  the length of the timestamp.
+ */
+static uint32_t _formatter_timestamp(struct formatter *formatter, char *text, uint64_t ns){
+    struct timestampCache *cache = &timestampCache;
+    time_t t = (time_t)(ns / 1000000000ull);
+    uint32_t fraction = ns % 1000000000ull;
+    log_precision_t precision = __atomic_load_n(&formatter->precision, __ATOMIC_RELAXED);
+    uint32_t digits = precision_digits[precision];
+
+    if(t != cache->second){
+        struct tm tm;
+        localtime_r(&t, &tm);
+        /* show the time format MM-DD HH:MM:SS */
+        cache->length = snprintf(cache->text, sizeof(cache->text), "%02d-%02d %02d:%02d:%02d", 
+            tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+        cache->second = t;
+    }
+    memcpy(text, cache->text, cache->length);
+
+    /* show the fraction of second */
+    text[cache->length] = '.';
+    _formatter_digits(text + cache->length + 1, fraction / precision_divisor[precision], digits);
+    return cache->length + 1 + digits;
+}
+
+/**
+ * @brief   run the ops of the compiled layout.
+ *
+ * @param   formatter is pointer to formatter.
+ * @param   buffer is where the log is formatted to.
+ * @param   size is the size of {@code buffer}.
+ * @param   length is the length of the log.
+ * @param   from is the first op to run.
+ * @param   to is the op after the last op to run.
+ * @param   tag is tag of current log.
+ * @param   level is level of current log.
+ * @param   context is the context of current log.
+ * @return  the length of the log as if it were not cut off.
+ */
+static uint32_t _formatter_run(struct formatter *formatter, char *buffer, uint32_t size, uint32_t length, uint32_t from, uint32_t to,
+    const char *tag, level_t level, const logContext_t *context){
+    const layout_t *layout = context->layout;
+    const struct layoutOp *op;
+    char text[SIZE_OF_TIMESTAMP];
+
+    for(op = &layout->ops[from]; op < &layout->ops[to]; ++op){
+        switch(op->code){
+            case LAYOUT_LITERAL:
+                length = _formatter_append(buffer, size, length, layout->literals + op->offset, op->length);
+                break;
+            case LAYOUT_TIMESTAMP:
+                length = _formatter_append(buffer, size, length, text, _formatter_timestamp(formatter, text, context->time));
+                break;
+            case LAYOUT_LEVEL:
+                length = _formatter_append(buffer, size, length, &level_letter[level], 1);
+                break;
+            case LAYOUT_LEVEL_NAME:
+                length = _formatter_append(buffer, size, length, level_name[level], level_name_length[level]);
+                break;
+            case LAYOUT_TAG:
+                tag = tag ? tag : "(null)";     //! the same as printf does.
+                length = _formatter_append(buffer, size, length, tag, strlen(tag));
+                break;
+            case LAYOUT_TID:
+                length = _formatter_append(buffer, size, length, context->thread.tid, context->thread.tidLength);
+                break;
+            case LAYOUT_THREAD_NAME:
+                length = _formatter_append(buffer, size, length, context->thread.name, context->thread.nameLength);
+                break;
+            case LAYOUT_PID:
+                if(processId == 0){
+                    processId = getpid();
+                }
+                length = _formatter_append(buffer, size, length, text, _formatter_number(text, processId));
+                break;
+            case LAYOUT_SEQUENCE:
+                length = _formatter_append(buffer, size, length, text, _formatter_number(text, context->sequence));
+                break;
+            case LAYOUT_CPU:
+                if(context->cpu < 0){
+                    length = _formatter_append(buffer, size, length, "-", 1);   //! the cpu is unknown.
+                    break;
+                }
+                length = _formatter_append(buffer, size, length, text, _formatter_number(text, context->cpu));
+                break;
+            default:
+                break;
         }
     }
+    return length;
+}
 
-    return true;
+/**
+ * @brief   format the header of a log, the fields before the message.
+ *
+ * @param   formatter is pointer to formatter.
+ * @param   buffer is where the log is formatted to.
+ * @param   tag is tag of current log.
+ * @param   level is level of current log.
+ * @param   context is the context of current log.
+ * @return  the length of the header.
+ * @note    the color is not a part of the text, see {@code writerSegments}.
+ */
+static uint32_t _formatter_header(struct formatter *formatter, char *buffer, const char *tag, level_t level, const logContext_t *context){
+    uint32_t length = _formatter_run(formatter, buffer, SIZE_OF_LOG_BUFFER, 0, 0, context->layout->numberOfHeaderOps, tag, level, context);
+
+    //! the message is cut off then, if the header fills the buffer.
+    return length < SIZE_OF_LOG_BUFFER - 1 ? length : SIZE_OF_LOG_BUFFER - 1;
+}
+
+/**
+ * @brief   format the fields after the message, cut off the log and end it.
+ *
+ * @param   formatter is pointer to formatter.
+ * @param   buffer is where the log is formatted to.
+ * @param   size is the size of {@code buffer}.
+ * @param   length is the length of the log, may be larger than the buffer.
+ * @param   tag is tag of current log.
+ * @param   level is level of current log.
+ * @param   context is the context of current log.
+ * @return  the length of the log.
+ * @note    a log cut off ends with {@code LOG_TRUNCATION_MARK}.
+ */
+static uint32_t _formatter_tail(struct formatter *formatter, char *buffer, uint32_t size, uint32_t length,
+    const char *tag, level_t level, const logContext_t *context){
+    const layout_t *layout = context->layout;
+    bool truncated = length > size - 1;
+
+    if(layout->numberOfOps > layout->numberOfHeaderOps + 1){
+        if(truncated){
+            length = size - 1;
+        }
+        length = _formatter_run(formatter, buffer, size, length, layout->numberOfHeaderOps + 1, 
+            layout->numberOfOps, tag, level, context);
+        truncated = truncated || length > size - 1;
+    }
+
+    //! cut off, and reserve some space for string end sign.
+    if(truncated){
+        length = size - sizeof((char)'\0');
+        memcpy(buffer + length - (sizeof(LOG_TRUNCATION_MARK) - 1), LOG_TRUNCATION_MARK,
+            sizeof(LOG_TRUNCATION_MARK) - 1);
+    }
+
+    buffer[length] = '\0';
+    return length;
+}
+
+/**
+ * @brief   put the location of the callsite of a log after its header.
+ * @param   buffer is where the log is formatted to, {@code SIZE_OF_LOG_BUFFER} bytes.
+ * @param   length is the length of the header.
+ * @param   site is the callsite of the log, NULL means none.
+ * @return  the length of the log, the message is cut off then if the location fills the buffer.
+ */
+static uint32_t _formatter_location(char *buffer, uint32_t length, const qlog_site_t *site){
+    const char *prefix;
+    char text[SIZE_OF_TIMESTAMP];
+
+    if(site == NULL){
+        return length;
+    }
+    prefix = __atomic_load_n(&site->prefix, __ATOMIC_ACQUIRE);
+    if(prefix != NULL){
+        length = _formatter_append(buffer, SIZE_OF_LOG_BUFFER, length, prefix,
+            __atomic_load_n(&site->prefixLength, __ATOMIC_RELAXED));
+    }else{
+        //! the location is rendered when the callsite is enabled, unless it was out of memory.
+        length = _formatter_append(buffer, SIZE_OF_LOG_BUFFER, length, "[", 1);
+        length = _formatter_append(buffer, SIZE_OF_LOG_BUFFER, length, site->file, strlen(site->file));
+        length = _formatter_append(buffer, SIZE_OF_LOG_BUFFER, length, ":", 1);
+        length = _formatter_append(buffer, SIZE_OF_LOG_BUFFER, length, text, _formatter_number(text, site->line));
+        length = _formatter_append(buffer, SIZE_OF_LOG_BUFFER, length, "](#", 3);
+        length = _formatter_append(buffer, SIZE_OF_LOG_BUFFER, length, site->function, strlen(site->function));
+        length = _formatter_append(buffer, SIZE_OF_LOG_BUFFER, length, ") ", 2);
+    }
+    return length < SIZE_OF_LOG_BUFFER - 1 ? length : SIZE_OF_LOG_BUFFER - 1;
+}
+
+/**
+ * @brief   set the name of current thread shown in logs.
+ * @param   name is the name, it is cut off to {@code SIZE_OF_THREAD_NAME} bytes,
+ *          NULL means the name of the thread given by the system.
+ */
+void formatterSetThreadName(const char *name){
+    struct threadIdentity *identity = &threadIdentity;
+
+    threadNamed = name != NULL;
+    if(name != NULL){
+        identity->nameLength = strnlen(name, sizeof(identity->name));
+        memcpy(identity->name, name, identity->nameLength);
+    }
+}
+
+/**
+ * @brief   get the identity of current thread, it is resolved at the first log of thread.
+ */
+static const struct threadIdentity *_formatter_thread(void){
+    struct threadIdentity *identity = &threadIdentity;
+    char name[SIZE_OF_THREAD_NAME < 16 ? 16 : SIZE_OF_THREAD_NAME];     //! pthread_getname_np needs 16 bytes.
+
+    if(identity->tidLength == 0){
+        identity->tidLength = _formatter_number(identity->tid, (uint32_t)syscall(SYS_gettid));
+    }
+    if(!threadNamed){
+        if(pthread_getname_np(pthread_self(), name, sizeof(name)) != 0){
+            name[0] = '\0';
+        }
+        formatterSetThreadName(name);
+    }
+    return identity;
+}
+
+/**
+ * @brief   capture the context used by the layout on the calling thread.
+ * @param   formatter is pointer to formatter.
+ * @param   context is where the context is captured to.
+ * @note    the layout is captured as well, so the log is rendered by the layout its context
+ *          is captured for, even if the layout is replaced meanwhile.
+ */
+void _formatter_capture(struct formatter *formatter, logContext_t *context){
+    const layout_t *layout = __atomic_load_n(&formatter->layout, __ATOMIC_ACQUIRE);
+    uint32_t fields = layout->fields;
+
+    context->layout = layout;
+    if(fields & (1 << LAYOUT_TIMESTAMP)){
+        context->time = formatter->now(formatter);
+    }
+    if(fields & (1 << LAYOUT_SEQUENCE)){
+        context->sequence = __atomic_fetch_add(&formatter->sequence, 1, __ATOMIC_RELAXED);
+    }
+    if(fields & (1 << LAYOUT_TID | 1 << LAYOUT_THREAD_NAME)){
+        context->thread = *_formatter_thread();
+    }
+    if(fields & (1 << LAYOUT_CPU)){
+        context->cpu = sched_getcpu();
+    }
 }
 
 /**
  * @brief   invoke a formatter.
  *
  * @param   formatter is pointer to formatter.
+ * @param   buffer is where the log is formatted to, it is set to a block of arena if the log
+ *          is longer than {@code SIZE_OF_LOG_BUFFER}.
+ * @param   site is the callsite of current log, NULL means none.
  * @param   tag is tag of current log.
  * @param   level is level of current log.
  * @param   format is format string of current log.
  * @param   args is the arguments list.   
  * @return  the length of format string.   
+ * @note    the log is cut off if it is longer than {@code SIZE_OF_LOG_TEXT} or the arena is exhausted.
  */
-int32_t _formatter_invoke(struct formatter *formatter, const char *tag, level_t level, const char *format, va_list args){
-    uint32_t length;
-    uint32_t colorEndLength = 0;
-    assert(formatter != NULL && formatter->buffer != NULL);
+int32_t _formatter_invoke(struct formatter *formatter, char **buffer, const qlog_site_t *site, const char *tag,
+                          level_t level, const char *format, va_list args){
+    logContext_t context;
+    uint32_t header, length, size;
+    char *text, *block;
+    va_list copy;
+    assert(formatter != NULL && buffer != NULL && *buffer != NULL);
     // assert(tag != NULL);
     assert(format != NULL);
     assert(level < LOG_LEVEL_BUTT);
 
-    length = 0;
-    //! color start.
-    if(formatter->color){
-        memcpy(formatter->buffer, LOG_COLOR_START, sizeof(LOG_COLOR_START) - 1);
-        length += sizeof(LOG_COLOR_START) - 1;
+    text = *buffer;
+    size = SIZE_OF_LOG_BUFFER;
+    formatter->capture(formatter, &context);
+    header = _formatter_header(formatter, text, tag, level, &context);
+    header = _formatter_location(text, header, site);
 
-        memcpy(formatter->buffer + length, color_info[level], strlen(color_info[level]));
-        length += strlen(color_info[level]);
+    //! append content
+    va_copy(copy, args);
+    length = header + vsnprintf(text + header, size - header, format, args);
 
-        colorEndLength = sizeof(LOG_COLOR_END) - 1; 
+    //! a longer log is formatted again into a block of the right size, the fields after the
+    //! message are bounded by the texts and the fields of layout.
+    if(length > size - 1 && formatter->arena != NULL){
+        size = length + 1 + SIZE_OF_LAYOUT + (context.layout->numberOfOps - context.layout->numberOfHeaderOps) * SIZE_OF_TIMESTAMP;
+        size = size < SIZE_OF_LOG_TEXT ? size : SIZE_OF_LOG_TEXT;
+        block = (char *)memoryArenaAlloc(formatter->arena, size);
+        if(block != NULL){
+            memcpy(block, text, header);
+            vsnprintf(block + header, size - header, format, copy);
+            text = *buffer = block;
+        }else{
+            size = SIZE_OF_LOG_BUFFER;
+        }
     }
+    va_end(copy);
 
-    //! timestamp
-    if(formatter->timestamp){
-        static struct timeval now;
-        static struct tm *tm, tm_tmp;
-        time_t t = (time_t)0;
+    return _formatter_tail(formatter, text, size, length, tag, level, &context);
+}
 
-        if (gettimeofday(&now, NULL) >= 0)
-        {
-            t = now.tv_sec;
-        }
-        tm = localtime_r(&t, &tm_tmp);
-        /* show the time format MM-DD HH:MM:SS */
-        snprintf(formatter->buffer + length, SIZE_OF_LOG_BUFFER - length, "%02d-%02d %02d:%02d:%02d", tm->tm_mon + 1,
-                tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec);
+/**
+ * @brief   give back a log formatted into a block of arena.
+ * @param   formatter is pointer to formatter.
+ * @param   buffer is the log set by {@code _formatter_invoke}.
+ */
+void _formatter_release(struct formatter *formatter, char *buffer){
+    assert(formatter != NULL && formatter->arena != NULL && buffer != NULL);
+    memoryArenaFree(formatter->arena, buffer);
+}
 
-        /* show the millisecond */
-        length += strlen(formatter->buffer + length);
-        snprintf(formatter->buffer + length, SIZE_OF_LOG_BUFFER - length, ".%03ld ", now.tv_usec / 1000);
-        length += strlen(formatter->buffer + length);
-    }
+/**
+ * @brief   render a log captured by {@code deferredCapture}.
+ *
+ * @param   formatter is pointer to formatter.
+ * @param   buffer is where the log is formatted to.
+ * @param   level is level of the log.
+ * @param   record is the captured log.
+ * @return  the length of format string, the same as {@code _formatter_invoke} returns.
+ */
+int32_t _formatter_render(struct formatter *formatter, char *buffer, level_t level, const deferredRecord_t *record){
+    uint32_t length;
+    int32_t formatted;
+    const char *tag, *args;
+    assert(formatter != NULL && buffer != NULL);
+    assert(record != NULL);
+    assert(level < LOG_LEVEL_BUTT);
 
-    //! level info
-    memcpy(formatter->buffer + length, level_info[level], strlen(level_info[level]));
-    length += strlen(level_info[level]);
+    tag = deferredTag(record);
+    length = _formatter_header(formatter, buffer, tag, level, &record->context);
+    length = _formatter_location(buffer, length, record->site);
 
-    //! tag info
-    memcpy(formatter->buffer + length, tag, strlen(tag));
-    length += strlen(tag);
+    //! append content
+    args = tag + strlen(tag) + 1;
+    formatted = deferredFormat(buffer + length, SIZE_OF_LOG_BUFFER - length, 
+        record->format, args, record->size - (args - record->data));
+    //! a record captured by {@code deferredCapture} always matches its format.
+    assert(formatted >= 0);
+    length += formatted >= 0 ? (uint32_t)formatted : strlen(buffer + length);
 
-    //! append ": " 
-    formatter->buffer[length++] = ':';
-    formatter->buffer[length++] = ' ';
+    return _formatter_tail(formatter, buffer, SIZE_OF_LOG_BUFFER, length, tag, level, &record->context);
+}
 
-    //! append content
-    length += vsnprintf(formatter->buffer + length, SIZE_OF_LOG_BUFFER - length, format, args);
+/**
+ * @brief   compile a layout pattern.
+ *
+ * @param   layout is where the pattern is compiled to.
+ * @param   pattern is the layout pattern, e.g. "%d %L/%T: %m". 
+ *          %d timestamp, %L level letter, %l level name, %T tag, %t thread id, %N thread name,
+ *          %p process id, %n sequence number, %c cpu, %m message, %% a '%'.
+ * @return  false if the pattern is invalid, or too long, or has no exact one %m.
+ */
+static bool _layout_compile(layout_t *layout, const char *pattern){
+    static const char fields[LAYOUT_BUTT] = {
+        [LAYOUT_TIMESTAMP] = 'd', [LAYOUT_LEVEL] = 'L', [LAYOUT_LEVEL_NAME] = 'l',
+        [LAYOUT_TAG] = 'T', [LAYOUT_TID] = 't', [LAYOUT_THREAD_NAME] = 'N', [LAYOUT_PID] = 'p',
+        [LAYOUT_SEQUENCE] = 'n', [LAYOUT_CPU] = 'c', [LAYOUT_MESSAGE] = 'm',
+    };
+    struct layoutOp *op = NULL;
+    uint32_t literalLength = 0;
+    const char *p;
+    uint8_t code;
 
-    //! cut off.
-    if(length + colorEndLength + sizeof((char)'\0') > SIZE_OF_LOG_BUFFER){
-        /* using max length */
-        length = SIZE_OF_LOG_BUFFER;
-        /* reserve some space for CSI end sign */
-        length -= colorEndLength;
-        /* reserve some space for string end sign */
-        length -= sizeof((char)'\0');
-    }
+    memset(layout, 0, sizeof(*layout));
+    for(p = pattern; *p; ++p){
+        code = LAYOUT_LITERAL;
+        if(*p == '%' && *++p != '%'){
+            for(code = LAYOUT_LITERAL + 1; code < LAYOUT_BUTT && fields[code] != *p; ++code);
+            if(code == LAYOUT_BUTT){
+                return false;
+            }
+        }
+
+        if(code == LAYOUT_LITERAL){
+            if(literalLength >= SIZE_OF_LAYOUT || (op && op->code == LAYOUT_LITERAL && op->length == UINT8_MAX)){
+                return false;
+            }
+            layout->literals[literalLength] = *p;
+            //! merge the text into the last op if possible.
+            if(op == NULL || op->code != LAYOUT_LITERAL){
+                if(layout->numberOfOps >= COUNT_OF_LAYOUT_OP){
+                    return false;
+                }
+                op = &layout->ops[layout->numberOfOps++];
+                op->code = LAYOUT_LITERAL;
+                op->offset = literalLength;
+                op->length = 0;
+            }
+            op->length++;
+            literalLength++;
+            continue;
+        }
 
-    if(formatter->color){
-        memcpy(formatter->buffer + length, LOG_COLOR_END, colorEndLength);
-        length += colorEndLength;
+        if(layout->numberOfOps >= COUNT_OF_LAYOUT_OP || (layout->fields & (1 << code) && code == LAYOUT_MESSAGE)){
+            return false;
+        }
+        if(code == LAYOUT_MESSAGE){
+            layout->numberOfHeaderOps = layout->numberOfOps;
+        }
+        op = &layout->ops[layout->numberOfOps++];
+        op->code = code;
+        layout->fields |= 1 << code;
     }
 
-    formatter->buffer[length] = '\0';
-    return length;
+    return (layout->fields & (1 << LAYOUT_MESSAGE)) != 0;
 }
 
 /**
@@ -305,14 +1198,24 @@ void _consoleWriter_write(struct writer *writer){
     assert(writer != NULL);
     assert(writer->buffer != NULL);
 
-    if(writer->enable == false) return;
+    if(writerAccepts(writer) && writer->length > 0){
+        struct iovec segments[LOG_SEGMENT_BUTT];
+        int count = writerSegments(writer, segments);
 
-    console_puts(writer->buffer);
+        //! the color codes and the text are written at once, without joining them.
+        console_write(segments, count);
+        statsAdd(&writer->stats.records, 1);
+        for(int i = 0; i < count; ++i){
+            statsAdd(&writer->stats.bytes, segments[i].iov_len);
+        }
+    }
 
     writer_t *nextWriter = writer->next;
     if(nextWriter){
         nextWriter->length = writer->length;
-        nextWriter->color = writer->color;  //! used for filtering color info of log buffer.
+        nextWriter->color = writer->color;
+        nextWriter->level = writer->level;
+        nextWriter->record = writer->record;
         nextWriter->write(nextWriter);
     }
 }
@@ -320,21 +1223,49 @@ void _consoleWriter_write(struct writer *writer){
 /**
  * @brief  initialise a filter. 
  * @param  filter is pointer to filter.
- * @param  mp is pointer to memory pool, where {@code filter_tag} will be allocated. 
- * @param  buffer is pointer to the log buffer. 
+ * @param  table is the first table of the filter.
+ * @param  tags is the storage of the first table where tags are interned.
+ * @param  sizeOfTable is the number of entries of {@code tags}, must be a power of 2.
+ * @param  capacity is the maximum number of tags, less than {@code sizeOfTable}.
  * @param  level is level of the log. 
  * @see     
  */
-void filterInit(struct filter *filter, memoryPool_t *mp, char *buffer, level_t level){
-    assert(filter != NULL);
+void filterInit(struct filter *filter, filter_table_t *table, filter_tag_t *tags, uint32_t sizeOfTable,
+                uint32_t capacity, level_t level){
+    assert(filter != NULL && table != NULL && tags != NULL);
     assert(level < LOG_LEVEL_BUTT);
+    assert(sizeOfTable > 0 && (sizeOfTable & (sizeOfTable - 1)) == 0);
+    assert(capacity < sizeOfTable);
 
+    memset(tags, 0, sizeOfTable * sizeof(filter_tag_t));
+    table->tags = tags;
+    table->mask = sizeOfTable - 1;
+    table->count = 0;
+    table->others = FILTER_LEVEL_NONE;
+    filter->table = table;
+    filter->tables[0] = table;
+    filter->tables[1] = NULL;
+    filter->sequence = 0;
+    filter->capacity = capacity;
     filter->level = level;
-    slist_init(&filter->list_tag);
-    filter->buffer = buffer;
     filter->append = _filter_append;
+    filter->find = _filter_find;
     filter->invoke = _filter_invoke;
-    filter->tagMemoryPool = mp;
+    filter->replace = _filter_replace;
+    filter->ceiling = _filter_ceiling;
+}
+
+/**
+ * @brief  free the table allocated by replacement, and go back to the first table.
+ * @param  filter is pointer to filter.
+ * @note   no log may be filtered by it meanwhile.
+ */
+void filterDeInit(struct filter *filter){
+    assert(filter != NULL);
+
+    free(filter->tables[1]);
+    filter->tables[1] = NULL;
+    filter->table = filter->tables[0];
 }
 
 /**
@@ -351,8 +1282,136 @@ void formatterInit(struct formatter *formatter, bool color, bool timestamp, char
     assert(buffer != NULL);
     formatter->buffer = buffer;
     formatter->color = color;
-    formatter->timestamp = timestamp;
+    formatter->deferred = false;
+    formatter->sequence = 0;
+    formatter->now = _formatter_now;
+    formatter->capture = _formatter_capture;
+    if(!atforkRegistered){
+        pthread_atfork(NULL, NULL, _formatter_atfork);
+        atforkRegistered = true;
+    }
+    formatter->layout = NULL;
+    memset(formatter->clocks, 0, sizeof(formatter->clocks));
+    formatter->clockSequence = 0;
+    formatterSetClock(formatter, LOG_CLOCK_REALTIME, LOG_PRECISION_MS);
+    formatterSetLayout(formatter, timestamp ? LAYOUT_DEFAULT_TIMESTAMP : LAYOUT_DEFAULT);
     formatter->invoke = _formatter_invoke;
+    formatter->render = _formatter_render;
+    formatter->release = _formatter_release;
+    formatter->arena = NULL;
+#if COUNT_OF_LOG_CLASS
+    pthread_once(&logArenaOnce, _logArena_init);
+    formatter->arena = &logArena;
+#endif
+}
+
+/**
+ * @brief   set the clock source and precision of timestamp.
+ * @param   formatter is pointer to formatter.
+ * @param   clock is the clock source.
+ * @param   precision is the precision of the fraction of second.
+ * @note    the cpu counter is calibrated against CLOCK_MONOTONIC for several milliseconds, 
+ *          it falls back to CLOCK_MONOTONIC if the cpu counter is not supported. the callers
+ *          must be serialized, the threads reading the clock meanwhile see either the old
+ *          clock or the new one.
+ */
+void formatterSetClock(struct formatter *formatter, log_clock_t clock, log_precision_t precision){
+    struct logClock next = { .source = clock };
+    uint64_t ticks, ns, elapsed;
+    uint32_t sequence;
+    assert(formatter != NULL);
+    assert(clock < LOG_CLOCK_BUTT && precision < LOG_PRECISION_BUTT);
+
+    if(clock == LOG_CLOCK_TSC && tsc_read() == 0){
+        next.source = LOG_CLOCK_MONOTONIC;
+    }
+
+    if(next.source == LOG_CLOCK_TSC){
+        ticks = tsc_read();
+        next.offset = _clock_ns(CLOCK_REALTIME);    //! realtime at the base ticks.
+        ns = _clock_ns(CLOCK_MONOTONIC);
+        do{
+            elapsed = _clock_ns(CLOCK_MONOTONIC) - ns;
+        }while(elapsed < SIZE_OF_CALIBRATION);
+        next.nsPerTick = (elapsed << 32) / (tsc_read() - ticks);
+        next.ticksBase = ticks;
+    }else if(next.source == LOG_CLOCK_MONOTONIC){
+        next.offset = _clock_ns(CLOCK_REALTIME) - _clock_ns(CLOCK_MONOTONIC);
+    }
+
+    //! the readers go to the odd copy while the even one is changed, then back.
+    sequence = formatter->clockSequence;
+    __atomic_store_n(&formatter->clockSequence, sequence | 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    formatter->clocks[0] = next;
+    __atomic_store_n(&formatter->clockSequence, (sequence | 1) + 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    formatter->clocks[1] = next;
+
+    __atomic_store_n(&formatter->precision, precision, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief   set the layout of formatter.
+ * @param   formatter is pointer to formatter.
+ * @param   pattern is the layout pattern, see {@code _layout_compile}.
+ * @return  false if the pattern is invalid or out of memory, and the layout is not changed.
+ * @note    the callers must be serialized. a new layout is compiled aside and swapped in at
+ *          once, the layout replaced is retired rather than freed, until {@code formatterDeInit},
+ *          as the logs captured for it may still be rendered by it.
+ */
+bool formatterSetLayout(struct formatter *formatter, const char *pattern){
+    layout_t *layout;
+    assert(formatter != NULL && pattern != NULL);
+
+    //! the first layout is compiled into the formatter itself.
+    if(formatter->layout == NULL){
+        if(!_layout_compile(&formatter->first, pattern)){
+            return false;
+        }
+        __atomic_store_n(&formatter->layout, &formatter->first, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    layout = (layout_t *)malloc(sizeof(layout_t));
+    if(layout == NULL){
+        return false;
+    }
+    if(!_layout_compile(layout, pattern)){
+        free(layout);
+        return false;
+    }
+    layout->retired = formatter->layout;
+    __atomic_store_n(&formatter->layout, layout, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief   free the layouts replaced, and go back to the first layout.
+ * @param   formatter is pointer to formatter.
+ * @note    no log may be formatted by it meanwhile.
+ */
+void formatterDeInit(struct formatter *formatter){
+    layout_t *layout, *retired;
+    assert(formatter != NULL);
+
+    for(layout = formatter->layout; layout != NULL && layout->retired != NULL; layout = retired){
+        retired = layout->retired;
+        free(layout);
+    }
+    formatter->layout = layout;
+}
+
+/**
+ * @brief   write a text to console at crash, the logs buffered by stdio can not be written safely.
+ * @param   writer is pointer to writer.
+ * @param   text is the text to write, NULL means the logs kept, which are none.
+ * @param   length is the length of {@code text}.
+ */
+void _consoleWriter_emergency(struct writer *writer, const char *text, int32_t length){
+    if(text != NULL){
+        writerWriteAll(STDOUT_FILENO, text, length);
+    }
 }
 
 /**
@@ -369,6 +1428,7 @@ void consoleWriterInit(struct writer *writer, char *buffer, bool enable){
     writer->buffer = buffer;
     writer->next = NULL;
     writer->write = _consoleWriter_write;
+    writer->emergency = _consoleWriter_emergency;
     writer->enable = true;
 }
 
@@ -402,6 +1462,9 @@ void loggerInit(logger_t *logger, level_t level,
     logger->registerWriter = _registerWriter;
 
     logger->locker = locker;
+    logger->async = NULL;
+    logger->limiter = NULL;
+    memset(&logger->stats, 0, sizeof(logger->stats));
 }
 
 /**
@@ -431,7 +1494,19 @@ void lockerInit(struct locker *locker, void *mutex){
 
     locker->locker = mutex;
     locker->lock = _locker_lock;
+    locker->tryLock = _locker_tryLock;
     locker->unlock = _locker_unlock;
 }
 
+/**
+ * @brief   deinitialise a locker, the mutex is given back to the platform.
+ * @param   locker is pointer to a locker.
+ */
+void lockerDeInit(struct locker *locker){
+    assert(locker != NULL);
+
+    locker_deinit(locker->locker);
+    locker->locker = NULL;
+}
+
 
@@ -9,22 +9,289 @@
 
 /* Includes --------------------------------------------------------------------------------*/
 #include "qlog_api.h"
-#include "mempool.h"
 #include "qlog.h"
+#include "qlog_async.h"
 #include "qlog_fileWriter.h"
+#include "qlog_mmapWriter.h"
+#include "qlog_binaryWriter.h"
+#include "qlog_flightWriter.h"
+#include "qlog_queueWriter.h"
+#include "qlog_socketWriter.h"
+#include "qlog_limiter.h"
+#include "qlog_config.h"
 #include "qlog_port.h"
 #include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
 
-#define SIZE_OF_TAG         sizeof(filter_tag_t)
-#define SIZE_OF_TAG_BLOCK   (sizeof(uint8_t *) + SIZE_OF_TAG)
-#define SIZE_OF_TAG_POOL    (COUNT_OF_TAG * SIZE_OF_TAG_BLOCK)
+#define SIZE_OF_TAG_TABLE   (COUNT_OF_TAG * 2)  //! keep the table half empty at most.
 
-static logger_t *logger_unique; //! global unique logger.
+/**
+ * a logger with everything it owns, a logger handle is cast to its instance.
+ */
+struct qlogInstance{
+    logger_t logger;                //! must be the first member.
+    filter_t filter;
+    formatter_t formatter;
+    writer_t consoleWriter;         //! the first writer of the chain.
+    filter_table_t table;           //! the first table of filter.
+    filter_tag_t tags[SIZE_OF_TAG_TABLE];
+    locker_t locker;
+    bool timestamp;                 //! the default layout has timestamp.
+
+    //! the writers created by the api, a writer is registered once its write method is set.
+    fileWriter_t fileWriter;
+    mmapWriter_t mmapWriter;
+    binaryWriter_t binaryWriter;
+    flightWriter_t flightWriter;
+    socketWriter_t socketWriter;
+
+    asyncLogger_t async;
+    limiter_t limiter;              //! attached to logger once it is configured.
+    statsReporter_t statsReporter;  //! periodic dump of the counters.
+    configWatcher_t configWatcher;  //! reloads the config file once it changes.
+    struct qlogInstance *next;      //! next living instance.
+};
+typedef struct qlogInstance qlogInstance_t;
+
+static qlogInstance_t instance_unique;  //! the default logger.
+static logger_t *logger_unique; //! the default logger once initialised.
+
+static pthread_mutex_t instancesLock = PTHREAD_MUTEX_INITIALIZER;
+static qlogInstance_t *instances;   //! the living instances, stopped at exit.
+static pthread_once_t exitOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * generation of the logger configuration, always even, the cached state of callsites
+ * is stale once it changes. it starts from 2 so that zeroed callsites are stale.
+ */
+uint32_t qlog_generation = 2;
+
+/**
+ * @brief   invalidate the cached state of all the callsites.
+ */
+static void _qlog_invalidate(void){
+    __atomic_add_fetch(&qlog_generation, 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief   get the instance of a logger.
+ * @param   logger is the logger, NULL means the default logger.
+ */
+static qlogInstance_t *_qlog_instance(logger_t *logger){
+    if(logger == NULL){
+        logger = logger_unique;
+    }
+    assert(logger != NULL);
+    return (qlogInstance_t *)logger;
+}
+
+/**
+ * @brief   check whether a writer created by the api is registered.
+ */
+static bool _qlog_registered(writer_t *writer){
+    return writer->write != NULL;
+}
+
+/**
+ * @brief   stop the reporter, the asynchronous backend and the flushers of an instance.
+ * @note    logs output later, e.g. by the handlers at exit, are written synchronously.
+ */
+static void _qlog_stop(qlogInstance_t *instance){
+    writer_t *writers[] = {
+        &instance->fileWriter.super, &instance->mmapWriter.super, &instance->binaryWriter.super,
+        &instance->flightWriter.super, &instance->socketWriter.super
+    };
+    locker_t *locker = &instance->locker;
+
+    configWatcherStop(&instance->configWatcher);
+    statsReporterStop(&instance->statsReporter);
+    if(instance->logger.async != NULL){
+        asyncLoggerDeInit(instance->logger.async);
+    }
+
+    locker->lock(locker);
+    //! the queues are written to their writers before the writers are stopped.
+    for(writer_t *writer = instance->logger.writer; writer != NULL; writer = writer->next){
+        if(writer->inner != NULL){
+            writer->deInit(writer);
+        }
+    }
+    for(size_t i = 0; i < sizeof(writers) / sizeof(writers[0]); ++i){
+        if(_qlog_registered(writers[i])){
+            writers[i]->deInit(writers[i]);
+        }
+    }
+    locker->unlock(locker);
+}
+
+/**
+ * @brief   write all the logs buffered by the living instances at exit.
+ */
+static void _qlog_exit(void){
+    qlogInstance_t *instance;
+
+    pthread_mutex_lock(&instancesLock);
+    for(instance = instances; instance != NULL; instance = instance->next){
+        _qlog_stop(instance);
+    }
+    pthread_mutex_unlock(&instancesLock);
+}
+
+static void _qlog_registerExit(void){
+    atexit(_qlog_exit);
+}
+
+static void _qlog_applyConfig(void *context, const config_t *previous, const config_t *config);
+
+/**
+ * @brief   initialise the logger of an instance with a console writer.
+ */
+static void _qlog_instanceInit(qlogInstance_t *instance, level_t level, bool color, bool timestamp, size_t tag_count){
+    void *mutex;
+    assert(level < LOG_LEVEL_BUTT);
+    assert(tag_count <= COUNT_OF_TAG);
+
+    //! initialise a locker for logger.
+    mutex = locker_init(NULL);
+    assert(mutex != NULL);
+    lockerInit(&instance->locker, mutex);
+
+    filterInit(&instance->filter, &instance->table, instance->tags, SIZE_OF_TAG_TABLE, tag_count, level);
+    limiterInit(&instance->limiter);
+    configWatcherInit(&instance->configWatcher, _qlog_applyConfig, instance);
+    formatterInit(&instance->formatter, color, timestamp, instance->logger.buffer);
+    consoleWriterInit(&instance->consoleWriter, instance->logger.buffer, true);
+    loggerInit(&instance->logger, level, &instance->formatter, &instance->consoleWriter,
+        &instance->filter, &instance->locker);
+    instance->timestamp = timestamp;
+
+    pthread_once(&exitOnce, _qlog_registerExit);
+}
+
+/**
+ * @brief   render the location of a callsite once, it is copied by each log of the callsite.
+ * @param   site is the callsite.
+ * @note    the formatter renders the location itself if it is out of memory.
+ */
+static void _qlog_sitePrefix(qlog_site_t *site){
+    const char *expected = NULL;
+    char *prefix;
+    int length;
+
+    if(__atomic_load_n(&site->prefix, __ATOMIC_ACQUIRE) != NULL){
+        return;
+    }
+    length = snprintf(NULL, 0, "[%s:%u](#%s) ", site->file, site->line, site->function);
+    if(length < 0 || length > UINT16_MAX || (prefix = (char *)malloc(length + 1)) == NULL){
+        return;
+    }
+    snprintf(prefix, length + 1, "[%s:%u](#%s) ", site->file, site->line, site->function);
+
+    //! the callsites are static, so the location lives as long as the program.
+    __atomic_store_n(&site->prefixLength, (uint16_t)length, __ATOMIC_RELAXED);
+    if(!__atomic_compare_exchange_n(&site->prefix, &expected, prefix, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)){
+        free(prefix);
+    }
+}
+
+/**
+ * @brief   get the state of a callsite.
+ * @param   logger is the logger of callsite, NULL means the default logger.
+ * @param   site is the callsite.
+ * @return  current generation, with the lowest bit set if the callsite is enabled.
+ * @note    if the tag of callsite may vary, only the logs no tag lets pass are cut off by
+ *          it, the rest are filtered by their tag for every log.
+ */
+uint32_t qlog_callsite(logger_t *logger, qlog_site_t *site){
+    uint32_t generation = __atomic_load_n(&qlog_generation, __ATOMIC_ACQUIRE);
+    level_t level = (level_t)site->level;
+
+    if(logger == NULL){
+        logger = logger_unique;
+    }
+    if(logger == NULL || __atomic_load_n(&site->disabled, __ATOMIC_RELAXED) ||
+        (site->tag == NULL ? level > __atomic_load_n(&logger->level, __ATOMIC_RELAXED) :
+                             !loggerFilter(logger, site->tag, level))){
+        return generation;
+    }
+    _qlog_sitePrefix(site);
+    return generation | 1;
+}
+
+/**
+ * the bounds of the section of callsites, set by the linker, NULL if there is no callsite.
+ */
+extern qlog_site_t __start_qlog_sites[] __attribute__((weak));
+extern qlog_site_t __stop_qlog_sites[] __attribute__((weak));
+
+/**
+ * @brief   get the callsites of the qlog_xxx macros in the program.
+ * @param   count is where the number of callsites is returned.
+ * @return  the callsites, NULL if there is none.
+ */
+const qlog_site_t *qlog_callsites(size_t *count){
+    assert(count != NULL);
+    *count = __start_qlog_sites ? (size_t)(__stop_qlog_sites - __start_qlog_sites) : 0;
+    return *count ? __start_qlog_sites : NULL;
+}
+
+/**
+ * @brief   get the id of a callsite, its index in the section plus 1.
+ * @return  the id, 0 if it is not a callsite of the qlog_xxx macros.
+ */
+uint32_t qlog_callsiteId(const qlog_site_t *site){
+    size_t count;
+    const qlog_site_t *sites = qlog_callsites(&count);
+
+    if(sites == NULL || site < sites || site >= sites + count){
+        return 0;
+    }
+    return (uint32_t)(site - sites) + 1;
+}
+
+/**
+ * @brief   turn on or off the callsites at a location.
+ * @param   file is the file of the callsites, matched against the trailing components of
+ *          their __FILE__, NULL means any file.
+ * @param   line is the line of the callsites, 0 means any line.
+ * @param   enable is true to turn them on.
+ * @return  the number of callsites matched.
+ */
+uint32_t qlog_setCallsite(const char *file, uint32_t line, bool enable){
+    qlog_site_t *site, *sites;
+    size_t count, length, suffix;
+    uint32_t matched = 0;
+
+    sites = (qlog_site_t *)qlog_callsites(&count);
+    suffix = file ? strlen(file) : 0;
+    for(site = sites; site != NULL && site < sites + count; ++site){
+        length = strlen(site->file);
+        //! "b.c" matches "a/b.c" but not "ab.c".
+        if((line != 0 && site->line != line) || (file != NULL && (length < suffix ||
+            strcmp(site->file + length - suffix, file) != 0 || (length > suffix && site->file[length - suffix - 1] != '/')))){
+            continue;
+        }
+        __atomic_store_n(&site->disabled, !enable, __ATOMIC_RELAXED);
+        matched++;
+    }
+
+    if(matched){
+        _qlog_invalidate();
+    }
+    return matched;
+}
 
 /**
  * @brief   initialise the unique logger.
- *
+ * 
  * @param   level is the global level of log.
  * @param   color means wether to output log with color.
  * @param   timestamp means wether to output log with timestamp.
@@ -33,27 +300,103 @@ static logger_t *logger_unique; //! global unique logger.
  * @see     
  */
 logger_t *qlog_init(level_t level, bool color, bool timestamp, size_t tag_count){
-    static logger_t logger;
-    static filter_t filter;
-    static formatter_t formatter;
-    static writer_t writer;
-    static memoryPool_t mp;
-    static char tag_pool[SIZE_OF_TAG_POOL];
-    static locker_t locker; 
+    qlogInstance_t *instance = &instance_unique;
 
-    assert(level < LOG_LEVEL_BUTT);
-    assert(tag_count <= SIZE_OF_TAG_BLOCK);
-    
-    //! initialise a locker for logger.
-    lockerInit(&locker, locker_init(NULL));
+    if(logger_unique != NULL){
+        configWatcherDeInit(&instance->configWatcher);
+        filterDeInit(&instance->filter);
+        formatterDeInit(&instance->formatter);
+        lockerDeInit(&instance->locker);
+        limiterDeInit(&instance->limiter);
+    }
+    _qlog_instanceInit(instance, level, color, timestamp, tag_count);
 
-    memoryPoolInit(&mp, "tag_pool", tag_count, sizeof(filter_tag_t), &tag_pool);
-    filterInit(&filter, &mp, logger.buffer, level);
-    formatterInit(&formatter, color, timestamp, logger.buffer);
-    consoleWriterInit(&writer, logger.buffer, true);
-    loggerInit(&logger, level, &formatter, &writer, &filter, &locker);
-    logger_unique = &logger;
-    return &logger;
+    if(logger_unique == NULL){
+        pthread_mutex_lock(&instancesLock);
+        instance->next = instances;
+        instances = instance;
+        pthread_mutex_unlock(&instancesLock);
+    }
+    logger_unique = &instance->logger;
+    _qlog_invalidate();
+    return logger_unique;
+}
+
+/**
+ * @brief   create a logger with its own filter, formatter, writers and lock.
+ * @param   level is the global level of log.
+ * @param   color means wether to output log with color.
+ * @param   timestamp means wether to output log with timestamp.
+ * @param   tag_count is the number of tag.
+ * @return  the logger, NULL if out of memory.
+ */
+logger_t *qlog_create(level_t level, bool color, bool timestamp, size_t tag_count){
+    qlogInstance_t *instance;
+
+    //! the counters of logger are aligned to cache lines.
+    instance = (qlogInstance_t *)aligned_alloc(__alignof__(qlogInstance_t), sizeof(qlogInstance_t));
+    if(instance == NULL){
+        return NULL;
+    }
+    memset(instance, 0, sizeof(*instance));
+    _qlog_instanceInit(instance, level, color, timestamp, tag_count);
+
+    pthread_mutex_lock(&instancesLock);
+    instance->next = instances;
+    instances = instance;
+    pthread_mutex_unlock(&instancesLock);
+
+    _qlog_invalidate();
+    return &instance->logger;
+}
+
+/**
+ * @brief   destroy a logger created by {@code qlog_create}.
+ * @param   logger is the logger to destroy.
+ * @note    all the logs pending are written, the writers created by the api are closed,
+ *          and the writers registered by {@code qlog_registerWriter_ex} are left to the caller.
+ */
+void qlog_destroy(logger_t *logger){
+    qlogInstance_t *instance, **link;
+    writer_t *writers[5];
+    assert(logger != NULL && logger != logger_unique);
+    instance = (qlogInstance_t *)logger;
+
+    pthread_mutex_lock(&instancesLock);
+    for(link = &instances; *link != NULL && *link != instance; link = &(*link)->next);
+    assert(*link == instance);
+    *link = instance->next;
+    pthread_mutex_unlock(&instancesLock);
+
+    _qlog_stop(instance);
+
+    writers[0] = &instance->fileWriter.super;
+    writers[1] = &instance->mmapWriter.super;
+    writers[2] = &instance->binaryWriter.super;
+    writers[3] = &instance->flightWriter.super;
+    writers[4] = &instance->socketWriter.super;
+    for(size_t i = 0; i < sizeof(writers) / sizeof(writers[0]); ++i){
+        if(_qlog_registered(writers[i]) && writers[i]->release != NULL){
+            writers[i]->release(writers[i]);
+        }
+    }
+    //! the queue writers are created by the api, unlike the writers they decorate.
+    for(writer_t *writer = instance->logger.writer, *next; writer != NULL; writer = next){
+        next = writer->next;
+        if(writer->inner != NULL){
+            writer->release(writer);
+            free(writer);
+        }
+    }
+
+    _qlog_invalidate();
+    loggerDeInit(logger);
+    configWatcherDeInit(&instance->configWatcher);
+    filterDeInit(&instance->filter);
+    formatterDeInit(&instance->formatter);
+    lockerDeInit(&instance->locker);
+    limiterDeInit(&instance->limiter);
+    free(instance);
 }
 
 /**
@@ -69,80 +412,336 @@ void qlog(const char *tag, level_t level, const char *format, ...){
     logger_t *logger = logger_unique;
 
     va_list args;
-    
+
+    if(!loggerFilter(logger, tag, level)){
+        return;
+    }
+
     /* args point to the first variable parameter */
     va_start(args, format);
-    logger->run(logger, tag, level, format, args);
+    if(loggerLimit(logger, NULL, tag, level, format, args)){
+        logger->run(logger, NULL, tag, level, format, args);
+    }
     va_end(args);
 }
 
 /**
- * @brief   append a tag to filter list.
+ * @brief   output a log through a logger.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   tag is tag of current log.
+ * @param   level is level of current log.
+ * @param   format is format string.  
+ */
+void qlog_ex(logger_t *logger, const char *tag, level_t level, const char *format, ...){
+    va_list args;
+
+    logger = &_qlog_instance(logger)->logger;
+    if(!loggerFilter(logger, tag, level)){
+        return;
+    }
+
+    va_start(args, format);
+    if(loggerLimit(logger, NULL, tag, level, format, args)){
+        logger->run(logger, NULL, tag, level, format, args);
+    }
+    va_end(args);
+}
+
+/**
+ * @brief   output a log of a callsite which has been filtered by the callsite.
+ * @param   site is the callsite.
+ * @param   tag is tag of current log, it is filtered here if it may vary.
+ * @param   format is format string, the same as that of the callsite.
+ * @see     {@code qlog_callsite}
+ */
+void _qlog_output(qlog_site_t *site, const char *tag, const char *format, ...){
+    assert(logger_unique != NULL);
+    logger_t *logger = logger_unique;
+    level_t level = (level_t)site->level;
+
+    va_list args;
+
+    if(site->tag == NULL && !loggerFilter(logger, tag, level)){
+        return;
+    }
+
+    va_start(args, format);
+    if(loggerLimit(logger, site, tag, level, format, args)){
+        logger->run(logger, site, tag, level, format, args);
+    }
+    va_end(args);
+}
+
+/**
+ * @brief   output a log of a callsite through a logger, it has been filtered by the callsite.
+ * @param   logger is the logger, NULL means the default logger.
+ * @see     {@code qlog_callsite}
+ */
+void _qlog_output_ex(logger_t *logger, qlog_site_t *site, const char *tag, const char *format, ...){
+    level_t level = (level_t)site->level;
+    va_list args;
+
+    logger = &_qlog_instance(logger)->logger;
+    if(site->tag == NULL && !loggerFilter(logger, tag, level)){
+        return;
+    }
+
+    va_start(args, format);
+    if(loggerLimit(logger, site, tag, level, format, args)){
+        logger->run(logger, site, tag, level, format, args);
+    }
+    va_end(args);
+}
+
+/**
+ * @brief   let the logger reject at once only the logs no tag lets pass, as the level of a
+ *          tag overrides the global level.
+ * @note    the filter is read, so the locker of logger must be held.
+ */
+static void _qlog_ceiling(logger_t *logger){
+    __atomic_store_n(&logger->level, logger->filter->ceiling(logger->filter), __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief   set the level of a tag, the tag is interned at the first time.
+ * @param   logger is the logger, NULL means the default logger.
  * @param   tag is pointer to the tag.
  * @param   level is level of the tag.
- * @note    logs with this tag will be filtered later.
+ * @note    once any tag is set, only logs with the tags set will be output.
  */
-void qlog_filter(const char *tag, level_t level){
-    assert(logger_unique != NULL);
+void qlog_filter_ex(logger_t *logger, const char *tag, level_t level){
     assert(tag != NULL);
 
-    logger_t *logger = logger_unique;
+    logger = &_qlog_instance(logger)->logger;
     filter_t *filter = logger->filter;
+    locker_t *locker = logger->locker;
+    bool ret;
     assert(filter != NULL);
     assert(filter->append != NULL);
 
-    filter->append(filter, tag, level);
+    //! writers of filter are serialized, readers never take the lock.
+    locker->lock(locker);
+    ret = filter->append(filter, tag, level);
+    _qlog_ceiling(logger);
+    locker->unlock(locker);
+
+    if(!ret){
+        fprintf(stderr, "[warning]: failed to filter tag %s!!!\n", tag);
+        return;
+    }
+    _qlog_invalidate();
+}
+
+void qlog_filter(const char *tag, level_t level){
+    qlog_filter_ex(NULL, tag, level);
+}
+
+/**
+ * @brief   attach the limiter to the logger of an instance once it is configured.
+ */
+static void _qlog_limiter(qlogInstance_t *instance){
+    __atomic_store_n(&instance->logger.limiter, &instance->limiter, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief   set the rate limit of a tag.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   tag is pointer to the tag.
+ * @param   rate is the logs per second, 0 means unlimited.
+ * @param   burst is the logs allowed at once, 0 means 1.
+ * @return  false if too many tags are limited.
+ */
+bool qlog_limit_ex(logger_t *logger, const char *tag, uint32_t rate, uint32_t burst){
+    qlogInstance_t *instance;
+    bool ret;
+    assert(tag != NULL);
+    instance = _qlog_instance(logger);
+
+    ret = limiterSetTag(&instance->limiter, tag, rate, burst);
+    if(!ret){
+        fprintf(stderr, "[warning]: failed to limit tag %s!!!\n", tag);
+        return false;
+    }
+    _qlog_limiter(instance);
+    return true;
+}
+
+bool qlog_limit(const char *tag, uint32_t rate, uint32_t burst){
+    return qlog_limit_ex(NULL, tag, rate, burst);
+}
+
+/**
+ * @brief   set the rate limit of each callsite.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   rate is the logs per second, 0 means unlimited.
+ * @param   burst is the logs allowed at once, 0 means 1.
+ */
+void qlog_limitCallsite_ex(logger_t *logger, uint32_t rate, uint32_t burst){
+    qlogInstance_t *instance = _qlog_instance(logger);
+
+    limiterSetSite(&instance->limiter, rate, burst);
+    _qlog_limiter(instance);
+}
+
+void qlog_limitCallsite(uint32_t rate, uint32_t burst){
+    qlog_limitCallsite_ex(NULL, rate, burst);
+}
+
+/**
+ * @brief   set the suppression of repeated logs enable or disable.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   enable true means the repeats of a log are counted instead of output.
+ */
+void qlog_setRepeatSuppression_ex(logger_t *logger, bool enable){
+    qlogInstance_t *instance = _qlog_instance(logger);
+
+    limiterSetRepeat(&instance->limiter, &instance->logger, enable);
+    _qlog_limiter(instance);
+}
+
+void qlog_setRepeatSuppression(bool enable){
+    qlog_setRepeatSuppression_ex(NULL, enable);
+}
+
+/**
+ * @brief   set the global level of log.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   level is the new global level.
+ */
+void qlog_setLevel_ex(logger_t *logger, level_t level){
+    locker_t *locker;
+    assert(level < LOG_LEVEL_BUTT);
+
+    logger = &_qlog_instance(logger)->logger;
+    locker = logger->locker;
+
+    locker->lock(locker);
+    __atomic_store_n(&logger->filter->level, level, __ATOMIC_RELAXED);
+    _qlog_ceiling(logger);
+    locker->unlock(locker);
+    _qlog_invalidate();
+}
+
+void qlog_setLevel(level_t level){
+    qlog_setLevel_ex(NULL, level);
+}
+
+/**
+ * @brief   set the clock source and the precision of timestamp.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   clock is the clock source.
+ * @param   precision is the precision of the fraction of second.
+ */
+void qlog_setClock_ex(logger_t *logger, log_clock_t clock, log_precision_t precision){
+    locker_t *locker;
+    logger = &_qlog_instance(logger)->logger;
+    locker = logger->locker;
+
+    locker->lock(locker);
+    formatterSetClock(logger->formatter, clock, precision);
+    locker->unlock(locker);
+}
+
+void qlog_setClock(log_clock_t clock, log_precision_t precision){
+    qlog_setClock_ex(NULL, clock, precision);
+}
+
+/**
+ * @brief   set the layout of logs.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   pattern is the layout pattern, NULL means the default one.
+ * @return  false if the pattern is invalid.
+ */
+bool qlog_setLayout_ex(logger_t *logger, const char *pattern){
+    qlogInstance_t *instance;
+    locker_t *locker;
+    bool ret;
+    instance = _qlog_instance(logger);
+    locker = &instance->locker;
+
+    if(pattern == NULL){
+        pattern = instance->timestamp ? LAYOUT_DEFAULT_TIMESTAMP : LAYOUT_DEFAULT;
+    }
+
+    locker->lock(locker);
+    ret = formatterSetLayout(&instance->formatter, pattern);
+    locker->unlock(locker);
+    return ret;
+}
+
+bool qlog_setLayout(const char *pattern){
+    return qlog_setLayout_ex(NULL, pattern);
+}
+
+/**
+ * @brief  set the name of the calling thread shown in logs.
+ * 
+ * @param  name is the name, NULL means the name given by the system.
+ * @note   it is kept by the thread, so it is shared by all the loggers.
+ */
+void qlog_setThreadName(const char *name){
+    formatterSetThreadName(name);
 }
 
 /**
  * @brief  set console writer enable or disable.
  * 
+ * @param  logger is the logger, NULL means the default logger.
  * @param  enable true is enable, false is disable.  
  * @note   the console writer is default the first writer.
- * @see    
+ * @see     
  */
-void qlog_setConsoleWriter(bool enable){
-    logger_t *logger;
-    assert(logger_unique != NULL);
-    logger = logger_unique;
+void qlog_setConsoleWriter_ex(logger_t *logger, bool enable){
+    __atomic_store_n(&_qlog_instance(logger)->consoleWriter.enable, enable, __ATOMIC_RELAXED);
+}
 
-    logger->writer->enable = enable;
+void qlog_setConsoleWriter(bool enable){
+    qlog_setConsoleWriter_ex(NULL, enable);
 }
 
 /**
  * @brief  set file writer enable or disable.
  * 
+ * @param  logger is the logger, NULL means the default logger.
  * @param  enable true is enable, false is disable.  
- * @note   the next writer of console writer is default file writer.
- * @see    
+ * @see    {@code qlog_registerFileWriter_ex}
  */
-void qlog_setFileWriter(bool enable){
-    logger_t *logger;
-    assert(logger_unique != NULL);
-    logger = logger_unique;
+void qlog_setFileWriter_ex(logger_t *logger, bool enable){
+    qlogInstance_t *instance = _qlog_instance(logger);
 
-    assert(logger->writer->next != NULL);
-    logger->writer->next->enable = enable;
+    assert(_qlog_registered(&instance->fileWriter.super));
+    __atomic_store_n(&instance->fileWriter.super.enable, enable, __ATOMIC_RELAXED);
+}
+
+void qlog_setFileWriter(bool enable){
+    qlog_setFileWriter_ex(NULL, enable);
 }
 
 /**
  * @brief   register a writer to logger.
+ * @param   logger is the logger, NULL means the default logger.
  * @param   writer is the writer to register.
- * @return  
- * @note    
- * @see     
+ * @note    the writer is appended to the end of the writer chain.
  */
-void qlog_registerWriter(void *writer){
-    logger_t *logger;
-    assert(logger_unique != NULL);
+void qlog_registerWriter_ex(logger_t *logger, void *writer){
+    locker_t *locker;
     assert(writer != NULL);
-    logger = logger_unique;
+    logger = &_qlog_instance(logger)->logger;
     assert(logger->registerWriter != NULL);
+    locker = logger->locker;
+
+    locker->lock(locker);
     logger->registerWriter(logger, writer);
+    locker->unlock(locker);
+}
+
+void qlog_registerWriter(void *writer){
+    qlog_registerWriter_ex(NULL, writer);
 }
 
 /**
  * @brief   register file writer to logger.
+ * @param   logger is the logger, NULL means the default logger.
  * @param   name is the name of log file.
  * @param   dir is the directory of log file.
  * @param   numberOfFiles is the number of log files.
@@ -150,17 +749,809 @@ void qlog_registerWriter(void *writer){
  * @note    
  * @see     
  */
+void qlog_registerFileWriter_ex(logger_t *logger, const char *name, const char *dir, int numberOfFiles, int sizeOfFile){
+    qlogInstance_t *instance;
+    writer_t *writer;
+    assert(name && dir);
+    assert(numberOfFiles > 0 && sizeOfFile > SIZE_OF_LOG_BUFFER);
+    instance = _qlog_instance(logger);
+    writer = &instance->fileWriter.super;
+    assert(!_qlog_registered(writer));
+
+    fileWriterInit(writer, instance->logger.buffer,
+        name, dir, numberOfFiles, sizeOfFile);
+    qlog_registerWriter_ex(&instance->logger, writer);
+}
+
 void qlog_registerFileWriter(const char *name, const char *dir, int numberOfFiles, int sizeOfFile){
-    logger_t *logger;
+    qlog_registerFileWriter_ex(NULL, name, dir, numberOfFiles, sizeOfFile);
+}
+
+/**
+ * @brief   register mmap writer to logger.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   name is the name of log file.
+ * @param   dir is the directory of log file.
+ * @param   numberOfFiles is the number of log files.
+ * @param   sizeOfFile is size of log file, each log file is preallocated to it.
+ */
+void qlog_registerMmapWriter_ex(logger_t *logger, const char *name, const char *dir, int numberOfFiles, int sizeOfFile){
+    qlogInstance_t *instance;
     writer_t *writer;
-    static fileWriter_t fileWriter;
     assert(name && dir);
-    assert(numberOfFiles > 0 && sizeOfFile > SIZE_OF_FILE_BUFFER);
-    assert(logger_unique != NULL);
-    logger = logger_unique;
-    writer = (writer_t *)&fileWriter;
-    fileWriterInit(writer, logger->buffer, 
+    assert(numberOfFiles > 0 && sizeOfFile >= SIZE_OF_LOG_TEXT);
+    instance = _qlog_instance(logger);
+    writer = &instance->mmapWriter.super;
+    assert(!_qlog_registered(writer));
+
+    mmapWriterInit(writer, instance->logger.buffer,
         name, dir, numberOfFiles, sizeOfFile);
+    qlog_registerWriter_ex(&instance->logger, writer);
+}
+
+void qlog_registerMmapWriter(const char *name, const char *dir, int numberOfFiles, int sizeOfFile){
+    qlog_registerMmapWriter_ex(NULL, name, dir, numberOfFiles, sizeOfFile);
+}
+
+/**
+ * @brief  set mmap writer enable or disable.
+ * @param  logger is the logger, NULL means the default logger.
+ * @param  enable true is enable, false is disable.  
+ */
+void qlog_setMmapWriter_ex(logger_t *logger, bool enable){
+    qlogInstance_t *instance = _qlog_instance(logger);
+
+    assert(_qlog_registered(&instance->mmapWriter.super));
+    __atomic_store_n(&instance->mmapWriter.super.enable, enable, __ATOMIC_RELAXED);
+}
+
+void qlog_setMmapWriter(bool enable){
+    qlog_setMmapWriter_ex(NULL, enable);
+}
+
+/**
+ * @brief   register binary writer to logger.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   name is the name of log file.
+ * @param   dir is the directory of log file.
+ * @param   numberOfFiles is the number of log files.
+ * @param   sizeOfFile is the maximum size of log file.
+ */
+void qlog_registerBinaryWriter_ex(logger_t *logger, const char *name, const char *dir, int numberOfFiles, int sizeOfFile){
+    qlogInstance_t *instance;
+    writer_t *writer;
+    assert(name && dir);
+    assert(numberOfFiles > 0 && sizeOfFile >= 2 * SIZE_OF_BINARY_LOG);
+    instance = _qlog_instance(logger);
+    writer = &instance->binaryWriter.super;
+    assert(!_qlog_registered(writer));
+
+    binaryWriterInit(writer, instance->logger.buffer, &instance->formatter,
+        name, dir, numberOfFiles, sizeOfFile);
+    qlog_registerWriter_ex(&instance->logger, writer);
+}
+
+void qlog_registerBinaryWriter(const char *name, const char *dir, int numberOfFiles, int sizeOfFile){
+    qlog_registerBinaryWriter_ex(NULL, name, dir, numberOfFiles, sizeOfFile);
+}
+
+/**
+ * @brief  set binary writer enable or disable.
+ * @param  logger is the logger, NULL means the default logger.
+ * @param  enable true is enable, false is disable.  
+ */
+void qlog_setBinaryWriter_ex(logger_t *logger, bool enable){
+    qlogInstance_t *instance = _qlog_instance(logger);
+
+    assert(_qlog_registered(&instance->binaryWriter.super));
+    __atomic_store_n(&instance->binaryWriter.super.enable, enable, __ATOMIC_RELAXED);
+}
+
+void qlog_setBinaryWriter(bool enable){
+    qlog_setBinaryWriter_ex(NULL, enable);
+}
+
+/**
+ * @brief   register a flight recorder to logger.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   name is the name of the file dumped to.
+ * @param   dir is the directory of the file dumped to.
+ * @param   size is the size of the ring in bytes, 0 means {@code SIZE_OF_FLIGHT_RING}.
+ * @return  false if out of memory.
+ */
+bool qlog_registerFlightWriter_ex(logger_t *logger, const char *name, const char *dir, size_t size){
+    qlogInstance_t *instance;
+    writer_t *writer;
+    assert(name && dir);
+    instance = _qlog_instance(logger);
+    writer = &instance->flightWriter.super;
+    assert(!_qlog_registered(writer));
+
+    if(size == 0){
+        size = SIZE_OF_FLIGHT_RING;
+    }
+    if(size > INT32_MAX || !flightWriterInit(writer, instance->logger.buffer, &instance->formatter,
+        name, dir, size)){
+        return false;
+    }
+    qlog_registerWriter_ex(&instance->logger, writer);
+    return true;
+}
+
+bool qlog_registerFlightWriter(const char *name, const char *dir, size_t size){
+    return qlog_registerFlightWriter_ex(NULL, name, dir, size);
+}
+
+/**
+ * @brief  set flight recorder enable or disable.
+ * @param  logger is the logger, NULL means the default logger.
+ * @param  enable true is enable, false is disable.
+ */
+void qlog_setFlightWriter_ex(logger_t *logger, bool enable){
+    qlogInstance_t *instance = _qlog_instance(logger);
+
+    assert(_qlog_registered(&instance->flightWriter.super));
+    __atomic_store_n(&instance->flightWriter.super.enable, enable, __ATOMIC_RELAXED);
+}
+
+void qlog_setFlightWriter(bool enable){
+    qlog_setFlightWriter_ex(NULL, enable);
+}
+
+/**
+ * @brief   dump the ring of flight recorder to its file.
+ * @param   logger is the logger, NULL means the default logger.
+ * @return  false if the flight recorder is not registered or the file can not be opened.
+ */
+bool qlog_dumpFlightWriter_ex(logger_t *logger){
+    qlogInstance_t *instance = _qlog_instance(logger);
+
+    if(!_qlog_registered(&instance->flightWriter.super)){
+        return false;
+    }
+    return flightWriterDump(&instance->flightWriter.super, "request");
+}
+
+bool qlog_dumpFlightWriter(void){
+    return qlog_dumpFlightWriter_ex(NULL);
+}
+
+/**
+ * @brief   register socket writer to logger.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   transport is the transport of the socket.
+ * @param   address is the path of a unix socket, or "host:port" of UDP and TCP.
+ * @param   framing is how a log is framed.
+ * @param   size is the size of the ring in bytes, 0 means {@code SIZE_OF_SOCKET_RING}.
+ * @return  false if the address is invalid or out of memory.
+ */
+bool qlog_registerSocketWriter_ex(logger_t *logger, log_socket_t transport, const char *address,
+                                  log_framing_t framing, size_t size){
+    qlogInstance_t *instance;
+    writer_t *writer;
+    assert(address != NULL);
+    assert(transport < LOG_SOCKET_BUTT && framing < LOG_FRAMING_BUTT);
+    instance = _qlog_instance(logger);
+    writer = &instance->socketWriter.super;
+    assert(!_qlog_registered(writer));
+
+    if(size == 0){
+        size = SIZE_OF_SOCKET_RING;
+    }
+    if(size > INT32_MAX || !socketWriterInit(writer, instance->logger.buffer, transport, address,
+        framing, size)){
+        return false;
+    }
+    qlog_registerWriter_ex(&instance->logger, writer);
+    return true;
+}
+
+bool qlog_registerSocketWriter(log_socket_t transport, const char *address, log_framing_t framing, size_t size){
+    return qlog_registerSocketWriter_ex(NULL, transport, address, framing, size);
+}
+
+/**
+ * @brief  set socket writer enable or disable.
+ * @param  logger is the logger, NULL means the default logger.
+ * @param  enable true is enable, false is disable.
+ */
+void qlog_setSocketWriter_ex(logger_t *logger, bool enable){
+    qlogInstance_t *instance = _qlog_instance(logger);
+
+    assert(_qlog_registered(&instance->socketWriter.super));
+    __atomic_store_n(&instance->socketWriter.super.enable, enable, __ATOMIC_RELAXED);
+}
+
+void qlog_setSocketWriter(bool enable){
+    qlog_setSocketWriter_ex(NULL, enable);
+}
+
+/**
+ * @brief   set the buffers and the flush policy of file writer.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   sizeOfBuffer is the size of each buffer, 0 means default.
+ * @param   numberOfBuffers is the number of buffers, 0 means default.
+ * @param   interval is the maximum time in ms a log stays in buffer.
+ * @param   level is the level at or above which a log is written at once.
+ * @return  false if out of memory.
+ */
+bool qlog_setFilePolicy_ex(logger_t *logger, size_t sizeOfBuffer, uint32_t numberOfBuffers,
+                           uint32_t interval, level_t level){
+    qlogInstance_t *instance;
+    locker_t *locker;
+    bool ret;
+    instance = _qlog_instance(logger);
+    assert(_qlog_registered(&instance->fileWriter.super));
+    assert(level < LOG_LEVEL_BUTT);
+    locker = &instance->locker;
+
+    if(sizeOfBuffer == 0){
+        sizeOfBuffer = SIZE_OF_FILE_BUFFER;
+    }
+    if(numberOfBuffers == 0){
+        numberOfBuffers = COUNT_OF_FILE_BUFFER;
+    }
+    if(numberOfBuffers < 2){
+        numberOfBuffers = 2;
+    }
+    if(sizeOfBuffer > INT32_MAX / numberOfBuffers){
+        return false;
+    }
+
+    locker->lock(locker);
+    ret = fileWriterSetPolicy(&instance->fileWriter.super, sizeOfBuffer, numberOfBuffers, interval, level);
+    locker->unlock(locker);
+    return ret;
+}
+
+bool qlog_setFilePolicy(size_t sizeOfBuffer, uint32_t numberOfBuffers, uint32_t interval, level_t level){
+    return qlog_setFilePolicy_ex(NULL, sizeOfBuffer, numberOfBuffers, interval, level);
+}
+
+/**
+ * @brief   set the rotation policy of file writer, mmap writer and binary writer.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   interval is the seconds between rotations, aligned to the wall clock, 0 means
+ *          rotating by size only.
+ * @param   budget is the maximum total size of the segments of a log file, 0 means only
+ *          the number of files is limited.
+ */
+void qlog_setRotation_ex(logger_t *logger, uint32_t interval, uint64_t budget){
+    qlogInstance_t *instance = _qlog_instance(logger);
+
+    if(_qlog_registered(&instance->fileWriter.super)){
+        segmentSetPolicy(&instance->fileWriter.segment, interval, budget);
+    }
+    if(_qlog_registered(&instance->mmapWriter.super)){
+        segmentSetPolicy(&instance->mmapWriter.segment, interval, budget);
+    }
+    if(_qlog_registered(&instance->binaryWriter.super)){
+        segmentSetPolicy(&instance->binaryWriter.segment, interval, budget);
+    }
+}
+
+void qlog_setRotation(uint32_t interval, uint64_t budget){
+    qlog_setRotation_ex(NULL, interval, budget);
+}
+
+/**
+ * @brief   put a bounded queue and a worker in front of a writer.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   name is the name of the writer, e.g. "console", "file", "mmap" or "binary".
+ * @param   size is the size of the queue in bytes, 0 means {@code SIZE_OF_WRITER_QUEUE}.
+ * @param   policy is what to do when the queue is full.
+ * @param   level is the level of {@code LOG_QUEUE_DROP_BELOW_LEVEL}.
+ * @return  false if the writer is not registered, it is queued already, or out of memory.
+ */
+bool qlog_setWriterQueue_ex(logger_t *logger, const char *name, size_t size,
+                            log_queue_policy_t policy, level_t level){
+    qlogInstance_t *instance;
+    queueWriter_t *queueWriter;
+    writer_t **link;
+    locker_t *locker;
+    bool ret = false;
+    assert(name != NULL);
+    assert(policy < LOG_QUEUE_BUTT && level < LOG_LEVEL_BUTT);
+    instance = _qlog_instance(logger);
+    locker = &instance->locker;
+
+    if(size == 0){
+        size = SIZE_OF_WRITER_QUEUE;
+    }
+    if(size > INT32_MAX){
+        return false;
+    }
+    queueWriter = (queueWriter_t *)malloc(sizeof(queueWriter_t));
+    if(queueWriter == NULL){
+        return false;
+    }
+
+    //! the queue writer takes the place of the writer in the chain.
+    locker->lock(locker);
+    for(link = &instance->logger.writer; *link != NULL && strcmp((*link)->name, name) != 0;
+        link = &(*link)->next);
+    if(*link != NULL && (*link)->inner == NULL &&
+        queueWriterInit(&queueWriter->super, *link, size, policy, level)){
+        *link = &queueWriter->super;
+        ret = true;
+    }
+    locker->unlock(locker);
+
+    if(!ret){
+        free(queueWriter);
+    }
+    return ret;
+}
+
+bool qlog_setWriterQueue(const char *name, size_t size, log_queue_policy_t policy, level_t level){
+    return qlog_setWriterQueue_ex(NULL, name, size, policy, level);
+}
+
+/**
+ * @brief   find a writer of the chain by its name, a queued writer is found by the name of
+ *          the writer it decorates.
+ * @return  the writer, NULL if it is not registered.
+ */
+static writer_t *_qlog_writer(qlogInstance_t *instance, const char *name){
+    for(writer_t *writer = instance->logger.writer; writer != NULL; writer = writer->next){
+        writer_t *target = writer->inner ? writer->inner : writer;
+
+        if(strcmp(target->name, name) == 0){
+            return target;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief   set the level of a writer, the levels above it are skipped.
+ */
+static void _qlog_writerLevel(writer_t *writer, level_t level){
+    //! read without lock by the logging threads.
+    __atomic_store_n(&writer->skipped, ((1u << LOG_LEVEL_BUTT) - 1) & ~((2u << level) - 1),
+        __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief   set the level of a writer.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   name is the name of the writer.
+ * @param   level is the level of the writer, the logs less important than it are skipped.
+ * @return  false if the writer is not registered.
+ */
+bool qlog_setWriterLevel_ex(logger_t *logger, const char *name, level_t level){
+    writer_t *writer;
+    assert(name != NULL && level < LOG_LEVEL_BUTT);
+
+    writer = _qlog_writer(_qlog_instance(logger), name);
+    if(writer == NULL){
+        return false;
+    }
+    _qlog_writerLevel(writer, level);
+    return true;
+}
+
+bool qlog_setWriterLevel(const char *name, level_t level){
+    return qlog_setWriterLevel_ex(NULL, name, level);
+}
+
+/**
+ * @brief   switch the logger to asynchronous mode.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   numberOfRecords is the number of records in the ring of each thread,
+ *          0 means {@code COUNT_OF_ASYNC_RECORD}.
+ * @note    the pending logs will be written at exit.
+ */
+void qlog_startAsync_ex(logger_t *logger, size_t numberOfRecords){
+    qlogInstance_t *instance = _qlog_instance(logger);
+
+    if(instance->logger.async != NULL){
+        return;
+    }
+
+    if(numberOfRecords == 0){
+        numberOfRecords = COUNT_OF_ASYNC_RECORD;
+    }
+    asyncLoggerInit(&instance->async, &instance->logger, numberOfRecords);
+}
+
+void qlog_startAsync(size_t numberOfRecords){
+    qlog_startAsync_ex(NULL, numberOfRecords);
+}
+
+/**
+ * @brief   write all the pending logs and switch the logger back to synchronous mode.
+ * @param   logger is the logger, NULL means the default logger.
+ */
+void qlog_stopAsync_ex(logger_t *logger){
+    logger = &_qlog_instance(logger)->logger;
+
+    if(logger->async == NULL){
+        return;
+    }
+    asyncLoggerDeInit(logger->async);
+}
+
+void qlog_stopAsync(void){
+    if(logger_unique == NULL){
+        return;
+    }
+    qlog_stopAsync_ex(NULL);
+}
+
+/**
+ * @brief   set deferred formatting enable or disable.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   enable true means the calling thread only captures the raw arguments.
+ * @note    it takes effect in asynchronous mode only.
+ */
+void qlog_setDeferred_ex(logger_t *logger, bool enable){
+    _qlog_instance(logger)->formatter.deferred = enable;
+}
+
+void qlog_setDeferred(bool enable){
+    qlog_setDeferred_ex(NULL, enable);
+}
+
+/**
+ * @brief   take a snapshot of the counters of logger and its writers.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   stats is where the snapshot is written to.
+ */
+void qlog_stats_ex(logger_t *logger, log_stats_t *stats){
+    assert(stats != NULL);
+
+    statsSnapshot(&_qlog_instance(logger)->logger, stats);
+}
+
+void qlog_stats(log_stats_t *stats){
+    qlog_stats_ex(NULL, stats);
+}
+
+/**
+ * @brief   dump the counters through the logger periodically.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   interval is the seconds between dumps, 0 means stop dumping.
+ */
+void qlog_setStatsInterval_ex(logger_t *logger, uint32_t interval){
+    qlogInstance_t *instance = _qlog_instance(logger);
+
+    statsReporterStop(&instance->statsReporter);
+    if(interval == 0){
+        return;
+    }
+    statsReporterStart(&instance->statsReporter, &instance->logger, interval);
+}
+
+void qlog_setStatsInterval(uint32_t interval){
+    qlog_setStatsInterval_ex(NULL, interval);
+}
+
+/**
+ * @brief   find the settings of a writer in a config.
+ * @return  NULL if the writer is not given.
+ */
+static const struct configWriter *_qlog_configWriter(const config_t *config, const char *name){
+    for(uint32_t i = 0; i < config->numberOfWriters; ++i){
+        if(strcmp(config->writers[i].name, name) == 0){
+            return &config->writers[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief   apply a config to the logger of an instance.
+ * @param   context is the instance.
+ * @param   previous is the config applied last, the settings given by it and missing from
+ *          {@code config} are reset.
+ * @param   config is the config to apply.
+ * @note    the filter is replaced by a new table at once, and the callsites are invalidated,
+ *          so the logging threads see the new config without taking any lock.
+ */
+static void _qlog_applyConfig(void *context, const config_t *previous, const config_t *config){
+    qlogInstance_t *instance = (qlogInstance_t *)context;
+    locker_t *locker = &instance->locker;
+    filter_t *filter = &instance->filter;
+    const struct configWriter *setting;
+    writer_t *writer;
+    bool limited = false;
+    uint32_t i, j;
+
+    //! writers of filter and the writer chain are serialized.
+    locker->lock(locker);
+    if(config->level != CONFIG_UNSET){
+        __atomic_store_n(&filter->level, (level_t)config->level, __ATOMIC_RELAXED);
+    }
+    if((config->tagged || previous->tagged) &&
+        !filter->replace(filter, config->tags, config->levels, config->numberOfTags, config->others)){
+        fprintf(stderr, "[warning]: failed to replace the tags of filter!!!\n");
+    }
+    _qlog_ceiling(&instance->logger);
+    for(i = 0; i < config->numberOfWriters; ++i){
+        setting = &config->writers[i];
+        if((writer = _qlog_writer(instance, setting->name)) == NULL){
+            fprintf(stderr, "[warning]: writer %s is not registered!!!\n", setting->name);
+            continue;
+        }
+        if(setting->enable != CONFIG_UNSET){
+            __atomic_store_n(&writer->enable, setting->enable, __ATOMIC_RELAXED);
+        }
+        if(setting->level != CONFIG_UNSET){
+            _qlog_writerLevel(writer, (level_t)setting->level);
+        }
+    }
+    for(i = 0; i < previous->numberOfWriters; ++i){
+        setting = _qlog_configWriter(config, previous->writers[i].name);
+        if((writer = _qlog_writer(instance, previous->writers[i].name)) == NULL){
+            continue;
+        }
+        if(previous->writers[i].enable != CONFIG_UNSET && (setting == NULL || setting->enable == CONFIG_UNSET)){
+            __atomic_store_n(&writer->enable, true, __ATOMIC_RELAXED);
+        }
+        if(previous->writers[i].level != CONFIG_UNSET && (setting == NULL || setting->level == CONFIG_UNSET)){
+            _qlog_writerLevel(writer, LOG_LEVEL_DEBUG);
+        }
+    }
+    locker->unlock(locker);
+
+    //! the limiter reports through the logger, so it is not set under the lock of logger.
+    for(i = 0; i < previous->numberOfLimits; ++i){
+        for(j = 0; j < config->numberOfLimits && strcmp(config->limits[j].tag, previous->limits[i].tag) != 0; ++j);
+        if(j == config->numberOfLimits){
+            limiterSetTag(&instance->limiter, previous->limits[i].tag, 0, 1);
+        }
+    }
+    for(i = 0; i < config->numberOfLimits; ++i){
+        if(!limiterSetTag(&instance->limiter, config->limits[i].tag, config->limits[i].rate, config->limits[i].burst)){
+            fprintf(stderr, "[warning]: failed to limit tag %s!!!\n", config->limits[i].tag);
+        }
+        limited = true;
+    }
+    if(config->siteLimited || previous->siteLimited){
+        limiterSetSite(&instance->limiter, config->siteLimited ? config->siteRate : 0, config->siteBurst);
+        limited = true;
+    }
+    if(config->repeat != CONFIG_UNSET){
+        limiterSetRepeat(&instance->limiter, &instance->logger, config->repeat);
+        limited = true;
+    }
+    if(limited){
+        _qlog_limiter(instance);
+    }
 
-    qlog_registerWriter(writer);
-}
\ No newline at end of file
+    _qlog_invalidate();
+}
+
+/**
+ * @brief   load a config file and apply it to a logger.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   path is the path of the config file, see {@code struct config} for its syntax.
+ * @return  false if the file can not be read or is invalid, the logger is unchanged then.
+ */
+bool qlog_loadConfig_ex(logger_t *logger, const char *path){
+    assert(path != NULL);
+
+    return configWatcherLoad(&_qlog_instance(logger)->configWatcher, path);
+}
+
+bool qlog_loadConfig(const char *path){
+    return qlog_loadConfig_ex(NULL, path);
+}
+
+/**
+ * @brief   load a config file, and reload it each time it is written or replaced.
+ * @param   logger is the logger, NULL means the default logger.
+ * @param   path is the path of the config file, NULL means stop watching.
+ * @return  false if the file is invalid or can not be watched.
+ */
+bool qlog_watchConfig_ex(logger_t *logger, const char *path){
+    qlogInstance_t *instance = _qlog_instance(logger);
+
+    if(path == NULL){
+        configWatcherStop(&instance->configWatcher);
+        return true;
+    }
+    return configWatcherStart(&instance->configWatcher, path);
+}
+
+bool qlog_watchConfig(const char *path){
+    return qlog_watchConfig_ex(NULL, path);
+}
+
+static const int crashSignals[] = { SIGSEGV, SIGABRT, SIGBUS, SIGFPE };
+static const char *crashNames[] = { "SIGSEGV", "SIGABRT", "SIGBUS", "SIGFPE" };
+#define COUNT_OF_CRASH_SIGNAL   (sizeof(crashSignals) / sizeof(crashSignals[0]))
+
+static struct sigaction crashActions[COUNT_OF_CRASH_SIGNAL];  //! the actions replaced.
+static bool crashEnabled;           //! protected by {@code instancesLock}.
+static long crashThread;            //! id of the thread handling a crash, 0 if none.
+static char crashStack[SIZE_OF_CRASH_STACK] __attribute__((aligned(16)));
+
+/**
+ * @brief   append a decimal number to a buffer, snprintf is not async-signal-safe.
+ * @return  the length of the number.
+ */
+static int32_t _qlog_crashNumber(char *buffer, uint64_t value){
+    char digits[20];
+    int32_t count = 0, length;
+
+    do{
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    }while(value);
+    for(length = 0; count > 0; ++length){
+        buffer[length] = digits[--count];
+    }
+    return length;
+}
+
+/**
+ * @brief   append a string to a buffer.
+ * @return  the length of the string.
+ */
+static int32_t _qlog_crashText(char *buffer, const char *text){
+    int32_t length;
+
+    for(length = 0; text[length] != '\0'; ++length){
+        buffer[length] = text[length];
+    }
+    return length;
+}
+
+/**
+ * @brief   write the logs kept by all the living instances, and a crash mark, then raise
+ *          the signal again to the handler replaced.
+ * @param   sig is the signal.
+ * @note    only async-signal-safe calls are made, and no lock is taken, as the crashed thread
+ *          may hold any. the list of instances is walked as it is.
+ */
+static void _qlog_crash(int sig){
+    qlogInstance_t *instance;
+    asyncLogger_t *async;
+    char mark[128];
+    int32_t length;
+    uint32_t lost;
+    size_t i;
+    long tid = syscall(SYS_gettid), owner = 0;
+
+    for(i = 0; i < COUNT_OF_CRASH_SIGNAL && crashSignals[i] != sig; ++i);
+
+    if(!__atomic_compare_exchange_n(&crashThread, &owner, tid, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+        if(owner == tid){
+            //! crashed again in the handler, give up the logs.
+            signal(sig, SIG_DFL);
+            raise(sig);
+            return;
+        }
+        //! another thread is writing the logs, it terminates the process later.
+        for(;;){
+            pause();
+        }
+    }
+
+    for(instance = instances; instance != NULL; instance = instance->next){
+        //! the logs kept by the writers are older than those pending in the rings.
+        loggerEmergency(&instance->logger, NULL, 0);
+        lost = 0;
+        async = __atomic_load_n(&instance->logger.async, __ATOMIC_ACQUIRE);
+        if(async != NULL){
+            lost = asyncLoggerEmergency(async);
+        }
+
+        length = _qlog_crashText(mark, "*** qlog: crashed by signal ");
+        length += _qlog_crashNumber(mark + length, sig);
+        length += _qlog_crashText(mark + length, " (");
+        length += _qlog_crashText(mark + length, crashNames[i]);
+        length += _qlog_crashText(mark + length, ")");
+        if(lost){
+            length += _qlog_crashText(mark + length, ", ");
+            length += _qlog_crashNumber(mark + length, lost);
+            length += _qlog_crashText(mark + length, " deferred logs lost");
+        }
+        length += _qlog_crashText(mark + length, " ***\n");
+        loggerEmergency(&instance->logger, mark, length);
+    }
+
+    //! the signal is blocked in the handler, it is delivered to the handler replaced on return.
+    sigaction(sig, &crashActions[i], NULL);
+    raise(sig);
+}
+
+/**
+ * @brief   set the crash handler enable or disable.
+ * @param   enable true means the logs kept are written at crash, see {@code _qlog_crash}.
+ * @return  false if a handler can not be installed.
+ * @note    the alternate stack is set for the calling thread only.
+ */
+bool qlog_setCrashHandler(bool enable){
+    struct sigaction action;
+    stack_t stack;
+    size_t i;
+    bool ret = true;
+
+    pthread_mutex_lock(&instancesLock);
+    if(enable == crashEnabled){
+        pthread_mutex_unlock(&instancesLock);
+        return true;
+    }
+
+    if(!enable){
+        for(i = 0; i < COUNT_OF_CRASH_SIGNAL; ++i){
+            sigaction(crashSignals[i], &crashActions[i], NULL);
+        }
+        crashEnabled = false;
+        pthread_mutex_unlock(&instancesLock);
+        return true;
+    }
+
+    //! keep the alternate stack of the thread if it has one.
+    if(sigaltstack(NULL, &stack) == 0 && (stack.ss_flags & SS_DISABLE)){
+        stack.ss_sp = crashStack;
+        stack.ss_size = sizeof(crashStack);
+        stack.ss_flags = 0;
+        sigaltstack(&stack, NULL);
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = _qlog_crash;
+    action.sa_flags = SA_ONSTACK;
+    sigfillset(&action.sa_mask);    //! no other signal interrupts the handler.
+    for(i = 0; i < COUNT_OF_CRASH_SIGNAL; ++i){
+        if(sigaction(crashSignals[i], &action, &crashActions[i]) < 0){
+            while(i-- > 0){
+                sigaction(crashSignals[i], &crashActions[i], NULL);
+            }
+            ret = false;
+            break;
+        }
+    }
+    crashEnabled = ret;
+    pthread_mutex_unlock(&instancesLock);
+    return ret;
+}
+
+static int flightSignal;            //! the signal dumping the flight recorders, protected by {@code instancesLock}.
+static struct sigaction flightAction;   //! the action replaced.
+
+/**
+ * @brief   wake the dumper of the flight recorder of each living instance.
+ * @param   sig is the signal.
+ * @note    async-signal-safe, the list of instances is walked as it is.
+ */
+static void _qlog_flightSignal(int sig){
+    int saved = errno;
+
+    for(qlogInstance_t *instance = instances; instance != NULL; instance = instance->next){
+        if(_qlog_registered(&instance->flightWriter.super)){
+            flightWriterRequest(&instance->flightWriter.super, "signal");
+        }
+    }
+    errno = saved;
+}
+
+/**
+ * @brief   set the signal dumping the flight recorders.
+ * @param   sig is the signal, 0 means none.
+ * @return  false if the handler can not be installed.
+ */
+bool qlog_setFlightSignal(int sig){
+    struct sigaction action;
+    bool ret = true;
+
+    pthread_mutex_lock(&instancesLock);
+    if(flightSignal != 0){
+        sigaction(flightSignal, &flightAction, NULL);
+        flightSignal = 0;
+    }
+    if(sig != 0){
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = _qlog_flightSignal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        ret = sigaction(sig, &action, &flightAction) == 0;
+        flightSignal = ret ? sig : 0;
+    }
+    pthread_mutex_unlock(&instancesLock);
+    return ret;
+}
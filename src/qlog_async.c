@@ -0,0 +1,366 @@
+/**
+ * @file    qlog_async.c
+ * @author  qufeiyan
+ * @brief   Asynchronous output for qlog, logs are formatted by the calling thread into
+ *          its own lock-free ring and written by a background thread.
+ * @version 1.0.0
+ * @date    2026/10/18 09:20:13
+ * @version Copyright (c) 2023
+ */
+
+/* Includes --------------------------------------------------------------------------------*/
+#include "qlog_async.h"
+#include "qlog.h"
+#include "qlog_deferred.h"
+#include "qlog_def.h"
+#include "qlog_port.h"
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief   enter the rings as a producer.
+ * @param   async is pointer to the asynchronous logger.
+ * @return  false if the logger is stopping, the rings must not be touched then.
+ * @note    pairs with {@code asyncLoggerDeInit}, which sets {@code stopped} before it waits
+ *          for {@code producers} to drop to zero, so either side sees the other.
+ */
+static bool _asyncLogger_enter(asyncLogger_t *async){
+    __atomic_fetch_add(&async->producers, 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&async->stopped, __ATOMIC_SEQ_CST)){
+        __atomic_fetch_sub(&async->producers, 1, __ATOMIC_RELEASE);
+        return false;
+    }
+    return true;
+}
+
+static void _asyncLogger_leave(asyncLogger_t *async){
+    __atomic_fetch_sub(&async->producers, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief   mark the ring of an exiting thread as closed.
+ * @param   args is pointer to the ring.
+ * @note    the ring is freed by the backend after all its records are written.
+ */
+static void _asyncRing_close(void *args){
+    asyncRing_t *ring = (asyncRing_t *)args;
+    asyncLogger_t *async = ring->async;
+
+    if(_asyncLogger_enter(async)){
+        __atomic_store_n(&ring->closed, true, __ATOMIC_RELEASE);
+        _asyncLogger_leave(async);
+    }
+}
+
+/**
+ * @brief   get the ring of current thread, create it at the first time.
+ * @param   async is pointer to the asynchronous logger.
+ * @return  the ring of current thread, NULL if out of memory.
+ */
+static asyncRing_t *_asyncLogger_ring(asyncLogger_t *async){
+    asyncRing_t *ring;
+
+    ring = (asyncRing_t *)pthread_getspecific(async->key);
+    if(ring != NULL){
+        return ring;
+    }
+
+    ring = (asyncRing_t *)aligned_alloc(SIZE_OF_CACHE_LINE, MEMORY_ALIGN_UP(sizeof(asyncRing_t) +
+        async->numberOfRecords * sizeof(asyncRecord_t), SIZE_OF_CACHE_LINE));
+    if(ring == NULL){
+        return NULL;
+    }
+    ring->head = ring->tail = 0;
+    ring->mask = async->numberOfRecords - 1;
+    ring->closed = false;
+    ring->async = async;
+
+    pthread_mutex_lock(&async->ringsLock);
+    ring->next = async->rings;
+    async->rings = ring;
+    pthread_mutex_unlock(&async->ringsLock);
+
+    pthread_setspecific(async->key, ring);
+    return ring;
+}
+
+/**
+ * @brief   write all the records of a ring to the writers of logger.
+ * @param   async is pointer to the asynchronous logger.
+ * @param   ring is the ring to drain.
+ * @return  true if any record is written.
+ */
+static bool _asyncLogger_drain(asyncLogger_t *async, asyncRing_t *ring){
+    logger_t *logger = async->logger;
+    locker_t *locker = logger->locker;
+    formatter_t *formatter = logger->formatter;
+    asyncRecord_t *record;
+    uint32_t head, tail, sinks;
+
+    head = ring->head;
+    tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if(head == tail){
+        return false;
+    }
+
+    loggerLock(logger);
+    while(head != tail){
+        record = &ring->records[head & ring->mask];
+        if(record->deferred){
+            //! the text is rendered only if some writer consumes it.
+            record->length = 0;
+            sinks = loggerSinks(logger, record->level);
+            if(sinks & LOGGER_SINK_TEXT){
+                record->length = formatter->render(formatter, logger->buffer, 
+                    record->level, (deferredRecord_t *)record->buffer);
+            }
+            loggerOutput(logger, record->level, logger->buffer, record->length, 
+                (deferredRecord_t *)record->buffer);
+        }else{
+            loggerOutput(logger, record->level, record->text, record->length, NULL);
+            if(record->text != record->buffer){
+                formatter->release(formatter, record->text);
+            }
+        }
+        //! give the slot back to the producer as soon as possible.
+        __atomic_store_n(&ring->head, ++head, __ATOMIC_RELEASE);
+    }
+    locker->unlock(locker);
+    return true;
+}
+
+/**
+ * @brief   unlink a ring from the ring list and free it.
+ * @param   async is pointer to the asynchronous logger.
+ * @param   ring is the ring closed and drained.
+ */
+static void _asyncLogger_remove(asyncLogger_t *async, asyncRing_t *ring){
+    asyncRing_t **link;
+
+    pthread_mutex_lock(&async->ringsLock);
+    for(link = &async->rings; *link != ring; link = &(*link)->next);
+    *link = ring->next;
+    pthread_mutex_unlock(&async->ringsLock);
+    free(ring);
+}
+
+/**
+ * @brief   the backend thread, drain all the rings until the logger is stopped.
+ * @param   args is pointer to the asynchronous logger.
+ * @note    the producers only add rings at the head of the list, and the backend is the only
+ *          one removing them, so the list is walked without the lock while the writers work.
+ */
+static void *_asyncLogger_backend(void *args){
+    asyncLogger_t *async = (asyncLogger_t *)args;
+    asyncRing_t *ring, *next;
+    bool running, busy, closed;
+
+    do{
+        running = __atomic_load_n(&async->running, __ATOMIC_ACQUIRE);
+        busy = false;
+
+        pthread_mutex_lock(&async->ringsLock);
+        ring = async->rings;
+        pthread_mutex_unlock(&async->ringsLock);
+
+        for(; ring != NULL; ring = next){
+            //! load the flag before draining, so no record of a closed ring is lost.
+            closed = __atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE);
+            busy |= _asyncLogger_drain(async, ring);
+            next = ring->next;
+            if(closed){
+                _asyncLogger_remove(async, ring);
+            }
+        }
+
+        if(!busy && running){
+            usleep(ASYNC_IDLE_INTERVAL);
+        }
+    }while(running || busy);
+
+    return NULL;
+}
+
+/**
+ * @brief   output a log asynchronously.
+ *
+ * @param   logger is pointer to the logger.
+ * @param   site is the callsite of the log, NULL means none.
+ * @param   tag is the name of module.
+ * @param   level is the level of log.
+ * @param   format is the format string to ouput.
+ * @param   args is a list of variable parameters.
+ * @note    the log has passed {@code loggerFilter}, it is formatted (or only captured, if the
+ *          formatter is deferred) into the ring of current thread without any lock, the caller
+ *          waits only if its ring is full.
+ */
+void _asyncLogger_log(logger_t *logger, const qlog_site_t *site, const char *tag, level_t level,
+                      const char *format, va_list args){
+    asyncLogger_t *async;
+    asyncRing_t *ring;
+    asyncRecord_t *record;
+    formatter_t *formatter;
+    uint32_t tail;
+    void (*run)(logger_t *, const qlog_site_t *, const char *, level_t, const char *, va_list);
+    assert(logger && format);
+
+    //! the logger may have been switched back to synchronous mode since {@code run} was read.
+    while((async = __atomic_load_n(&logger->async, __ATOMIC_ACQUIRE)) == NULL){
+        run = __atomic_load_n(&logger->run, __ATOMIC_ACQUIRE);
+        if(run != _asyncLogger_log){
+            run(logger, site, tag, level, format, args);
+            return;
+        }
+    }
+
+    if(!_asyncLogger_enter(async)){
+        async->run(logger, site, tag, level, format, args);
+        return;
+    }
+
+    ring = _asyncLogger_ring(async);
+    if(ring == NULL){
+        //! out of memory, fall back to synchronous output.
+        _asyncLogger_leave(async);
+        async->run(logger, site, tag, level, format, args);
+        return;
+    }
+
+    tail = ring->tail;
+    while(tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) > ring->mask){
+        sched_yield();  //! ring is full, wait for the backend.
+    }
+
+    record = &ring->records[tail & ring->mask];
+    formatter = logger->formatter;
+    assert(formatter != NULL && formatter->invoke != NULL);
+    record->level = level;
+    record->deferred = false;
+
+    //! capture the raw arguments only, the backend will format them if needed.
+    if(formatter->deferred || (loggerSinks(logger, level) & LOGGER_SINK_RECORD)){
+        record->deferred = loggerCapture(logger, (deferredRecord_t *)record->buffer, 
+            sizeof(record->buffer), site, tag, format, args);
+    }
+
+    if(!record->deferred){
+        record->text = record->buffer;
+        record->length = formatter->invoke(formatter, &record->text, site, tag, level, format, args);
+    }
+
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    _asyncLogger_leave(async);
+}
+
+/**
+ * @brief   write the records pending in all the rings straight to the sinks at crash.
+ * @param   async is pointer to the asynchronous logger.
+ * @return  the number of records lost, those captured only, as rendering them is not
+ *          async-signal-safe.
+ * @note    no lock is taken, the records being written by the backend may be written twice.
+ */
+uint32_t asyncLoggerEmergency(asyncLogger_t *async){
+    asyncRecord_t *record;
+    uint32_t head, tail, lost = 0;
+
+    for(asyncRing_t *ring = async->rings; ring != NULL; ring = ring->next){
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        for(; head != tail; ++head){
+            record = &ring->records[head & ring->mask];
+            if(record->deferred){
+                lost++;
+                continue;
+            }
+            loggerEmergency(async->logger, record->text, record->length);
+        }
+    }
+    return lost;
+}
+
+/**
+ * @brief   initialise an asynchronous logger and switch the logger to asynchronous mode.
+ * @param   async is pointer to the asynchronous logger.
+ * @param   logger is the logger to run asynchronously.
+ * @param   numberOfRecords is the number of records in the ring of each thread,
+ *          it is rounded up to a power of 2.
+ */
+void asyncLoggerInit(asyncLogger_t *async, logger_t *logger, uint32_t numberOfRecords){
+    uint32_t number;
+    int ret;
+    assert(async != NULL && logger != NULL);
+    assert(logger->async == NULL);
+    assert(numberOfRecords > 0);
+
+    for(number = 2; number < numberOfRecords; number <<= 1);
+
+    //! {@code producers} is left as it is, a late producer of the last run may still count.
+    async->logger = logger;
+    async->numberOfRecords = number;
+    async->rings = NULL;
+    pthread_mutex_init(&async->ringsLock, NULL);
+    ret = pthread_key_create(&async->key, _asyncRing_close);
+    assert(ret == 0);
+
+    async->running = true;
+    ret = pthread_create(&async->backend, NULL, _asyncLogger_backend, async);
+    assert(ret == 0);
+
+    async->run = logger->run;
+    __atomic_store_n(&async->stopped, false, __ATOMIC_SEQ_CST);
+    //! publish the backend before the run method, see {@code _asyncLogger_log}.
+    __atomic_store_n(&logger->async, async, __ATOMIC_RELEASE);
+    __atomic_store_n(&logger->run, _asyncLogger_log, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief   stop the backend after all the records are written,
+ *          and switch the logger back to synchronous mode.
+ * @param   async is pointer to the asynchronous logger.
+ * @note    the logs of other threads from now on are written synchronously, the records
+ *          being produced at this moment are completed and written before the rings are freed.
+ */
+void asyncLoggerDeInit(asyncLogger_t *async){
+    logger_t *logger;
+    locker_t *locker;
+    writer_t *writer;
+    asyncRing_t *ring;
+    assert(async != NULL && async->logger != NULL);
+
+    logger = async->logger;
+    __atomic_store_n(&async->stopped, true, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&logger->run, async->run, __ATOMIC_RELEASE);
+
+    //! wait for the producers inside their rings, the backend still drains them meanwhile.
+    while(__atomic_load_n(&async->producers, __ATOMIC_SEQ_CST) != 0){
+        sched_yield();
+    }
+
+    __atomic_store_n(&async->running, false, __ATOMIC_RELEASE);
+    pthread_join(async->backend, NULL);
+
+    //! the crash handler walks the rings of the backend it loads.
+    __atomic_store_n(&logger->async, NULL, __ATOMIC_RELEASE);
+    pthread_key_delete(async->key);
+    while((ring = async->rings) != NULL){
+        async->rings = ring->next;
+        free(ring);
+    }
+    pthread_mutex_destroy(&async->ringsLock);
+
+    //! flush the data buffered by writers.
+    locker = logger->locker;
+    locker->lock(locker);
+    for(writer = logger->writer; writer != NULL; writer = writer->next){
+        if(writer->flush){
+            writer->flush(writer);
+        }
+    }
+    locker->unlock(locker);
+}
@@ -0,0 +1,563 @@
+/**
+ * @file    qlog_binaryWriter.c
+ * @author  qufeiyan
+ * @brief   Define a writer storing logs as compact binary frames for qlog.
+ * @version 1.0.0
+ * @date    2026/10/18 20:12:40
+ * @version Copyright (c) 2023
+ */
+
+/* Includes --------------------------------------------------------------------------------*/
+#include "qlog_binaryWriter.h"
+#include "qlog.h"
+#include "qlog_def.h"
+#include "qlog_deferred.h"
+#include "qlog_fileWriter.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint32_t crcTable[256];
+static pthread_once_t crcOnce = PTHREAD_ONCE_INIT;
+
+static void _binary_crcTable(void){
+    uint32_t crc;
+
+    for(uint32_t i = 0; i < 256; ++i){
+        crc = i;
+        for(int j = 0; j < 8; ++j){
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        crcTable[i] = crc;
+    }
+}
+
+uint32_t binaryCrc32(uint32_t crc, const void *data, size_t size){
+    const uint8_t *p = (const uint8_t *)data;
+
+    pthread_once(&crcOnce, _binary_crcTable);
+    crc = ~crc;
+    while(size--){
+        crc = crcTable[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+ * @brief   encode an unsigned varint, 7 bits per byte, the lowest bits first.
+ * @return  the size of the varint.
+ */
+static __inline uint32_t _binary_varint(uint8_t *p, uint64_t value){
+    uint32_t size = 0;
+
+    while(value >= 0x80){
+        p[size++] = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    p[size++] = (uint8_t)value;
+    return size;
+}
+
+/**
+ * @brief   encode a signed value as an unsigned one, small magnitudes stay small.
+ */
+static __inline uint64_t _binary_zigzag(int64_t value){
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+/**
+ * @brief   append a frame to the buffer.
+ * @param   binaryWriter is pointer to binary writer.
+ * @param   type is the type of frame.
+ * @param   head is the first part of payload.
+ * @param   sizeOfHead is the size of {@code head}.
+ * @param   body is the rest of payload.
+ * @param   sizeOfBody is the size of {@code body}.
+ * @note    the space must be reserved by {@code _binaryWriter_reserve}.
+ */
+static void _binaryWriter_frame(binaryWriter_t *binaryWriter, uint8_t type, const void *head,
+                                uint32_t sizeOfHead, const void *body, uint32_t sizeOfBody){
+    uint8_t *start, *p;
+    uint32_t crc;
+
+    start = p = (uint8_t *)binaryWriter->buffer + binaryWriter->length;
+    *p++ = type;
+    p += _binary_varint(p, sizeOfHead + sizeOfBody);
+    memcpy(p, head, sizeOfHead);
+    p += sizeOfHead;
+    memcpy(p, body, sizeOfBody);
+    p += sizeOfBody;
+
+    crc = binaryCrc32(0, start, p - start);
+    p[0] = (uint8_t)crc;
+    p[1] = (uint8_t)(crc >> 8);
+    p[2] = (uint8_t)(crc >> 16);
+    p[3] = (uint8_t)(crc >> 24);
+    p += 4;
+
+    binaryWriter->length += p - start;
+    binaryWriter->positionToWrite += p - start;
+    statsAdd(&binaryWriter->super.stats.bytes, p - start);
+}
+
+/**
+ * @brief   write the frames buffered to current log file.
+ * @param   binaryWriter is pointer to binary writer.
+ */
+static void _binaryWriter_output(binaryWriter_t *binaryWriter){
+    writerStats_t *stats = &binaryWriter->super.stats;
+    const char *data = binaryWriter->buffer;
+    int32_t size = binaryWriter->length;
+    uint64_t start;
+    ssize_t ret;
+
+    if(size == 0 || binaryWriter->fd < 0){
+        return;
+    }
+
+    start = statsNow();
+    while(size > 0){
+        ret = write(binaryWriter->fd, data, size);
+        if(ret < 0 && errno == EINTR){
+            continue;
+        }
+        if(ret < 0){
+            fprintf(stderr, "failed to write %s: %s\n", binaryWriter->segment.currentPath, strerror(errno));
+            break;
+        }
+        data += ret;
+        size -= ret;
+    }
+    binaryWriter->length = 0;
+    statsAdd(&stats->flushes, 1);
+    histogramRecord(&stats->flushLatency, statsNow() - start);
+}
+
+/**
+ * @brief   open current log file and start the segment with a header.
+ * @param   binaryWriter is pointer to binary writer.
+ * @return  false if the file can not be opened.
+ */
+static bool _binaryWriter_open(binaryWriter_t *binaryWriter){
+    uint8_t header[SIZE_OF_BINARY_HEADER];
+    uint64_t now;
+    int fd;
+
+    fd = open(binaryWriter->segment.currentPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0){
+        return false;
+    }
+
+    //! the ids are defined again in each segment.
+    binaryWriter->fd = fd;
+    binaryWriter->positionToWrite = 0;
+    binaryWriter->numberOfFormats = 0;
+    binaryWriter->numberOfTags = 0;
+    binaryWriter->epoch++;
+
+    now = binaryWriter->formatter->now(binaryWriter->formatter);
+    binaryWriter->lastTime = now;
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, BINARY_MAGIC, 4);
+    header[4] = BINARY_VERSION;
+    header[5] = (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) ? 1 : 2;
+    header[6] = sizeof(long);
+    header[7] = sizeof(void *);
+    header[8] = sizeof(size_t);
+    header[9] = sizeof(intmax_t);
+    header[10] = sizeof(ptrdiff_t);
+    header[11] = sizeof(long double);
+    for(int i = 0; i < 8; ++i){
+        header[16 + i] = (uint8_t)(now >> (8 * i));
+    }
+    memcpy(binaryWriter->buffer + binaryWriter->length, header, sizeof(header));
+    binaryWriter->length += sizeof(header);
+    binaryWriter->positionToWrite += sizeof(header);
+    return true;
+}
+
+/**
+ * @brief   close current log file and move to the next segment.
+ * @param   binaryWriter is pointer to binary writer.
+ * @note    nothing is renamed, old segments are deleted by the reaper of segment.
+ * @see     {@code segmentRotate}
+ */
+void _binaryWriter_rotate(binaryWriter_t *binaryWriter){
+    assert(binaryWriter != NULL);
+
+    _binaryWriter_output(binaryWriter);
+    if(binaryWriter->fd >= 0){
+        close(binaryWriter->fd);
+        binaryWriter->fd = -1;
+    }
+    segmentRotate(&binaryWriter->segment, binaryWriter->positionToWrite);
+    binaryWriter->positionToWrite = 0;
+}
+
+/**
+ * @brief   make room for the frames of a log, the file is rotated if it is full.
+ * @param   binaryWriter is pointer to binary writer.
+ * @param   time is the realtime of the log in ns.
+ * @return  false if no file can be opened.
+ * @note    the ids are only valid after it, as a rotation forgets them.
+ */
+static bool _binaryWriter_reserve(binaryWriter_t *binaryWriter, uint64_t time){
+    if(binaryWriter->fd >= 0 && (binaryWriter->positionToWrite + SIZE_OF_BINARY_LOG > binaryWriter->sizeOfFile ||
+        segmentExpired(&binaryWriter->segment, (time_t)(time / 1000000000ull)))){
+        binaryWriter->fileRotate(binaryWriter);
+    }
+    if(binaryWriter->length + SIZE_OF_BINARY_LOG > binaryWriter->sizeOfBuffer){
+        _binaryWriter_output(binaryWriter);
+    }
+    if(binaryWriter->fd < 0 && !_binaryWriter_open(binaryWriter)){
+        fprintf(stderr, "failed to open %s: %s\n", binaryWriter->segment.currentPath, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief   get the id of the format string of a log, it is defined at the first time in the segment.
+ * @param   binaryWriter is pointer to binary writer.
+ * @param   record is the captured log, its format is interned by the address of its callsite,
+ *          or by its address if it has no callsite.
+ * @return  the id, 0 if the table is full or the format is too long.
+ */
+static uint32_t _binaryWriter_format(binaryWriter_t *binaryWriter, const deferredRecord_t *record){
+    uint8_t head[2 * SIZE_OF_BINARY_VARINT];
+    char text[SIZE_OF_LOG_BUFFER];
+    struct binaryFormat *entry;
+    const qlog_site_t *site = record->site;
+    const void *key = site ? (const void *)site : (const void *)record->format;
+    uint32_t mask = COUNT_OF_BINARY_FORMAT - 1;
+    uint32_t index = (uint32_t)(((uintptr_t)key * 0x9E3779B97F4A7C15ull) >> 40) & mask, size;
+    size_t length, location = 0;
+
+    for(;; index = (index + 1) & mask){
+        entry = &binaryWriter->formats[index];
+        if(entry->epoch != binaryWriter->epoch){
+            break;
+        }
+        if(entry->key == key){
+            return entry->id;
+        }
+    }
+
+    //! keep a quarter of the table empty, so the probes are short.
+    length = strlen(record->format);
+    if(site != NULL){
+        location = snprintf(text, sizeof(text), "[%s:%u](#%s) ", site->file, site->line, site->function) + 1;
+    }
+    if(binaryWriter->numberOfFormats >= COUNT_OF_BINARY_FORMAT / 4 * 3 || location + length > SIZE_OF_LOG_BUFFER){
+        return 0;
+    }
+    entry->key = key;
+    entry->id = ++binaryWriter->numberOfFormats;
+    entry->epoch = binaryWriter->epoch;
+    if(site == NULL){
+        _binaryWriter_frame(binaryWriter, BINARY_FRAME_FORMAT, head, _binary_varint(head, entry->id),
+            record->format, length);
+    }else{
+        memcpy(text + location, record->format, length);
+        size = _binary_varint(head, entry->id);
+        size += _binary_varint(head + size, qlog_callsiteId(site));
+        _binaryWriter_frame(binaryWriter, BINARY_FRAME_SITE, head, size, text, location + length);
+    }
+    return entry->id;
+}
+
+/**
+ * @brief   get the id of a tag, it is defined at the first time in the segment.
+ * @param   binaryWriter is pointer to binary writer.
+ * @param   tag is the tag, interned by its content.
+ * @return  the id, 0 if the table is full or the tag is too long.
+ */
+static uint32_t _binaryWriter_tag(binaryWriter_t *binaryWriter, const char *tag){
+    uint8_t head[SIZE_OF_BINARY_VARINT];
+    struct binaryTag *entry;
+    uint32_t mask = COUNT_OF_BINARY_TAG - 1;
+    uint32_t hash, index;
+    size_t length;
+
+    length = strlen(tag);
+    if(length >= SIZE_OF_NAME){
+        return 0;
+    }
+    hash = loggerHashTag(tag);
+
+    for(index = hash & mask;; index = (index + 1) & mask){
+        entry = &binaryWriter->tags[index];
+        if(entry->epoch != binaryWriter->epoch){
+            break;
+        }
+        if(entry->hash == hash && strcmp(entry->tag, tag) == 0){
+            return entry->id;
+        }
+    }
+
+    if(binaryWriter->numberOfTags >= COUNT_OF_BINARY_TAG / 4 * 3){
+        return 0;
+    }
+    memcpy(entry->tag, tag, length + 1);
+    entry->hash = hash;
+    entry->id = ++binaryWriter->numberOfTags;
+    entry->epoch = binaryWriter->epoch;
+    _binaryWriter_frame(binaryWriter, BINARY_FRAME_TAG, head, _binary_varint(head, entry->id), tag, length);
+    return entry->id;
+}
+
+/**
+ * @brief   write the frame of a log whose arguments are captured.
+ * @param   binaryWriter is pointer to binary writer.
+ * @param   level is the level of the log.
+ * @param   record is the captured log.
+ * @return  false if the format string or the tag can not be interned.
+ */
+static bool _binaryWriter_log(binaryWriter_t *binaryWriter, level_t level, const deferredRecord_t *record,
+                              int64_t delta){
+    uint8_t head[3 * SIZE_OF_BINARY_VARINT + 1];
+    uint32_t size, formatId, tagId, tagLength;
+    const char *tag = deferredTag(record);
+
+    tagId = _binaryWriter_tag(binaryWriter, tag);
+    formatId = tagId ? _binaryWriter_format(binaryWriter, record) : 0;
+    if(formatId == 0){
+        return false;
+    }
+
+    size = _binary_varint(head, _binary_zigzag(delta));
+    head[size++] = level;
+    size += _binary_varint(head + size, tagId);
+    size += _binary_varint(head + size, formatId);
+    tagLength = strlen(tag) + 1;
+    _binaryWriter_frame(binaryWriter, BINARY_FRAME_LOG, head, size, tag + tagLength, record->size - tagLength);
+    return true;
+}
+
+/**
+ * @brief   write the frame of a log as text.
+ * @param   binaryWriter is pointer to binary writer.
+ * @param   level is the level of the log.
+ * @param   text is the text of the log, without color.
+ * @param   length is the length of {@code text}.
+ */
+static void _binaryWriter_text(binaryWriter_t *binaryWriter, level_t level, const char *text, int32_t length,
+                               int64_t delta){
+    uint8_t head[SIZE_OF_BINARY_VARINT + 1];
+    uint32_t size;
+
+
+    size = _binary_varint(head, _binary_zigzag(delta));
+    head[size++] = level;
+    _binaryWriter_frame(binaryWriter, BINARY_FRAME_TEXT, head, size, text, length);
+}
+
+/**
+ * @brief   write a log as binary frames.
+ * @param   writer is pointer to binary writer.
+ * @note    the frames are buffered, and written when the buffer is full, when the oldest
+ *          one is older than {@code FILE_FLUSH_INTERVAL}, or on a log at or above
+ *          {@code FILE_FLUSH_LEVEL}.
+ */
+void _binaryWriter_write(writer_t *writer){
+    binaryWriter_t *binaryWriter;
+    formatter_t *formatter;
+    const deferredRecord_t *record;
+    char text[SIZE_OF_LOG_BUFFER];
+    int32_t length;
+    uint64_t time;
+    int64_t delta;
+    assert(writer != NULL);
+    binaryWriter = (binaryWriter_t *)writer;
+    formatter = binaryWriter->formatter;
+
+    if(!writerAccepts(writer)) goto next;
+
+    record = writer->record;
+    time = record ? record->context.time : formatter->now(formatter);
+    if(!_binaryWriter_reserve(binaryWriter, time)){
+        statsAdd(&writer->stats.dropped, 1);
+        goto next;
+    }
+    if(binaryWriter->length <= SIZE_OF_BINARY_HEADER){
+        binaryWriter->firstTime = time;
+    }
+
+    delta = (int64_t)(time - binaryWriter->lastTime);
+    binaryWriter->lastTime = time;
+    if(record == NULL || !_binaryWriter_log(binaryWriter, writer->level, record, delta)){
+        //! the text is not rendered if no other writer consumes it.
+        if(writer->length > 0){
+            _binaryWriter_text(binaryWriter, writer->level, writer->buffer, writer->length, delta);
+        }else{
+            length = formatter->render(formatter, text, writer->level, record);
+            _binaryWriter_text(binaryWriter, writer->level, text, length, delta);
+        }
+    }
+    statsAdd(&writer->stats.records, 1);
+
+    //! important logs are not kept in buffer.
+    if(!binaryWriter->running || writer->level <= FILE_FLUSH_LEVEL ||
+        time - binaryWriter->firstTime >= FILE_FLUSH_INTERVAL * 1000000ull){
+        _binaryWriter_output(binaryWriter);
+    }
+
+next:
+    //! call another writer.
+    writer_t *nextWriter = writer->next;
+    if(nextWriter){
+        nextWriter->length = writer->length;
+        nextWriter->color = writer->color;
+        nextWriter->level = writer->level;
+        nextWriter->record = writer->record;
+        nextWriter->write(nextWriter);
+    }
+}
+
+/**
+ * @brief   flush a binary writer.
+ * @param   writer is pointer to binary writer.
+ */
+void _binaryWriter_flush(writer_t *writer){
+    assert(writer != NULL);
+    _binaryWriter_output((binaryWriter_t *)writer);
+}
+
+/**
+ * @brief   write the frames buffered, or a text as a frame, straight to the log file at crash.
+ * @param   writer is pointer to binary writer.
+ * @param   text is the text to write, NULL means the frames buffered.
+ * @param   length is the length of {@code text}.
+ * @note    no lock is taken, the file is not rotated, and no file is opened.
+ */
+void _binaryWriter_emergency(writer_t *writer, const char *text, int32_t length){
+    binaryWriter_t *binaryWriter = (binaryWriter_t *)writer;
+    formatter_t *formatter = binaryWriter->formatter;
+    uint64_t time;
+
+    if(binaryWriter->fd < 0 || binaryWriter->buffer == NULL){
+        return;
+    }
+
+    if(text != NULL){
+        if(binaryWriter->length + SIZE_OF_BINARY_LOG > binaryWriter->sizeOfBuffer){
+            return;
+        }
+        time = formatter->now(formatter);
+        _binaryWriter_text(binaryWriter, LOG_LEVEL_FATAL, text, length, (int64_t)(time - binaryWriter->lastTime));
+        binaryWriter->lastTime = time;
+    }
+    writerWriteAll(binaryWriter->fd, binaryWriter->buffer, binaryWriter->length);
+    binaryWriter->length = 0;
+}
+
+/**
+ * @brief   write the frames buffered and stop the reaper of segments.
+ * @param   writer is pointer to binary writer.
+ * @note    the log file is kept open, logs output later are written at once.
+ */
+void _binaryWriter_deInit(writer_t *writer){
+    binaryWriter_t *binaryWriter;
+    assert(writer != NULL);
+    binaryWriter = (binaryWriter_t *)writer;
+
+    if(!binaryWriter->running){
+        return;
+    }
+    _binaryWriter_output(binaryWriter);
+    binaryWriter->running = false;
+    segmentDeInit(&binaryWriter->segment);
+}
+
+/**
+ * @brief   close the log file and free the buffer of a binary writer stopped by deInit.
+ * @param   writer is pointer to binary writer.
+ */
+void _binaryWriter_release(writer_t *writer){
+    binaryWriter_t *binaryWriter;
+    assert(writer != NULL);
+    binaryWriter = (binaryWriter_t *)writer;
+    assert(!binaryWriter->running);
+
+    _binaryWriter_output(binaryWriter);
+    if(binaryWriter->fd >= 0){
+        close(binaryWriter->fd);
+        binaryWriter->fd = -1;
+    }
+    free(binaryWriter->buffer);
+    binaryWriter->buffer = NULL;
+    segmentRelease(&binaryWriter->segment);
+}
+
+/**
+ * @brief   initialise a binary writer.
+ * @param   writer is pointer to binary writer.
+ * @param   buffer is pointer to log string.
+ * @param   formatter is the formatter of logger, it converts the time of logs.
+ * @param   fileName is the name of log file.
+ * @param   directory is the directory of log file.
+ * @param   numberOfFiles is the number of log files.
+ * @param   sizeOfFile is the size of a single log file.
+ */
+void binaryWriterInit(writer_t *writer, char *buffer, formatter_t *formatter, const char *fileName,
+                      const char *directory, int numberOfFiles, int sizeOfFile){
+    binaryWriter_t *binaryWriter;
+    int length;
+    assert(writer && buffer && formatter);
+    assert(fileName && directory);
+    assert(numberOfFiles > 0 && sizeOfFile >= 2 * SIZE_OF_BINARY_LOG);
+
+    binaryWriter = (binaryWriter_t *)writer;
+    memset(binaryWriter, 0, sizeof(*binaryWriter));
+
+    strcpy(binaryWriter->directory, directory);
+    length = strlen(fileName);
+    //! append suffix for log file.
+    snprintf(binaryWriter->filePath, sizeof(binaryWriter->filePath), "%s/%s%s", directory, fileName,
+        (length >= 4 && strcmp(fileName + length - 4, ".qlb") == 0) ? "" : ".qlb");
+
+    //! create a directory if it does not exist.
+    if(access(binaryWriter->directory, F_OK) < 0){
+        if(mkdir(binaryWriter->directory, S_IRWXU | S_IRWXG | S_IRWXO) < 0){
+            fprintf(stderr, "failed to create %s: %s\n",
+                binaryWriter->directory, strerror(errno));
+        }
+    }
+
+    //! the logs are written to $(logfile).qlb.$(sequence), the segments left are kept.
+    segmentInit(&binaryWriter->segment, binaryWriter->filePath, numberOfFiles, sizeOfFile);
+
+    binaryWriter->sizeOfBuffer = (sizeOfFile < SIZE_OF_FILE_BUFFER) ? sizeOfFile : SIZE_OF_FILE_BUFFER;
+    binaryWriter->buffer = (char *)malloc(binaryWriter->sizeOfBuffer);
+    assert(binaryWriter->buffer != NULL);
+
+    binaryWriter->numberOfFiles = numberOfFiles;
+    binaryWriter->sizeOfFile = sizeOfFile;
+    binaryWriter->formatter = formatter;
+    binaryWriter->fd = -1;
+    binaryWriter->positionToWrite = 0;
+    binaryWriter->epoch = 0;
+    binaryWriter->running = true;
+    binaryWriter->fileRotate = _binaryWriter_rotate;
+
+    strcpy(writer->name, "binary");
+    writer->buffer = buffer;
+    writer->binary = true;
+    writer->write = _binaryWriter_write;
+    writer->flush = _binaryWriter_flush;
+    writer->deInit = _binaryWriter_deInit;
+    writer->release = _binaryWriter_release;
+    writer->emergency = _binaryWriter_emergency;
+    writer->next = NULL;
+    writer->enable = false;
+}
@@ -0,0 +1,448 @@
+/**
+ * @file    qlog_config.c
+ * @author  qufeiyan
+ * @brief   Parse the config file of a logger, and reload it once it changes.
+ * @version 1.0.0
+ * @date    2026/10/19 02:41:06
+ * @version Copyright (c) 2023
+ */
+
+/* Includes --------------------------------------------------------------------------------*/
+#include "qlog_config.h"
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#define SIZE_OF_CONFIG_LINE     (256)   //! maximum size of a line of config file.
+
+static const char *levelNames[] = {
+    [LOG_LEVEL_FATAL] = "fatal",
+    [LOG_LEVEL_ERROR] = "error",
+    [LOG_LEVEL_WARNING] = "warning",
+    [LOG_LEVEL_INFO] = "info",
+    [LOG_LEVEL_DEBUG] = "debug",
+};
+
+/**
+ * @brief   parse a level.
+ * @return  the level, {@code CONFIG_UNSET} if it is not a level.
+ */
+static int32_t _config_level(const char *value){
+    for(int32_t level = 0; level < LOG_LEVEL_BUTT; ++level){
+        if(strcasecmp(value, levelNames[level]) == 0){
+            return level;
+        }
+    }
+    return strcasecmp(value, "warn") == 0 ? LOG_LEVEL_WARNING : CONFIG_UNSET;
+}
+
+/**
+ * @brief   parse a switch.
+ * @return  1 on, 0 off, {@code CONFIG_UNSET} if it is not a switch.
+ */
+static int32_t _config_switch(const char *value){
+    if(strcasecmp(value, "on") == 0 || strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0){
+        return 1;
+    }
+    if(strcasecmp(value, "off") == 0 || strcasecmp(value, "false") == 0 || strcmp(value, "0") == 0){
+        return 0;
+    }
+    return CONFIG_UNSET;
+}
+
+/**
+ * @brief   parse a rate limit as "rate[/burst]", the burst is 1 if not given.
+ * @return  false if it is not a rate limit.
+ */
+static bool _config_rate(const char *value, uint32_t *rate, uint32_t *burst){
+    unsigned long number;
+    char *end;
+
+    errno = 0;
+    number = strtoul(value, &end, 10);
+    if(end == value || errno != 0 || number > UINT32_MAX){
+        return false;
+    }
+    *rate = (uint32_t)number;
+    *burst = 1;
+    if(*end == '/'){
+        value = end + 1;
+        number = strtoul(value, &end, 10);
+        if(end == value || errno != 0 || number == 0 || number > UINT32_MAX){
+            return false;
+        }
+        *burst = (uint32_t)number;
+    }
+    return *end == '\0';
+}
+
+/**
+ * @brief   trim the spaces around a string in place.
+ */
+static char *_config_trim(char *text){
+    char *end;
+
+    while(*text == ' ' || *text == '\t'){
+        text++;
+    }
+    end = text + strlen(text);
+    while(end > text && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')){
+        *--end = '\0';
+    }
+    return text;
+}
+
+/**
+ * @brief   get the settings of a writer, it is added at the first time.
+ * @return  NULL if there are too many writers.
+ */
+static struct configWriter *_config_writer(config_t *config, const char *name){
+    struct configWriter *writer;
+
+    for(uint32_t i = 0; i < config->numberOfWriters; ++i){
+        if(strcmp(config->writers[i].name, name) == 0){
+            return &config->writers[i];
+        }
+    }
+    if(config->numberOfWriters >= COUNT_OF_CONFIG_WRITER){
+        return NULL;
+    }
+    writer = &config->writers[config->numberOfWriters++];
+    strcpy(writer->name, name);
+    writer->enable = CONFIG_UNSET;
+    writer->level = CONFIG_UNSET;
+    return writer;
+}
+
+/**
+ * @brief   set a tag, a tag given twice takes the last level.
+ * @return  false if there are too many tags.
+ */
+static bool _config_tag(config_t *config, const char *tag, level_t level){
+    uint32_t i;
+
+    for(i = 0; i < config->numberOfTags && strcmp(config->tags[i], tag) != 0; ++i);
+    if(i == config->numberOfTags){
+        if(i >= COUNT_OF_TAG){
+            return false;
+        }
+        strcpy(config->tags[i], tag);
+        config->numberOfTags++;
+    }
+    config->levels[i] = level;
+    return true;
+}
+
+/**
+ * @brief   set a rate limit of a tag, a tag given twice takes the last limit.
+ * @return  false if there are too many tags.
+ */
+static bool _config_limit(config_t *config, const char *tag, uint32_t rate, uint32_t burst){
+    uint32_t i;
+
+    for(i = 0; i < config->numberOfLimits && strcmp(config->limits[i].tag, tag) != 0; ++i);
+    if(i == config->numberOfLimits){
+        if(i >= sizeof(config->limits) / sizeof(config->limits[0])){
+            return false;
+        }
+        strcpy(config->limits[i].tag, tag);
+        config->numberOfLimits++;
+    }
+    config->limits[i].rate = rate;
+    config->limits[i].burst = burst;
+    return true;
+}
+
+/**
+ * @brief   apply a line "key = value" to a config.
+ * @return  the error, NULL if the line is valid.
+ */
+static const char *_config_line(config_t *config, const char *key, const char *value){
+    struct configWriter *writer;
+    const char *name, *dot;
+    int32_t number;
+    uint32_t rate, burst;
+
+    if(strcmp(key, "level") == 0){
+        if((number = _config_level(value)) == CONFIG_UNSET){
+            return "unknown level";
+        }
+        config->level = number;
+        return NULL;
+    }
+
+    if(strncmp(key, "tag.", 4) == 0){
+        name = key + 4;
+        if(strcmp(name, "*") == 0){
+            number = strcasecmp(value, "off") == 0 ? FILTER_LEVEL_NONE : _config_level(value);
+            if(number == CONFIG_UNSET){
+                return "unknown level";
+            }
+            config->others = number;
+        }else{
+            if(*name == '\0' || strlen(name) >= SIZE_OF_NAME){
+                return "invalid tag";
+            }
+            if((number = _config_level(value)) == CONFIG_UNSET){
+                return "unknown level";
+            }
+            if(!_config_tag(config, name, (level_t)number)){
+                return "too many tags";
+            }
+        }
+        config->tagged = true;
+        return NULL;
+    }
+
+    if(strncmp(key, "writer.", 7) == 0){
+        char target[SIZE_OF_NAME];
+        size_t length;
+
+        name = key + 7;
+        dot = strchr(name, '.');
+        length = dot ? (size_t)(dot - name) : strlen(name);
+        if(length == 0 || length >= SIZE_OF_NAME || (dot != NULL && strcmp(dot, ".level") != 0)){
+            return "invalid writer";
+        }
+        memcpy(target, name, length);
+        target[length] = '\0';
+        if((writer = _config_writer(config, target)) == NULL){
+            return "too many writers";
+        }
+        if(dot != NULL){
+            if((number = _config_level(value)) == CONFIG_UNSET){
+                return "unknown level";
+            }
+            writer->level = (int8_t)number;
+        }else{
+            if((number = _config_switch(value)) == CONFIG_UNSET){
+                return "expect on or off";
+            }
+            writer->enable = (int8_t)number;
+        }
+        return NULL;
+    }
+
+    if(strncmp(key, "limit.", 6) == 0){
+        if(!_config_rate(value, &rate, &burst)){
+            return "expect rate[/burst]";
+        }
+        name = key + 6;
+        if(strcmp(name, "callsite") == 0){
+            config->siteLimited = true;
+            config->siteRate = rate;
+            config->siteBurst = burst;
+            return NULL;
+        }
+        if(strncmp(name, "tag.", 4) != 0 || name[4] == '\0' || strlen(name + 4) >= SIZE_OF_NAME){
+            return "invalid limit";
+        }
+        return _config_limit(config, name + 4, rate, burst) ? NULL : "too many limited tags";
+    }
+
+    if(strcmp(key, "repeat") == 0){
+        if((number = _config_switch(value)) == CONFIG_UNSET){
+            return "expect on or off";
+        }
+        config->repeat = (int8_t)number;
+        return NULL;
+    }
+    return "unknown key";
+}
+
+void configInit(config_t *config){
+    assert(config != NULL);
+
+    memset(config, 0, sizeof(*config));
+    config->level = CONFIG_UNSET;
+    config->others = FILTER_LEVEL_NONE;
+    config->repeat = CONFIG_UNSET;
+}
+
+bool configParse(config_t *config, const char *path){
+    char line[SIZE_OF_CONFIG_LINE];
+    char *key, *value, *mark;
+    const char *error = NULL;
+    uint32_t number = 0;
+    FILE *file;
+    assert(config != NULL && path != NULL);
+
+    configInit(config);
+    file = fopen(path, "r");
+    if(file == NULL){
+        fprintf(stderr, "[warning]: failed to open config %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    while(error == NULL && fgets(line, sizeof(line), file) != NULL){
+        number++;
+        if(strchr(line, '\n') == NULL && !feof(file)){
+            error = "line too long";
+            break;
+        }
+        if((mark = strchr(line, '#')) != NULL){
+            *mark = '\0';
+        }
+        key = _config_trim(line);
+        if(*key == '\0'){
+            continue;
+        }
+        if((mark = strchr(key, '=')) == NULL){
+            error = "expect key = value";
+            break;
+        }
+        *mark = '\0';
+        key = _config_trim(key);
+        value = _config_trim(mark + 1);
+        error = _config_line(config, key, value);
+    }
+    fclose(file);
+
+    if(error != NULL){
+        fprintf(stderr, "[warning]: %s:%u: %s\n", path, number, error);
+        return false;
+    }
+    return true;
+}
+
+void configWatcherInit(configWatcher_t *watcher, configApply_t apply, void *context){
+    assert(watcher != NULL && apply != NULL);
+
+    memset(watcher, 0, sizeof(*watcher));
+    watcher->apply = apply;
+    watcher->context = context;
+    pthread_mutex_init(&watcher->mutex, NULL);
+    configInit(&watcher->applied);
+}
+
+void configWatcherDeInit(configWatcher_t *watcher){
+    assert(watcher != NULL);
+
+    configWatcherStop(watcher);
+    pthread_mutex_destroy(&watcher->mutex);
+}
+
+bool configWatcherLoad(configWatcher_t *watcher, const char *path){
+    config_t config;
+    assert(watcher != NULL && path != NULL);
+
+    //! the file is parsed aside, an invalid one leaves the logger as it is.
+    if(!configParse(&config, path)){
+        return false;
+    }
+
+    pthread_mutex_lock(&watcher->mutex);
+    watcher->apply(watcher->context, &watcher->applied, &config);
+    watcher->applied = config;
+    pthread_mutex_unlock(&watcher->mutex);
+    return true;
+}
+
+/**
+ * @brief   the watcher thread, reloads the file each time it is written or moved in.
+ * @param   args is pointer to config watcher.
+ */
+static void *_config_watcher(void *args){
+    configWatcher_t *watcher = (configWatcher_t *)args;
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd fds[2] = {
+        { .fd = watcher->inotify, .events = POLLIN },
+        { .fd = watcher->wakeup[0], .events = POLLIN },
+    };
+    const struct inotify_event *event;
+    const char *name;
+    ssize_t length;
+    bool changed;
+
+    name = strrchr(watcher->path, '/');
+    name = name ? name + 1 : watcher->path;
+
+    for(;;){
+        if(poll(fds, 2, -1) < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            break;
+        }
+        if(fds[1].revents != 0){
+            break;
+        }
+
+        length = read(watcher->inotify, events, sizeof(events));
+        if(length <= 0){
+            continue;
+        }
+        changed = false;
+        for(char *cursor = events; cursor < events + length; cursor += sizeof(*event) + event->len){
+            event = (const struct inotify_event *)cursor;
+            if(event->len > 0 && strcmp(event->name, name) == 0){
+                changed = true;
+            }
+        }
+        //! an editor writing the file in several steps may make it reloaded several times.
+        if(changed){
+            configWatcherLoad(watcher, watcher->path);
+        }
+    }
+    return NULL;
+}
+
+bool configWatcherStart(configWatcher_t *watcher, const char *path){
+    char directory[SIZE_OF_CONFIG_PATH];
+    const char *slash;
+    int ret;
+    assert(watcher != NULL && path != NULL);
+
+    configWatcherStop(watcher);
+    if(strlen(path) >= sizeof(watcher->path) || !configWatcherLoad(watcher, path)){
+        return false;
+    }
+    strcpy(watcher->path, path);
+
+    //! the directory is watched, as the file may be replaced by a rename.
+    slash = strrchr(path, '/');
+    if(slash == NULL){
+        strcpy(directory, ".");
+    }else{
+        snprintf(directory, sizeof(directory), "%.*s", slash == path ? 1 : (int)(slash - path), path);
+    }
+
+    watcher->inotify = inotify_init1(IN_CLOEXEC);
+    if(watcher->inotify < 0){
+        return false;
+    }
+    if(inotify_add_watch(watcher->inotify, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+        pipe(watcher->wakeup) < 0){
+        fprintf(stderr, "[warning]: failed to watch config %s: %s\n", path, strerror(errno));
+        close(watcher->inotify);
+        return false;
+    }
+
+    watcher->running = true;
+    ret = pthread_create(&watcher->watcher, NULL, _config_watcher, watcher);
+    assert(ret == 0);
+    return true;
+}
+
+void configWatcherStop(configWatcher_t *watcher){
+    ssize_t ret;
+    assert(watcher != NULL);
+
+    if(!watcher->running){
+        return;
+    }
+    watcher->running = false;
+    ret = write(watcher->wakeup[1], "", 1);
+    (void)ret;
+
+    pthread_join(watcher->watcher, NULL);
+    close(watcher->inotify);
+    close(watcher->wakeup[0]);
+    close(watcher->wakeup[1]);
+}
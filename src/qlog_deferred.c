@@ -0,0 +1,325 @@
+/**
+ * @file    qlog_deferred.c
+ * @author  qufeiyan
+ * @brief   Capture the raw arguments of a log on the hot path, and replay them
+ *          through snprintf later, so the output is the same as vsnprintf.
+ * @version 1.0.0
+ * @date    2026/10/18 11:10:52
+ * @version Copyright (c) 2023
+ */
+
+/* Includes --------------------------------------------------------------------------------*/
+#include "qlog_deferred.h"
+#include "qlog_def.h"
+#include <assert.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SIZE_OF_SPEC            (32)        //! maximum length of a conversion specification.
+#define STRING_NULL             (0xFFFF)    //! length of a NULL string argument.
+
+enum argType{
+    ARG_NONE,           //! "%%", consumes no argument.
+    ARG_INT,
+    ARG_LONG,
+    ARG_LLONG,
+    ARG_INTMAX,
+    ARG_SIZE,
+    ARG_PTRDIFF,
+    ARG_DOUBLE,
+    ARG_LDOUBLE,
+    ARG_STRING,
+    ARG_POINTER,
+    ARG_UNSUPPORTED,
+};
+
+struct spec{
+    const char *start;              //! points to '%'.
+    int32_t length;                 //! length of the specification.
+    enum argType type;
+    bool starWidth;                 //! width is given by an int argument.
+    bool starPrecision;             //! precision is given by an int argument.
+    int32_t precision;              //! precision in digits, -1 if not given.
+};
+
+/**
+ * @brief   parse a conversion specification.
+ * @param   format points to '%'.
+ * @param   spec is the result.
+ * @return  pointer to the character after the specification.
+ */
+static const char *_spec_parse(const char *format, struct spec *spec){
+    const char *p = format + 1;
+    int modifier = 0;   //! -2: hh, -1: h, 1: l, 2: ll, 'j', 'z', 't', 'L'.
+
+    spec->start = format;
+    spec->starWidth = spec->starPrecision = false;
+    spec->precision = -1;
+
+    if(*p == '%'){
+        spec->type = ARG_NONE;
+        spec->length = 2;
+        return p + 1;
+    }
+
+    while(*p && strchr("-+ #0'", *p)) p++;
+    if(*p == '*'){
+        spec->starWidth = true;
+        p++;
+    }else{
+        while(*p >= '0' && *p <= '9') p++;
+    }
+    if(*p == '$'){
+        //! positional arguments can not be replayed in order.
+        spec->type = ARG_UNSUPPORTED;
+        spec->length = p - format;
+        return p;
+    }
+    if(*p == '.'){
+        p++;
+        if(*p == '*'){
+            spec->starPrecision = true;
+            p++;
+        }else{
+            spec->precision = 0;
+            while(*p >= '0' && *p <= '9'){
+                spec->precision = spec->precision * 10 + (*p++ - '0');
+            }
+        }
+    }
+
+    switch(*p){
+        case 'h': modifier = (p[1] == 'h') ? -2 : -1; p += (p[1] == 'h') ? 2 : 1; break;
+        case 'l': modifier = (p[1] == 'l') ?  2 :  1; p += (p[1] == 'l') ? 2 : 1; break;
+        case 'q': modifier = 2; p++; break;
+        case 'j': case 'z': case 't': case 'L': modifier = *p++; break;
+        default: break;
+    }
+
+    switch(*p){
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+            switch(modifier){
+                case 1:   spec->type = ARG_LONG; break;
+                case 2:   spec->type = ARG_LLONG; break;
+                case 'j': spec->type = ARG_INTMAX; break;
+                case 'z': spec->type = ARG_SIZE; break;
+                case 't': spec->type = ARG_PTRDIFF; break;
+                default:  spec->type = ARG_INT; break;
+            }
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            spec->type = (modifier == 'L') ? ARG_LDOUBLE : ARG_DOUBLE;
+            break;
+        case 'c':
+            spec->type = ARG_INT;   //! char and wint_t are both promoted to int.
+            break;
+        case 's':
+            spec->type = (modifier == 0) ? ARG_STRING : ARG_UNSUPPORTED;
+            break;
+        case 'p':
+            spec->type = ARG_POINTER;
+            break;
+        default:
+            //! %n writes through a pointer, %m reads errno, both must be done in place.
+            spec->type = ARG_UNSUPPORTED;
+            break;
+    }
+
+    if(*p) p++;
+    spec->length = p - format;
+    if(spec->length >= SIZE_OF_SPEC){
+        spec->type = ARG_UNSUPPORTED;
+    }
+    return p;
+}
+
+#define CAPTURE(type, value) do{                        \
+    type _value = (value);                              \
+    if(end - current < (ptrdiff_t)sizeof(type)) return -1; \
+    memcpy(current, &_value, sizeof(type));             \
+    current += sizeof(type);                            \
+}while(0)
+
+int32_t deferredCapture(deferredRecord_t *record, int32_t size, const char *tag, const char *format, va_list args){
+    struct spec spec;
+    char *current, *end;
+    const char *p, *string;
+    size_t length;
+    int32_t precision;
+    uint16_t prefix;
+    assert(record != NULL && format != NULL);
+
+    current = record->data;
+    end = (char *)record + size;
+    if(current >= end){
+        return -1;
+    }
+
+    tag = tag ? tag : "";
+    length = strlen(tag) + 1;
+    if(end - current < (ptrdiff_t)length){
+        return -1;
+    }
+    memcpy(current, tag, length);
+    current += length;
+
+    p = format;
+    while((p = strchr(p, '%')) != NULL){
+        p = _spec_parse(p, &spec);
+        precision = spec.precision;
+
+        if(spec.starWidth){
+            CAPTURE(int, va_arg(args, int));
+        }
+        if(spec.starPrecision){
+            precision = va_arg(args, int);
+            CAPTURE(int, precision);
+        }
+
+        switch(spec.type){
+            case ARG_NONE:      break;
+            case ARG_INT:       CAPTURE(int, va_arg(args, int)); break;
+            case ARG_LONG:      CAPTURE(long, va_arg(args, long)); break;
+            case ARG_LLONG:     CAPTURE(long long, va_arg(args, long long)); break;
+            case ARG_INTMAX:    CAPTURE(intmax_t, va_arg(args, intmax_t)); break;
+            case ARG_SIZE:      CAPTURE(size_t, va_arg(args, size_t)); break;
+            case ARG_PTRDIFF:   CAPTURE(ptrdiff_t, va_arg(args, ptrdiff_t)); break;
+            case ARG_DOUBLE:    CAPTURE(double, va_arg(args, double)); break;
+            case ARG_LDOUBLE:   CAPTURE(long double, va_arg(args, long double)); break;
+            case ARG_POINTER:   CAPTURE(void *, va_arg(args, void *)); break;
+            case ARG_STRING:
+                string = va_arg(args, const char *);
+                if(string == NULL){
+                    CAPTURE(uint16_t, STRING_NULL);
+                    break;
+                }
+                //! never read beyond the precision, the string may not be terminated.
+                length = (precision >= 0) ? strnlen(string, precision) : strlen(string);
+                if(length >= STRING_NULL){
+                    return -1;
+                }
+                prefix = length;
+                CAPTURE(uint16_t, prefix);
+                if(end - current < (ptrdiff_t)length + 1){
+                    return -1;
+                }
+                memcpy(current, string, length);
+                current[length] = '\0';
+                current += length + 1;
+                break;
+            default:
+                return -1;
+        }
+    }
+
+    record->format = format;
+    record->size = current - record->data;
+    return current - (char *)record;
+}
+
+#undef CAPTURE
+
+#define REPLAY(type) ({                                 \
+    type _value;                                        \
+    if(end - args < (ptrdiff_t)sizeof(type)) return -1; \
+    memcpy(&_value, args, sizeof(type));                \
+    args += sizeof(type);                               \
+    _value;                                             \
+})
+
+/**
+ * @brief   output a piece to the buffer, as vsnprintf truncates the whole string.
+ */
+#define PIECE(...) do{                                  \
+    int32_t _offset = (total < size) ? total : size - 1; \
+    total += snprintf(buffer + _offset, size - _offset, __VA_ARGS__); \
+}while(0)
+
+/**
+ * @brief   output literal text to the buffer, as vsnprintf truncates the whole string.
+ * @return  the length of the whole string after the text.
+ */
+static int32_t _literal(char *buffer, int32_t size, int32_t total, const char *text, int32_t length){
+    int32_t offset, lengthToCopy;
+
+    offset = (total < size) ? total : size - 1;
+    lengthToCopy = (length < size - 1 - offset) ? length : size - 1 - offset;
+    memcpy(buffer + offset, text, lengthToCopy);
+    buffer[offset + lengthToCopy] = '\0';
+    return total + length;
+}
+
+int32_t deferredFormat(char *buffer, int32_t size, const char *format, const char *args, int32_t sizeOfArgs){
+    struct spec spec;
+    char text[SIZE_OF_SPEC];
+    const char *p, *literal, *end;
+    const char *string;
+    int32_t total;
+    int width, precision;
+    uint16_t prefix;
+    assert(buffer != NULL && size > 0);
+    assert(format != NULL && args != NULL && sizeOfArgs >= 0);
+
+    end = args + sizeOfArgs;
+    total = 0;
+    buffer[0] = '\0';
+    literal = format;
+    for(p = format; (p = strchr(p, '%')) != NULL; literal = p){
+        //! literal text before the specification.
+        total = _literal(buffer, size, total, literal, p - literal);
+
+        p = _spec_parse(p, &spec);
+        memcpy(text, spec.start, spec.length);
+        text[spec.length] = '\0';
+
+        width = spec.starWidth ? REPLAY(int) : 0;
+        precision = spec.starPrecision ? REPLAY(int) : 0;
+
+#define REPLAY_PIECE(value) do{                                                     \
+    if(spec.starWidth && spec.starPrecision) PIECE(text, width, precision, value);  \
+    else if(spec.starWidth) PIECE(text, width, value);                              \
+    else if(spec.starPrecision) PIECE(text, precision, value);                      \
+    else PIECE(text, value);                                                        \
+}while(0)
+
+        switch(spec.type){
+            case ARG_NONE:      PIECE("%%"); break;
+            case ARG_INT:       REPLAY_PIECE(REPLAY(int)); break;
+            case ARG_LONG:      REPLAY_PIECE(REPLAY(long)); break;
+            case ARG_LLONG:     REPLAY_PIECE(REPLAY(long long)); break;
+            case ARG_INTMAX:    REPLAY_PIECE(REPLAY(intmax_t)); break;
+            case ARG_SIZE:      REPLAY_PIECE(REPLAY(size_t)); break;
+            case ARG_PTRDIFF:   REPLAY_PIECE(REPLAY(ptrdiff_t)); break;
+            case ARG_DOUBLE:    REPLAY_PIECE(REPLAY(double)); break;
+            case ARG_LDOUBLE:   REPLAY_PIECE(REPLAY(long double)); break;
+            case ARG_POINTER:   REPLAY_PIECE(REPLAY(void *)); break;
+            case ARG_STRING:
+                prefix = REPLAY(uint16_t);
+                if(prefix == STRING_NULL){
+                    string = NULL;
+                }else{
+                    if(end - args < (ptrdiff_t)prefix + 1 || args[prefix] != '\0'){
+                        return -1;
+                    }
+                    string = args;
+                    args += prefix + 1;
+                }
+                REPLAY_PIECE(string);
+                break;
+            default:
+                //! never captured, see {@code deferredCapture}, the format does not match.
+                return -1;
+        }
+#undef REPLAY_PIECE
+    }
+
+    //! the rest literal text.
+    return _literal(buffer, size, total, literal, strlen(literal));
+}
+
+#undef PIECE
+#undef REPLAY
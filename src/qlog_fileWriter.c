@@ -13,14 +13,17 @@
 #include "qlog_def.h"
 #include "qlog_slist.h"
 #include <assert.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/stat.h>  
 #include <errno.h>
+#include <fcntl.h>
 
 
 // struct fileWriter{
@@ -44,87 +47,178 @@
 // typedef struct fileWriter fileWriter_t;
 
 /**
- * @brief   rotate all the log files.
+ * @brief   close current log file and move to the next segment.
  * @param   fileWriter is pointer to file writer.
- * @note    
- * @see     {@code _fileWriter_flush}
+ * @note    nothing is renamed, old segments are deleted by the reaper of segment.
+ * @see     {@code segmentRotate}
  */
 void _fileWriter_rotate(fileWriter_t *fileWriter){
-    static char oldFileName[SIZE_OF_FILE_PATH];
-    static char newFileName[SIZE_OF_FILE_PATH]; 
-    int length;
     assert(fileWriter != NULL);
 
-    length = snprintf(oldFileName, sizeof(oldFileName),  \
-        "%s.%-4d", fileWriter->filePath, fileWriter->numberOfFiles - 1);
-    assert(length <= sizeof(oldFileName));
+    if(fileWriter->file != NULL){
+        fileWriter->fd = -1;
+        fclose(fileWriter->file);
+        fileWriter->file = NULL; //! a new file will open when flush log buffer.
+    }
+    segmentRotate(&fileWriter->segment, fileWriter->positionToWrite);
+    fileWriter->positionToWrite = 0;
+}
 
-    //! remove whitespace from the end of string {@code oldFileName}.
-    for(int i = 3; i < 0; --i){
-        if(oldFileName[length - i] == ' '){
-            oldFileName[length - i] = '\0';
-            break;
-        }
+/**
+ * @brief   get the monotonic time in ns.
+ */
+static uint64_t _fileWriter_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * @brief   write a batch of logs to log file, the file is rotated if it is full.
+ * @param   fileWriter is pointer to file writer.
+ * @param   data is the logs to write.
+ * @param   size is the size of {@code data}.
+ * @note    called by the flusher, or by the caller if the flusher is stopped.
+ */
+static void _fileWriter_output(fileWriter_t *fileWriter, const char *data, int32_t size){
+    writerStats_t *stats = &fileWriter->super.stats;
+    uint64_t start;
+
+    if(fileWriter->positionToWrite > 0 && (fileWriter->positionToWrite + size > fileWriter->sizeOfFile ||
+        segmentExpired(&fileWriter->segment, time(NULL)))){
+        fileWriter->fileRotate(fileWriter);
     }
-    //！delete the oldest file.
-    if(access(oldFileName, F_OK) == 0){
-        remove(oldFileName);
+
+    if(fileWriter->file == NULL){
+        char *path = fileWriter->segment.currentPath;
+        fileWriter->file = fopen(path, "w+");
+        assert(fileWriter->file != NULL);
+        fileWriter->fd = fileno(fileWriter->file);
+        fileWriter->positionToWrite = 0;
     }
 
-    length -= 5;
-    strncpy(newFileName, fileWriter->filePath, length);
+    start = statsNow();
+    fwrite(data, size, 1, fileWriter->file);
+    fflush(fileWriter->file);
+    fileWriter->positionToWrite += size;
+    statsAdd(&stats->flushes, 1);
+    histogramRecord(&stats->flushLatency, statsNow() - start);
+}
+
+/**
+ * @brief   hand the filling buffer to the flusher and start filling the next one.
+ * @param   fileWriter is pointer to file writer.
+ * @note    the mutex must be held, waits if all the other buffers are not written yet.
+ *          if the flusher is stopped, the buffer is written by the caller.
+ */
+static void _fileWriter_swap(fileWriter_t *fileWriter){
+    fileBuffer_t *buffer;
 
-    //! $(logfile).log.$(n - 1) --> $(logfile).log.$(n)
-    for (int i = fileWriter->numberOfFiles - 2; i >= 0; --i) {
-        snprintf(oldFileName + length, sizeof(oldFileName), ".%d", i);
-        snprintf(newFileName + length, sizeof(oldFileName), ".%d", i + 1);
+    while(fileWriter->numberOfReady >= fileWriter->numberOfBuffers - 1 ||
+          (!fileWriter->running && fileWriter->numberOfReady > 0)){
+        pthread_cond_wait(&fileWriter->done, &fileWriter->mutex);
+    }
 
-        rename(oldFileName, newFileName);
+    buffer = &fileWriter->buffers[fileWriter->filling];
+    if(!fileWriter->running){
+        _fileWriter_output(fileWriter, buffer->data, buffer->length);
+        buffer->length = 0;
+        return;
     }
 
-    //! $(logfile).log --> $(logfile).log.0
-    if(fileWriter->file != NULL){
-        fclose(fileWriter->file);
-        fileWriter->file = NULL; //! a new file will open when flush log buffer.
+    fileWriter->numberOfReady++;
+    fileWriter->filling = (fileWriter->filling + 1) % fileWriter->numberOfBuffers;
+    pthread_cond_signal(&fileWriter->ready);
+}
+
+/**
+ * @brief   the flusher thread, writes the full buffers, and the filling buffer when
+ *          its first log is older than {@code interval}.
+ * @param   args is pointer to file writer.
+ */
+static void *_fileWriter_flusher(void *args){
+    fileWriter_t *fileWriter = (fileWriter_t *)args;
+    fileBuffer_t *buffer;
+    struct timespec deadline;
+    uint64_t expire;
+
+    pthread_mutex_lock(&fileWriter->mutex);
+    for(;;){
+        if(fileWriter->numberOfReady == 0){
+            if(!fileWriter->running){
+                break;
+            }
+
+            if(fileWriter->buffers[fileWriter->filling].length == 0){
+                pthread_cond_wait(&fileWriter->ready, &fileWriter->mutex);
+                continue;
+            }
+
+            expire = fileWriter->firstTime + fileWriter->interval * 1000000ull;
+            if(_fileWriter_now() >= expire){
+                _fileWriter_swap(fileWriter);
+            }else{
+                deadline.tv_sec = expire / 1000000000ull;
+                deadline.tv_nsec = expire % 1000000000ull;
+                pthread_cond_timedwait(&fileWriter->ready, &fileWriter->mutex, &deadline);
+            }
+            continue;
+        }
+
+        //! the oldest full buffer, it is not reused until {@code numberOfReady} decreases.
+        buffer = &fileWriter->buffers[(fileWriter->filling + fileWriter->numberOfBuffers - 
+            fileWriter->numberOfReady) % fileWriter->numberOfBuffers];
+        pthread_mutex_unlock(&fileWriter->mutex);
+
+        _fileWriter_output(fileWriter, buffer->data, buffer->length);
+
+        pthread_mutex_lock(&fileWriter->mutex);
+        buffer->length = 0;
+        fileWriter->numberOfReady--;
+        pthread_cond_broadcast(&fileWriter->done);
     }
-    rename(fileWriter->filePath, oldFileName);
+    pthread_mutex_unlock(&fileWriter->mutex);
+
+    return NULL;
 }
 
 /**
  * @brief   write log string to log file buffer.
  * @param   writer is pointer to file writer.
- * @note    
- * @see     {@code _fileWriter_flush}
+ * @note    the log is only copied, the buffer is handed to the flusher when it is full,
+ *          or the log is at or above {@code flushLevel}.
+ * @see     {@code _fileWriter_flusher}
  */
 void _fileWriter_write(writer_t *writer){
     fileWriter_t *fileWriter;
+    fileBuffer_t *buffer;
     int length;
     int lengthToWrite, freeToWrite;
-    char *ptrBufferEnd;
     char *logString;
     assert(writer != NULL);
     assert(writer->flush != NULL);
     fileWriter = (fileWriter_t *)writer; 
 
-    if(writer->enable == false) return;
+    if(!writerAccepts(writer) || writer->length == 0) goto next;
     
     lengthToWrite = freeToWrite = 0;
     length = writer->length;
-    ptrBufferEnd = fileWriter->fileBuffer + sizeof(fileWriter->fileBuffer);
     logString = writer->buffer;
 
-    //! filter the color info for file writer.
-    if(writer->color){
-        int colorStartLength = sizeof(LOG_COLOR_START) - 1; 
-        logString += colorStartLength;
-        logString += sizeof(LOG_COLOR_INFO) - 1;
-        length -= colorStartLength;
-        length -= sizeof(LOG_COLOR_INFO) - 1; 
-        length -= sizeof(LOG_COLOR_END) - 1;
-    }
+    //! the text carries no color, so it is written as it is.
+    statsAdd(&writer->stats.records, 1);
+    statsAdd(&writer->stats.bytes, length);
 
+    pthread_mutex_lock(&fileWriter->mutex);
     while(length){
-        freeToWrite = ptrBufferEnd - fileWriter->ptrBufferCurrent;
+        buffer = &fileWriter->buffers[fileWriter->filling];
+        if(buffer->length == 0){
+            fileWriter->firstTime = _fileWriter_now();
+            //! the flusher may be waiting without timeout.
+            pthread_cond_signal(&fileWriter->ready);
+        }
+
+        freeToWrite = fileWriter->sizeOfBuffer - buffer->length;
         if(length >= freeToWrite){
             lengthToWrite = freeToWrite; 
         }else{
@@ -132,55 +226,189 @@ void _fileWriter_write(writer_t *writer){
         }
 
         //! write log string to the file buffer.
-        memcpy(fileWriter->ptrBufferCurrent, logString, lengthToWrite);
+        memcpy(buffer->data + buffer->length, logString, lengthToWrite);
         length -= lengthToWrite;
-        fileWriter->ptrBufferCurrent += lengthToWrite;
+        buffer->length += lengthToWrite;
         logString += lengthToWrite;
 
-        assert(fileWriter->ptrBufferCurrent <= ptrBufferEnd);
-        if(ptrBufferEnd == fileWriter->ptrBufferCurrent){
-            //!flush the file.
-            writer->flush(writer);
-            fileWriter->ptrBufferCurrent = fileWriter->fileBuffer;
+        assert(buffer->length <= fileWriter->sizeOfBuffer);
+        if(buffer->length == fileWriter->sizeOfBuffer){
+            _fileWriter_swap(fileWriter);
         }
     }
 
+    //! important logs are not kept in buffer.
+    if(writer->level <= fileWriter->flushLevel && fileWriter->buffers[fileWriter->filling].length > 0){
+        _fileWriter_swap(fileWriter);
+    }
+    pthread_mutex_unlock(&fileWriter->mutex);
+
+next:
     //! call another writer.
     writer_t *nextWriter = writer->next;
     if(nextWriter){
         nextWriter->length = writer->length;
+        nextWriter->color = writer->color;
+        nextWriter->level = writer->level;
+        nextWriter->record = writer->record;
         nextWriter->write(nextWriter);
     }
 }
 
+/**
+ * @brief   write the buffers, or a text, straight to the log file at crash.
+ * @param   writer is pointer to file writer.
+ * @param   text is the text to write, NULL means the logs buffered.
+ * @param   length is the length of {@code text}.
+ * @note    no lock is taken, a buffer being written by the flusher may be written twice.
+ */
+void _fileWriter_emergency(writer_t *writer, const char *text, int32_t length){
+    fileWriter_t *fileWriter = (fileWriter_t *)writer;
+    fileBuffer_t *buffer;
+    uint32_t count, i;
+    int fd;
+
+    fd = fileWriter->fd;
+    if(fd < 0){
+        //! the flusher has not opened the file yet, or is rotating it.
+        fd = open(fileWriter->segment.currentPath, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if(fd < 0){
+            return;
+        }
+        fileWriter->fd = fd;
+    }
+
+    if(text != NULL){
+        writerWriteAll(fd, text, length);
+        return;
+    }
+
+    //! the full buffers the oldest first, and then the one being filled.
+    count = fileWriter->numberOfReady;
+    for(i = 0; i <= count && fileWriter->buffers != NULL; ++i){
+        buffer = &fileWriter->buffers[(fileWriter->filling + fileWriter->numberOfBuffers - count + i) % 
+            fileWriter->numberOfBuffers];
+        writerWriteAll(fd, buffer->data, buffer->length);
+    }
+}
+
 /**
  * @brief   flush a file writer.
  * @param   writer is pointer to file writer. 
- * @note    writes log buffer to specific log file when this method is called.
+ * @note    returns after all the logs buffered are written to log file.
  * @see     
  */
 void _fileWriter_flush(writer_t *writer){
     fileWriter_t *fileWriter;
-    int sizeToWrite;
     assert(writer != NULL);
     fileWriter = (fileWriter_t *)writer; 
-    assert(fileWriter->ptrBufferCurrent > fileWriter->fileBuffer);
 
-    sizeToWrite = fileWriter->ptrBufferCurrent - fileWriter->fileBuffer;
-    if(fileWriter->positionToWrite + sizeToWrite >= fileWriter->sizeOfFile){
-        fileWriter->fileRotate(fileWriter);
+    pthread_mutex_lock(&fileWriter->mutex);
+    if(fileWriter->buffers[fileWriter->filling].length > 0){
+        _fileWriter_swap(fileWriter);
+    }
+    while(fileWriter->numberOfReady > 0){
+        pthread_cond_wait(&fileWriter->done, &fileWriter->mutex);
     }
+    pthread_mutex_unlock(&fileWriter->mutex);
+}
 
-    if(fileWriter->file == NULL){
-        char *path = fileWriter->filePath;
-        fileWriter->file = fopen(path, "w+");
-        assert(fileWriter->file != NULL);
-        fileWriter->positionToWrite = 0;
+/**
+ * @brief   stop the flusher after all the logs buffered are written.
+ * @param   writer is pointer to file writer. 
+ * @note    the log file is kept open, logs output later are written by the caller.
+ */
+void _fileWriter_deInit(writer_t *writer){
+    fileWriter_t *fileWriter;
+    assert(writer != NULL);
+    fileWriter = (fileWriter_t *)writer; 
+
+    pthread_mutex_lock(&fileWriter->mutex);
+    if(!fileWriter->running){
+        pthread_mutex_unlock(&fileWriter->mutex);
+        return;
+    }
+    if(fileWriter->buffers[fileWriter->filling].length > 0){
+        _fileWriter_swap(fileWriter);
     }
+    fileWriter->running = false;
+    pthread_cond_signal(&fileWriter->ready);
+    pthread_mutex_unlock(&fileWriter->mutex);
 
-    fwrite(fileWriter->fileBuffer, sizeToWrite, 1, fileWriter->file);
-    fflush(fileWriter->file);
-    fileWriter->positionToWrite += sizeToWrite;
+    pthread_join(fileWriter->flusher, NULL);
+    segmentDeInit(&fileWriter->segment);
+}
+
+/**
+ * @brief   close the log file and free the buffers of a file writer stopped by deInit.
+ * @param   writer is pointer to file writer.
+ */
+void _fileWriter_release(writer_t *writer){
+    fileWriter_t *fileWriter;
+    assert(writer != NULL);
+    fileWriter = (fileWriter_t *)writer; 
+    assert(!fileWriter->running);
+
+    if(fileWriter->file != NULL){
+        fileWriter->fd = -1;
+        fclose(fileWriter->file);
+        fileWriter->file = NULL;
+    }
+    free(fileWriter->buffers[0].data);
+    free(fileWriter->buffers);
+    fileWriter->buffers = NULL;
+    segmentRelease(&fileWriter->segment);
+
+    pthread_cond_destroy(&fileWriter->ready);
+    pthread_cond_destroy(&fileWriter->done);
+    pthread_mutex_destroy(&fileWriter->mutex);
+}
+
+bool fileWriterSetPolicy(writer_t *writer, int32_t sizeOfBuffer, uint32_t numberOfBuffers, 
+                         uint32_t interval, level_t flushLevel){
+    fileWriter_t *fileWriter;
+    fileBuffer_t *buffers;
+    char *data;
+    assert(writer != NULL);
+    assert(sizeOfBuffer > 0 && numberOfBuffers >= 2);
+    assert(flushLevel < LOG_LEVEL_BUTT);
+    fileWriter = (fileWriter_t *)writer; 
+
+    //! a batch never spans two log files.
+    if(sizeOfBuffer > fileWriter->sizeOfFile){
+        sizeOfBuffer = fileWriter->sizeOfFile;
+    }
+
+    buffers = (fileBuffer_t *)malloc(numberOfBuffers * sizeof(fileBuffer_t));
+    data = (char *)malloc((size_t)numberOfBuffers * sizeOfBuffer);
+    if(buffers == NULL || data == NULL){
+        free(buffers);
+        free(data);
+        return false;
+    }
+    for(uint32_t i = 0; i < numberOfBuffers; ++i){
+        buffers[i].data = data + (size_t)i * sizeOfBuffer;
+        buffers[i].length = 0;
+    }
+
+    if(fileWriter->buffers != NULL){
+        _fileWriter_flush(writer);
+    }
+
+    pthread_mutex_lock(&fileWriter->mutex);
+    if(fileWriter->buffers != NULL){
+        free(fileWriter->buffers[0].data);
+        free(fileWriter->buffers);
+    }
+    fileWriter->buffers = buffers;
+    fileWriter->numberOfBuffers = numberOfBuffers;
+    fileWriter->sizeOfBuffer = sizeOfBuffer;
+    fileWriter->filling = 0;
+    fileWriter->numberOfReady = 0;
+    fileWriter->interval = interval;
+    fileWriter->flushLevel = flushLevel;
+    pthread_mutex_unlock(&fileWriter->mutex);
+    return true;
 }
 
 /**
@@ -196,6 +424,7 @@ void fileWriterInit(writer_t *writer, char *buffer, const char *fileName, const
                       int numberOfFiles, int sizeOfFile){
     fileWriter_t *fileWriter;
     bool appendSuffix;
+    bool ret;
     assert(writer && buffer);
     assert(fileName && directory);
 
@@ -223,28 +452,45 @@ void fileWriterInit(writer_t *writer, char *buffer, const char *fileName, const
 
     //! create a directory if it does not exist.
     if(access(fileWriter->directory, F_OK) < 0){
-        if (mkdir(fileWriter->directory, (S_IRWXU | S_IRWXG | S_IRWXO) < 0)){
+        if (mkdir(fileWriter->directory, S_IRWXU | S_IRWXG | S_IRWXO) < 0){
             fprintf(stderr, "failed to create %s: %s\n", 
                 fileWriter->directory, strerror(errno));
         }
     }
 
-    if(access(fileWriter->filePath, F_OK) == 0){
-        fprintf(stderr, "[warning]: %s exist!!!\n", fileWriter->filePath);
-        remove(fileWriter->filePath);
-    } 
-    
+    //! the logs are written to $(logfile).log.$(sequence), the segments left are kept.
+    segmentInit(&fileWriter->segment, fileWriter->filePath, numberOfFiles, sizeOfFile);
+
     fileWriter->numberOfFiles = numberOfFiles;
     fileWriter->sizeOfFile = sizeOfFile;
-    fileWriter->ptrBufferCurrent = fileWriter->fileBuffer;
     fileWriter->file = NULL;
+    fileWriter->fd = -1;
     fileWriter->positionToWrite = 0;
     fileWriter->fileRotate = _fileWriter_rotate;
 
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);   //! the age of logs is measured in monotonic time.
+    pthread_cond_init(&fileWriter->ready, &attr);
+    pthread_cond_init(&fileWriter->done, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&fileWriter->mutex, NULL);
+
+    ret = fileWriterSetPolicy(writer, SIZE_OF_FILE_BUFFER, COUNT_OF_FILE_BUFFER, 
+        FILE_FLUSH_INTERVAL, FILE_FLUSH_LEVEL);
+    assert(ret);
+
+    fileWriter->running = true;
+    ret = pthread_create(&fileWriter->flusher, NULL, _fileWriter_flusher, fileWriter) == 0;
+    assert(ret);
+
     strcpy(writer->name, "file");
     writer->buffer = buffer;
     writer->write = _fileWriter_write;
     writer->flush = _fileWriter_flush;
+    writer->deInit = _fileWriter_deInit;
+    writer->release = _fileWriter_release;
+    writer->emergency = _fileWriter_emergency;
     writer->next = NULL;
     writer->enable = false;
 }
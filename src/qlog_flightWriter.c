@@ -0,0 +1,325 @@
+/**
+ * @file    qlog_flightWriter.c
+ * @author  qufeiyan
+ * @brief   Define a flight recorder, a writer keeping the latest logs in memory and
+ *          dumping them to a file on demand.
+ * @version 1.0.0
+ * @date    2026/10/19 00:07:52
+ * @version Copyright (c) 2023
+ */
+
+/* Includes --------------------------------------------------------------------------------*/
+#include "qlog_flightWriter.h"
+#include "qlog.h"
+#include "qlog_def.h"
+#include "qlog_deferred.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+//! the most bytes a log takes in the ring.
+#define SIZE_OF_FLIGHT_LOG      (sizeof(struct flightEntry) + SIZE_OF_LOG_TEXT + SIZE_OF_LOG_BUFFER)
+
+/**
+ * @brief   copy current log into the ring, the oldest logs are overwritten to make room.
+ * @param   flightWriter is pointer to flight writer, with the mutex held.
+ * @param   size is the bytes of the entry of current log.
+ */
+static void _flightWriter_push(flightWriter_t *flightWriter, uint32_t size){
+    writer_t *writer = &flightWriter->super;
+    struct flightEntry *entry;
+
+    while((entry = (struct flightEntry *)ringReserve(&flightWriter->ring, size)) == NULL){
+        ringPop(&flightWriter->ring);
+    }
+
+    entry->level = writer->level;
+    if(writer->record){
+        entry->length = 0;
+        entry->sizeOfRecord = sizeof(deferredRecord_t) + writer->record->size;
+        memcpy(entry + 1, writer->record, entry->sizeOfRecord);
+    }else{
+        entry->length = writer->length;
+        entry->sizeOfRecord = 0;
+        memcpy(entry + 1, writer->buffer, writer->length);
+    }
+    ringCommit(&flightWriter->ring, &entry->super);
+}
+
+/**
+ * @brief   append a text to the output of a dump, the output is written when it is full.
+ * @param   flightWriter is pointer to flight writer.
+ * @param   fd is the file dumped to.
+ * @param   length is the length of the output before.
+ * @param   text is the text to append.
+ * @param   size is the size of {@code text}.
+ * @return  the length of the output after.
+ */
+static int32_t _flightWriter_append(flightWriter_t *flightWriter, int fd, int32_t length,
+                                    const char *text, int32_t size){
+    if(length + size > SIZE_OF_FILE_BUFFER){
+        writerWriteAll(fd, flightWriter->output, length);
+        length = 0;
+    }
+    if(size > SIZE_OF_FILE_BUFFER){
+        writerWriteAll(fd, text, size);
+        return length;
+    }
+    memcpy(flightWriter->output + length, text, size);
+    return length + size;
+}
+
+/**
+ * @brief   dump the logs in the ring, the oldest first, and empty the ring.
+ * @param   flightWriter is pointer to flight writer, with the mutex held.
+ * @param   reason is the reason written in the head of the dump.
+ * @return  false if the file can not be opened.
+ */
+static bool _flightWriter_dump(flightWriter_t *flightWriter, const char *reason){
+    writerStats_t *stats = &flightWriter->super.stats;
+    formatter_t *formatter = flightWriter->formatter;
+    struct flightEntry *entry;
+    char text[SIZE_OF_LOG_BUFFER];
+    uint64_t head, start;
+    uint32_t count = 0;
+    int32_t length, size;
+    int fd;
+
+    fd = open(flightWriter->filePath, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if(fd < 0){
+        fprintf(stderr, "failed to open %s: %s\n", flightWriter->filePath, strerror(errno));
+        return false;
+    }
+
+    start = statsNow();
+    head = flightWriter->ring.head;
+    while(ringWalk(&flightWriter->ring, &head, flightWriter->ring.tail) != NULL){
+        count++;
+    }
+    length = snprintf(flightWriter->output, SIZE_OF_FILE_BUFFER,
+        "=== flight recorder dump: %s, %u logs ===\n", reason, count);
+
+    head = flightWriter->ring.head;
+    while((entry = (struct flightEntry *)ringWalk(&flightWriter->ring, &head, flightWriter->ring.tail)) != NULL){
+        //! the records are rendered now, as the text would be when they were output.
+        if(entry->sizeOfRecord){
+            size = formatter->render(formatter, text, entry->level, (const deferredRecord_t *)(entry + 1));
+            length = _flightWriter_append(flightWriter, fd, length, text, size);
+        }else{
+            length = _flightWriter_append(flightWriter, fd, length, (const char *)(entry + 1), entry->length);
+        }
+    }
+    length = _flightWriter_append(flightWriter, fd, length, "=== end of flight recorder dump ===\n",
+        sizeof("=== end of flight recorder dump ===\n") - 1);
+    writerWriteAll(fd, flightWriter->output, length);
+    close(fd);
+
+    ringClear(&flightWriter->ring);
+    __atomic_add_fetch(&flightWriter->dumps, 1, __ATOMIC_RELEASE);
+    statsAdd(&stats->flushes, 1);
+    histogramRecord(&stats->flushLatency, statsNow() - start);
+    return true;
+}
+
+/**
+ * @brief   the dumper, dumps the ring each time it is requested until it is stopped.
+ * @param   args is pointer to flight writer.
+ */
+static void *_flightWriter_dumper(void *args){
+    flightWriter_t *flightWriter = (flightWriter_t *)args;
+
+    for(;;){
+        while(sem_wait(&flightWriter->request) < 0 && errno == EINTR);
+        if(!__atomic_load_n(&flightWriter->running, __ATOMIC_ACQUIRE)){
+            break;
+        }
+        pthread_mutex_lock(&flightWriter->mutex);
+        _flightWriter_dump(flightWriter, __atomic_load_n(&flightWriter->reason, __ATOMIC_ACQUIRE));
+        pthread_mutex_unlock(&flightWriter->mutex);
+    }
+    return NULL;
+}
+
+/**
+ * @brief   record a log in the ring, its raw arguments are kept if they are captured.
+ * @param   writer is pointer to flight writer.
+ * @note    a log at or above {@code FLIGHT_DUMP_LEVEL} dumps the ring at once.
+ */
+void _flightWriter_write(writer_t *writer){
+    flightWriter_t *flightWriter;
+    uint32_t size;
+    assert(writer != NULL);
+    flightWriter = (flightWriter_t *)writer;
+
+    if(!writerAccepts(writer) || (writer->length == 0 && writer->record == NULL)) goto next;
+
+    size = sizeof(struct flightEntry) + (writer->record ? sizeof(deferredRecord_t) + writer->record->size : writer->length);
+    size = MEMORY_ALIGN_UP(size, RING_ALIGN);
+
+    pthread_mutex_lock(&flightWriter->mutex);
+    _flightWriter_push(flightWriter, size);
+    if(writer->level <= FLIGHT_DUMP_LEVEL){
+        _flightWriter_dump(flightWriter, "fatal log");
+    }
+    pthread_mutex_unlock(&flightWriter->mutex);
+    statsAdd(&writer->stats.records, 1);
+    statsAdd(&writer->stats.bytes, size);
+
+next:
+    //! call another writer.
+    writer_t *nextWriter = writer->next;
+    if(nextWriter){
+        nextWriter->length = writer->length;
+        nextWriter->color = writer->color;
+        nextWriter->level = writer->level;
+        nextWriter->record = writer->record;
+        nextWriter->write(nextWriter);
+    }
+}
+
+/**
+ * @brief   let the dumper dump the ring at crash, or append a text to the file dumped to.
+ * @param   writer is pointer to flight writer.
+ * @param   text is the text to append, NULL means the logs in the ring.
+ * @param   length is the length of {@code text}.
+ * @note    rendering is not async-signal-safe, so the dumper renders the ring while the
+ *          crashed thread waits for it, at most {@code FLIGHT_CRASH_WAIT} ms, as the mutex
+ *          may be held by the crashed thread.
+ */
+void _flightWriter_emergency(writer_t *writer, const char *text, int32_t length){
+    flightWriter_t *flightWriter = (flightWriter_t *)writer;
+    struct timespec interval = { 0, 1000000 };
+    uint32_t dumps;
+    int fd;
+
+    if(text != NULL){
+        fd = open(flightWriter->filePath, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if(fd >= 0){
+            writerWriteAll(fd, text, length);
+            close(fd);
+        }
+        return;
+    }
+
+    if(!__atomic_load_n(&flightWriter->running, __ATOMIC_ACQUIRE) || ringEmpty(&flightWriter->ring)){
+        return;
+    }
+    dumps = __atomic_load_n(&flightWriter->dumps, __ATOMIC_ACQUIRE);
+    flightWriterRequest(writer, "crash");
+    for(int i = 0; i < FLIGHT_CRASH_WAIT && __atomic_load_n(&flightWriter->dumps, __ATOMIC_ACQUIRE) == dumps; ++i){
+        nanosleep(&interval, NULL);
+    }
+}
+
+/**
+ * @brief   stop the dumper, the logs in the ring are kept until released.
+ * @param   writer is pointer to flight writer.
+ */
+void _flightWriter_deInit(writer_t *writer){
+    flightWriter_t *flightWriter;
+    assert(writer != NULL);
+    flightWriter = (flightWriter_t *)writer;
+
+    if(!flightWriter->running){
+        return;
+    }
+    __atomic_store_n(&flightWriter->running, false, __ATOMIC_RELEASE);
+    sem_post(&flightWriter->request);
+    pthread_join(flightWriter->dumper, NULL);
+}
+
+/**
+ * @brief   free the ring of a flight writer stopped by deInit.
+ * @param   writer is pointer to flight writer.
+ */
+void _flightWriter_release(writer_t *writer){
+    flightWriter_t *flightWriter;
+    assert(writer != NULL);
+    flightWriter = (flightWriter_t *)writer;
+    assert(!flightWriter->running);
+
+    ringRelease(&flightWriter->ring);
+    free(flightWriter->output);
+    flightWriter->output = NULL;
+    sem_destroy(&flightWriter->request);
+    pthread_mutex_destroy(&flightWriter->mutex);
+}
+
+bool flightWriterDump(writer_t *writer, const char *reason){
+    flightWriter_t *flightWriter;
+    bool ret;
+    assert(writer != NULL && reason != NULL);
+    flightWriter = (flightWriter_t *)writer;
+
+    pthread_mutex_lock(&flightWriter->mutex);
+    ret = _flightWriter_dump(flightWriter, reason);
+    pthread_mutex_unlock(&flightWriter->mutex);
+    return ret;
+}
+
+void flightWriterRequest(writer_t *writer, const char *reason){
+    flightWriter_t *flightWriter = (flightWriter_t *)writer;
+
+    __atomic_store_n(&flightWriter->reason, reason, __ATOMIC_RELEASE);
+    sem_post(&flightWriter->request);
+}
+
+bool flightWriterInit(writer_t *writer, char *buffer, formatter_t *formatter, const char *fileName,
+                      const char *directory, uint32_t size){
+    flightWriter_t *flightWriter;
+    size_t length;
+    int ret;
+    assert(writer && buffer && formatter);
+    assert(fileName && directory);
+
+    flightWriter = (flightWriter_t *)writer;
+    memset(flightWriter, 0, sizeof(*flightWriter));
+
+    flightWriter->output = (char *)malloc(SIZE_OF_FILE_BUFFER);
+    if(flightWriter->output == NULL || !ringInit(&flightWriter->ring, size, SIZE_OF_FLIGHT_LOG)){
+        ringRelease(&flightWriter->ring);
+        free(flightWriter->output);
+        return false;
+    }
+    flightWriter->formatter = formatter;
+
+    length = strlen(fileName);
+    //! append suffix for the file dumped to.
+    snprintf(flightWriter->filePath, sizeof(flightWriter->filePath), "%s/%s%s", directory, fileName,
+        (length >= 7 && strcmp(fileName + length - 7, ".flight") == 0) ? "" : ".flight");
+
+    //! create a directory if it does not exist.
+    if(access(directory, F_OK) < 0){
+        if(mkdir(directory, S_IRWXU | S_IRWXG | S_IRWXO) < 0){
+            fprintf(stderr, "failed to create %s: %s\n", directory, strerror(errno));
+        }
+    }
+
+    pthread_mutex_init(&flightWriter->mutex, NULL);
+    sem_init(&flightWriter->request, 0, 0);
+    flightWriter->running = true;
+    ret = pthread_create(&flightWriter->dumper, NULL, _flightWriter_dumper, flightWriter);
+    assert(ret == 0);
+    (void)ret;
+
+    strcpy(writer->name, "flight");
+    writer->buffer = buffer;
+    writer->binary = true;          //! the raw arguments are kept, the text is rendered at dump.
+    writer->write = _flightWriter_write;
+    writer->deInit = _flightWriter_deInit;
+    writer->release = _flightWriter_release;
+    writer->emergency = _flightWriter_emergency;
+    writer->next = NULL;
+    writer->enable = false;
+    return true;
+}
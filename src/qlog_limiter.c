@@ -0,0 +1,346 @@
+/**
+ * @file    qlog_limiter.c
+ * @author  qufeiyan
+ * @brief   Rate limits per tag and per callsite, and suppression of repeated logs.
+ * @version 1.0.0
+ * @date    2026/10/18 22:40:16
+ * @version Copyright (c) 2023
+ */
+
+/* Includes --------------------------------------------------------------------------------*/
+#include "qlog_limiter.h"
+#include "qlog.h"
+#include "qlog_deferred.h"
+#include "qlog_stats.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LIMIT_TAG           "qlog"  //! tag of the reports not bound to a tag.
+#define LIMIT_PROBE         (8)     //! entries probed for a callsite, beyond which it is not limited.
+
+//! the raw arguments of current log, hashed to find its repeats.
+static __thread char repeatBuffer[SIZE_OF_LOG_BUFFER] __attribute__((aligned(MEMORY_ALIGN)));
+
+/**
+ * @brief   hash a log by its callsite and its raw arguments, before it is formatted.
+ * @param   key is the callsite, or its format string if it has no descriptor.
+ * @return  the hash, 0 if the arguments can not be captured.
+ */
+static uint64_t _limiter_hashLog(const void *key, const char *tag, const char *format, va_list args){
+    deferredRecord_t *record = (deferredRecord_t *)repeatBuffer;
+    uint64_t hash = 14695981039346656037ull;
+    const uint8_t *p;
+    int32_t size;
+    va_list copy;
+
+    va_copy(copy, args);
+    size = deferredCapture(record, sizeof(repeatBuffer), tag, format, copy);
+    va_end(copy);
+    if(size < 0){
+        return 0;
+    }
+
+    //! the data is the tag followed by the raw arguments.
+    for(p = (const uint8_t *)&key; p < (const uint8_t *)&key + sizeof(key); ++p){
+        hash = (hash ^ *p) * 1099511628211ull;
+    }
+    for(p = (const uint8_t *)record->data; p < (const uint8_t *)record->data + record->size; ++p){
+        hash = (hash ^ *p) * 1099511628211ull;
+    }
+    return hash ? hash : 1;
+}
+
+/**
+ * @brief   output a report through the logger, it is not filtered or limited.
+ */
+static void _limiter_log(logger_t *logger, const char *tag, level_t level, const char *format, ...){
+    va_list args;
+
+    va_start(args, format);
+    logger->run(logger, NULL, tag, level, format, args);
+    va_end(args);
+}
+
+/**
+ * @brief   take a log from a bucket.
+ * @param   bucket is the bucket.
+ * @param   interval is the ns per log.
+ * @param   tolerance is the ns of the burst beyond the first log.
+ * @param   now is the monotonic time in ns.
+ * @param   suppressed is where the logs suppressed and not reported yet are returned.
+ * @return  false if the log is suppressed.
+ * @note    lock-free.
+ */
+static bool _limiter_take(struct limitBucket *bucket, uint64_t interval, uint64_t tolerance,
+                          uint64_t now, uint64_t *suppressed){
+    uint64_t due = __atomic_load_n(&bucket->due, __ATOMIC_RELAXED), next;
+
+    do{
+        if(due > now + tolerance){
+            __atomic_fetch_add(&bucket->suppressed, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        next = (due > now ? due : now) + interval;
+    }while(!__atomic_compare_exchange_n(&bucket->due, &due, next, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    *suppressed = 0;
+    if(__atomic_load_n(&bucket->suppressed, __ATOMIC_RELAXED)){
+        *suppressed = __atomic_exchange_n(&bucket->suppressed, 0, __ATOMIC_RELAXED);
+    }
+    return true;
+}
+
+/**
+ * @brief   find the entry of a tag, or the empty entry where it should be added.
+ * @return  the entry, NULL if the table is full.
+ * @note    lock-free.
+ */
+static struct limitTag *_limiter_probe(limiter_t *limiter, const char *tag, uint32_t hash){
+    struct limitTag *entry;
+    uint32_t index, current;
+
+    for(uint32_t probe = 0; probe < COUNT_OF_LIMIT_TAG; ++probe){
+        index = (hash + probe) & (COUNT_OF_LIMIT_TAG - 1);
+        entry = &limiter->tags[index];
+        current = __atomic_load_n(&entry->hash, __ATOMIC_ACQUIRE);
+        if(current == 0 || (current == hash && strncmp(entry->tag, tag, SIZE_OF_NAME) == 0)){
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief   find the bucket of a callsite, it is claimed at the first time.
+ * @param   site is the callsite, NULL if it has no descriptor.
+ * @param   format is the format string, which identifies a callsite without descriptor.
+ * @return  the entry, NULL if there is no room left for the callsite.
+ * @note    lock-free.
+ */
+static struct limitSite *_limiter_site(limiter_t *limiter, const qlog_site_t *site, const char *format){
+    struct limitSite *entry;
+    const void *key = site ? (const void *)site : (const void *)format, *current;
+    uint32_t hash = (uint32_t)(((uintptr_t)key * 0x9E3779B97F4A7C15ull) >> 32);
+
+    for(uint32_t probe = 0; probe < LIMIT_PROBE; ++probe){
+        entry = &limiter->sites[(hash + probe) & (COUNT_OF_LIMIT_SITE - 1)];
+        current = __atomic_load_n(&entry->key, __ATOMIC_RELAXED);
+        if(current == NULL && __atomic_compare_exchange_n(&entry->key, &current, key,
+            false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+            __atomic_store_n(&entry->site, site, __ATOMIC_RELAXED);
+            __atomic_store_n(&entry->format, format, __ATOMIC_RELEASE);
+            return entry;
+        }
+        if(current == key){
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief   output the repeats of the last log.
+ * @param   last is a copy of the last log.
+ */
+static void _limiter_repeated(logger_t *logger, const struct limitRepeat *last){
+    if(last->count){
+        _limiter_log(logger, last->tag, last->level, "last message repeated %" PRIu64 " times\n", last->count);
+    }
+}
+
+/**
+ * @brief   check whether a log is output.
+ * @param   limiter is pointer to limiter.
+ * @param   logger is the logger the reports are output through.
+ * @param   site is the callsite of the log, NULL means it is identified by its format string.
+ * @param   tag is tag of the log.
+ * @param   level is level of the log.
+ * @param   format is the format string of the log.
+ * @param   args is a list of variable parameters, it is not consumed.
+ * @return  false if the log is suppressed.
+ * @note    the buckets are lock-free, only the check of repeats takes the mutex.
+ */
+static bool _limiter_invoke(limiter_t *limiter, logger_t *logger, const qlog_site_t *site, const char *tag,
+                            level_t level, const char *format, va_list args){
+    struct limitTag *entry;
+    struct limitSite *bucket;
+    struct limitRepeat last;
+    uint64_t now, interval, suppressed, hash;
+    uint32_t tagHash;
+
+    now = statsNow();
+    if(__atomic_load_n(&limiter->numberOfTags, __ATOMIC_RELAXED) && tag != NULL){
+        tagHash = loggerHashTag(tag);
+        entry = _limiter_probe(limiter, tag, tagHash);
+        if(entry != NULL && __atomic_load_n(&entry->hash, __ATOMIC_ACQUIRE) == tagHash &&
+            (interval = __atomic_load_n(&entry->interval, __ATOMIC_RELAXED)) != 0){
+            if(!_limiter_take(&entry->bucket, interval, __atomic_load_n(&entry->tolerance, __ATOMIC_RELAXED),
+                now, &suppressed)){
+                return false;
+            }
+            if(suppressed){
+                _limiter_log(logger, tag, level, "%" PRIu64 " logs of tag %s suppressed by rate limit\n",
+                    suppressed, tag);
+            }
+        }
+    }
+
+    interval = __atomic_load_n(&limiter->siteInterval, __ATOMIC_RELAXED);
+    if(interval && (bucket = _limiter_site(limiter, site, format)) != NULL){
+        if(!_limiter_take(&bucket->bucket, interval, __atomic_load_n(&limiter->siteTolerance, __ATOMIC_RELAXED),
+            now, &suppressed)){
+            return false;
+        }
+        if(suppressed){
+            _limiter_log(logger, tag, level, "%" PRIu64 " logs of the next callsite suppressed by rate limit\n",
+                suppressed);
+        }
+    }
+
+    if(!__atomic_load_n(&limiter->repeat, __ATOMIC_RELAXED)){
+        return true;
+    }
+
+    hash = tag ? _limiter_hashLog(site ? (const void *)site : (const void *)format, tag, format, args) : 0;
+    pthread_mutex_lock(&limiter->mutex);
+    if(hash != 0 && hash == limiter->last.hash){
+        if(limiter->last.count++ == 0){
+            limiter->last.since = now;
+        }
+        //! a log repeating for long is reported without waiting for another log.
+        if(now - limiter->last.since < LIMIT_REPEAT_INTERVAL * 1000000000ull){
+            pthread_mutex_unlock(&limiter->mutex);
+            return false;
+        }
+        last = limiter->last;
+        limiter->last.count = 0;
+        pthread_mutex_unlock(&limiter->mutex);
+
+        _limiter_repeated(logger, &last);
+        return false;
+    }
+    last = limiter->last;
+    limiter->last.hash = hash;
+    limiter->last.count = 0;
+    limiter->last.level = level;
+    snprintf(limiter->last.tag, sizeof(limiter->last.tag), "%s", tag ? tag : "");
+    pthread_mutex_unlock(&limiter->mutex);
+
+    _limiter_repeated(logger, &last);
+    return true;
+}
+
+/**
+ * @brief   output the counts of logs suppressed and not reported yet.
+ * @param   limiter is pointer to limiter.
+ * @param   logger is the logger the reports are output through.
+ */
+static void _limiter_report(limiter_t *limiter, logger_t *logger){
+    struct limitRepeat last;
+    uint64_t suppressed;
+
+    pthread_mutex_lock(&limiter->mutex);
+    last = limiter->last;
+    limiter->last.count = 0;
+    pthread_mutex_unlock(&limiter->mutex);
+    _limiter_repeated(logger, &last);
+
+    for(int i = 0; i < COUNT_OF_LIMIT_TAG; ++i){
+        struct limitTag *entry = &limiter->tags[i];
+
+        if(__atomic_load_n(&entry->hash, __ATOMIC_ACQUIRE) == 0 ||
+            __atomic_load_n(&entry->bucket.suppressed, __ATOMIC_RELAXED) == 0){
+            continue;
+        }
+        suppressed = __atomic_exchange_n(&entry->bucket.suppressed, 0, __ATOMIC_RELAXED);
+        _limiter_log(logger, entry->tag, LOG_LEVEL_WARNING, "%" PRIu64 " logs of tag %s suppressed by rate limit\n",
+            suppressed, entry->tag);
+    }
+
+    for(int i = 0; i < COUNT_OF_LIMIT_SITE; ++i){
+        struct limitSite *bucket = &limiter->sites[i];
+        const char *format = __atomic_load_n(&bucket->format, __ATOMIC_ACQUIRE);
+        const qlog_site_t *site = __atomic_load_n(&bucket->site, __ATOMIC_RELAXED);
+
+        //! a bucket just claimed is reported the next time.
+        if(format == NULL || __atomic_load_n(&bucket->bucket.suppressed, __ATOMIC_RELAXED) == 0){
+            continue;
+        }
+        suppressed = __atomic_exchange_n(&bucket->bucket.suppressed, 0, __ATOMIC_RELAXED);
+        if(site != NULL){
+            _limiter_log(logger, LIMIT_TAG, LOG_LEVEL_WARNING, "%" PRIu64 " logs of callsite %s:%u suppressed by rate limit\n",
+                suppressed, site->file, site->line);
+        }else{
+            _limiter_log(logger, LIMIT_TAG, LOG_LEVEL_WARNING, "%" PRIu64 " logs of callsite \"%.*s\" suppressed by rate limit\n",
+                suppressed, (int)strcspn(format, "\n"), format);
+        }
+    }
+}
+
+bool limiterSetTag(limiter_t *limiter, const char *tag, uint32_t rate, uint32_t burst){
+    struct limitTag *entry;
+    uint32_t hash;
+    bool ret = true;
+    assert(limiter != NULL && tag != NULL);
+
+    hash = loggerHashTag(tag);
+    pthread_mutex_lock(&limiter->mutex);
+    entry = _limiter_probe(limiter, tag, hash);
+    if(entry != NULL && entry->hash == 0 && limiter->numberOfTags >= COUNT_OF_LIMIT_TAG / 2){
+        entry = NULL;
+    }
+    if(entry == NULL){
+        ret = false;
+    }else{
+        burst = burst ? burst : 1;
+        __atomic_store_n(&entry->interval, rate ? 1000000000ull / rate : 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&entry->tolerance, rate ? (1000000000ull / rate) * (burst - 1) : 0, __ATOMIC_RELAXED);
+        if(entry->hash == 0){
+            snprintf(entry->tag, sizeof(entry->tag), "%s", tag);
+            __atomic_store_n(&entry->hash, hash, __ATOMIC_RELEASE);
+            __atomic_store_n(&limiter->numberOfTags, limiter->numberOfTags + 1, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&limiter->mutex);
+    return ret;
+}
+
+void limiterSetSite(limiter_t *limiter, uint32_t rate, uint32_t burst){
+    assert(limiter != NULL);
+
+    burst = burst ? burst : 1;
+    __atomic_store_n(&limiter->siteTolerance, rate ? (1000000000ull / rate) * (burst - 1) : 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&limiter->siteInterval, rate ? 1000000000ull / rate : 0, __ATOMIC_RELAXED);
+}
+
+void limiterSetRepeat(limiter_t *limiter, logger_t *logger, bool enable){
+    struct limitRepeat last;
+    assert(limiter != NULL && logger != NULL);
+
+    pthread_mutex_lock(&limiter->mutex);
+    last = limiter->last;
+    memset(&limiter->last, 0, sizeof(limiter->last));
+    __atomic_store_n(&limiter->repeat, enable, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&limiter->mutex);
+
+    _limiter_repeated(logger, &last);
+}
+
+void limiterInit(limiter_t *limiter){
+    assert(limiter != NULL);
+
+    memset(limiter, 0, sizeof(*limiter));
+    pthread_mutex_init(&limiter->mutex, NULL);
+    limiter->invoke = _limiter_invoke;
+    limiter->report = _limiter_report;
+}
+
+void limiterDeInit(limiter_t *limiter){
+    assert(limiter != NULL);
+
+    pthread_mutex_destroy(&limiter->mutex);
+}
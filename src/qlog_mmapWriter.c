@@ -0,0 +1,272 @@
+/**
+ * @file    qlog_mmapWriter.c
+ * @author  qufeiyan
+ * @brief   Define a memory-mapped file writer for qlog.
+ * @version 1.0.0
+ * @date    2026/10/18 16:10:27
+ * @version Copyright (c) 2023
+ */
+
+/* Includes --------------------------------------------------------------------------------*/
+#define _GNU_SOURCE     //! fallocate
+#include "qlog_mmapWriter.h"
+#include "qlog.h"
+#include "qlog_def.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief   open current log file, preallocate and map it, logs are appended to its content.
+ * @param   mmapWriter is pointer to mmap writer.
+ * @return  false if the file can not be opened or mapped.
+ */
+static bool _mmapWriter_open(mmapWriter_t *mmapWriter){
+    struct stat st;
+    int fd;
+    char *mapping;
+
+    fd = open(mmapWriter->segment.currentPath, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(fd < 0){
+        return false;
+    }
+    if(fstat(fd, &st) < 0){
+        close(fd);
+        return false;
+    }
+
+    //! reserve the blocks, so storing to the mapping never meets a full disk with SIGBUS.
+    if(fallocate(fd, 0, 0, mmapWriter->sizeOfFile) < 0){
+        if(errno != EOPNOTSUPP || ftruncate(fd, mmapWriter->sizeOfFile) < 0){
+            close(fd);
+            return false;
+        }
+    }
+
+    mapping = (char *)mmap(NULL, mmapWriter->sizeOfFile, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(mapping == MAP_FAILED){
+        close(fd);
+        return false;
+    }
+
+    mmapWriter->fd = fd;
+    mmapWriter->mapping = mapping;
+    mmapWriter->positionToWrite = st.st_size;
+    return true;
+}
+
+/**
+ * @brief   unmap current log file and truncate it to the logs written.
+ * @param   mmapWriter is pointer to mmap writer.
+ */
+static void _mmapWriter_close(mmapWriter_t *mmapWriter){
+    if(mmapWriter->fd < 0){
+        return;
+    }
+
+    munmap(mmapWriter->mapping, mmapWriter->sizeOfFile);
+    if(ftruncate(mmapWriter->fd, mmapWriter->positionToWrite) < 0){
+        fprintf(stderr, "failed to truncate %s: %s\n", mmapWriter->segment.currentPath, strerror(errno));
+    }
+    close(mmapWriter->fd);
+
+    mmapWriter->fd = -1;
+    mmapWriter->mapping = NULL;
+    mmapWriter->positionToWrite = 0;
+}
+
+/**
+ * @brief   close current log file and move to the next segment.
+ * @param   mmapWriter is pointer to mmap writer.
+ * @note    nothing is renamed, old segments are deleted by the reaper of segment.
+ * @see     {@code segmentRotate}
+ */
+void _mmapWriter_rotate(mmapWriter_t *mmapWriter){
+    uint64_t size;
+    assert(mmapWriter != NULL);
+
+    size = mmapWriter->positionToWrite;
+    _mmapWriter_close(mmapWriter);
+    segmentRotate(&mmapWriter->segment, size);
+}
+
+/**
+ * @brief   copy log string to the mapping of log file.
+ * @param   writer is pointer to mmap writer.
+ * @note    no syscall is made unless the file is full.
+ */
+void _mmapWriter_write(writer_t *writer){
+    mmapWriter_t *mmapWriter;
+    int length;
+    char *logString;
+    assert(writer != NULL);
+    mmapWriter = (mmapWriter_t *)writer;
+
+    if(!writerAccepts(writer) || writer->length == 0) goto next;
+
+    length = writer->length;
+    logString = writer->buffer;
+
+    //! the text carries no color, so it is written as it is.
+
+    //! a log larger than a file never fits, rotating for it would only evict old files.
+    if(length > mmapWriter->sizeOfFile){
+        statsAdd(&writer->stats.dropped, 1);
+        goto next;
+    }
+
+    //! the file may be reopened with its content after {@code _mmapWriter_deInit}.
+    for(int i = 0; mmapWriter->fd < 0 || mmapWriter->positionToWrite + length > mmapWriter->sizeOfFile ||
+        (mmapWriter->positionToWrite > 0 && segmentExpired(&mmapWriter->segment, time(NULL))); ++i){
+        if(mmapWriter->fd >= 0){
+            mmapWriter->fileRotate(mmapWriter);
+        }
+        if(i == 2 || !_mmapWriter_open(mmapWriter)){
+            fprintf(stderr, "failed to map %s: %s\n", mmapWriter->segment.currentPath, strerror(errno));
+            statsAdd(&writer->stats.dropped, 1);
+            goto next;
+        }
+    }
+
+    memcpy(mmapWriter->mapping + mmapWriter->positionToWrite, logString, length);
+    mmapWriter->positionToWrite += length;
+    statsAdd(&writer->stats.records, 1);
+    statsAdd(&writer->stats.bytes, length);
+
+next:
+    //! call another writer.
+    writer_t *nextWriter = writer->next;
+    if(nextWriter){
+        nextWriter->length = writer->length;
+        nextWriter->color = writer->color;
+        nextWriter->level = writer->level;
+        nextWriter->record = writer->record;
+        nextWriter->write(nextWriter);
+    }
+}
+
+/**
+ * @brief   flush a mmap writer.
+ * @param   writer is pointer to mmap writer.
+ * @note    the logs are already in the page cache, only the write back is started.
+ */
+void _mmapWriter_flush(writer_t *writer){
+    mmapWriter_t *mmapWriter;
+    uint64_t start;
+    assert(writer != NULL);
+    mmapWriter = (mmapWriter_t *)writer;
+
+    if(mmapWriter->fd >= 0){
+        start = statsNow();
+        msync(mmapWriter->mapping, mmapWriter->sizeOfFile, MS_ASYNC);
+        statsAdd(&writer->stats.flushes, 1);
+        histogramRecord(&writer->stats.flushLatency, statsNow() - start);
+    }
+}
+
+/**
+ * @brief   copy a text to the mapping at crash, the logs written are already in the page cache.
+ * @param   writer is pointer to mmap writer.
+ * @param   text is the text to write, NULL means the logs kept, which are none.
+ * @param   length is the length of {@code text}.
+ * @note    the text is dropped if the file is full, as it is not rotated at crash.
+ */
+void _mmapWriter_emergency(writer_t *writer, const char *text, int32_t length){
+    mmapWriter_t *mmapWriter = (mmapWriter_t *)writer;
+
+    if(text == NULL || mmapWriter->fd < 0 || mmapWriter->positionToWrite + length > mmapWriter->sizeOfFile){
+        return;
+    }
+    memcpy(mmapWriter->mapping + mmapWriter->positionToWrite, text, length);
+    mmapWriter->positionToWrite += length;
+}
+
+/**
+ * @brief   close current log file, it is truncated to the logs written.
+ * @param   writer is pointer to mmap writer.
+ * @note    logs output later are appended to the file again.
+ */
+void _mmapWriter_deInit(writer_t *writer){
+    mmapWriter_t *mmapWriter;
+    assert(writer != NULL);
+    mmapWriter = (mmapWriter_t *)writer;
+
+    _mmapWriter_close(mmapWriter);
+    segmentDeInit(&mmapWriter->segment);
+}
+
+/**
+ * @brief   free the segments of a mmap writer stopped by deInit.
+ * @param   writer is pointer to mmap writer.
+ */
+void _mmapWriter_release(writer_t *writer){
+    mmapWriter_t *mmapWriter;
+    assert(writer != NULL);
+    mmapWriter = (mmapWriter_t *)writer;
+
+    _mmapWriter_close(mmapWriter);
+    segmentRelease(&mmapWriter->segment);
+}
+
+/**
+ * @brief   initialise a mmap writer.
+ * @param   writer is pointer to mmap writer.
+ * @param   buffer is pointer to log string.
+ * @param   fileName is the name of log file.
+ * @param   directory is the directory of log file.
+ * @param   numberOfFiles is the number of log files.
+ * @param   sizeOfFile is the size of a single log file, it is preallocated.
+ */
+void mmapWriterInit(writer_t *writer, char *buffer, const char *fileName, const char *directory,
+                    int numberOfFiles, int sizeOfFile){
+    mmapWriter_t *mmapWriter;
+    int length;
+    assert(writer && buffer);
+    assert(fileName && directory);
+    assert(numberOfFiles > 0 && sizeOfFile >= SIZE_OF_LOG_TEXT);
+
+    mmapWriter = (mmapWriter_t *)writer;
+    memset(mmapWriter, 0, sizeof(*mmapWriter));
+
+    strcpy(mmapWriter->directory, directory);
+    length = strlen(fileName);
+    //! append suffix for log file.
+    snprintf(mmapWriter->filePath, sizeof(mmapWriter->filePath), "%s/%s%s", directory, fileName,
+        (length >= 4 && strcmp(fileName + length - 4, ".log") == 0) ? "" : ".log");
+
+    //! create a directory if it does not exist.
+    if(access(mmapWriter->directory, F_OK) < 0){
+        if(mkdir(mmapWriter->directory, S_IRWXU | S_IRWXG | S_IRWXO) < 0){
+            fprintf(stderr, "failed to create %s: %s\n",
+                mmapWriter->directory, strerror(errno));
+        }
+    }
+
+    //! the logs are written to $(logfile).log.$(sequence), the segments left are kept.
+    segmentInit(&mmapWriter->segment, mmapWriter->filePath, numberOfFiles, sizeOfFile);
+
+    mmapWriter->numberOfFiles = numberOfFiles;
+    mmapWriter->sizeOfFile = sizeOfFile;
+    mmapWriter->fd = -1;
+    mmapWriter->mapping = NULL;
+    mmapWriter->positionToWrite = 0;
+    mmapWriter->fileRotate = _mmapWriter_rotate;
+
+    strcpy(writer->name, "mmap");
+    writer->buffer = buffer;
+    writer->write = _mmapWriter_write;
+    writer->flush = _mmapWriter_flush;
+    writer->deInit = _mmapWriter_deInit;
+    writer->release = _mmapWriter_release;
+    writer->emergency = _mmapWriter_emergency;
+    writer->next = NULL;
+    writer->enable = false;
+}
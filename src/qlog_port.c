@@ -13,26 +13,133 @@
 #include "qlog_api.h"
 #include "qlog_def.h"
 #include <bits/pthreadtypes.h>
+#include <errno.h>
 #include <stdio.h>
 #include <pthread.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <stdlib.h>
+
+/**
+ * @brief write the segments to stdout by writev, the partial writes are continued.
+ */
+static void _console_writev(const struct iovec *segments, int count){
+    struct iovec rest[count];
+    ssize_t written;
+    int i;
+
+    memcpy(rest, segments, count * sizeof(struct iovec));
+    for(i = 0; i < count;){
+        written = writev(STDOUT_FILENO, rest + i, count - i);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return;
+        }
+        //! skip the segments written, and the part of the segment written partially.
+        while(i < count && (size_t)written >= rest[i].iov_len){
+            written -= rest[i].iov_len;
+            i++;
+        }
+        if(i < count){
+            rest[i].iov_base = (char *)rest[i].iov_base + written;
+            rest[i].iov_len -= written;
+        }
+    }
+}
+
+//! defined by the ports written before {@code console_write} only.
+extern void console_puts(const char *str) __weak;
+
+/**
+ * @brief join the segments of a log and hand them to console_puts of the port.
+ */
+static void _console_puts(const struct iovec *segments, int count){
+    char text[SIZE_OF_LOG_BUFFER];
+    size_t length = 0, offset, piece;
+
+    for(int i = 0; i < count; ++i){
+        for(offset = 0; offset < segments[i].iov_len; offset += piece){
+            if(length == sizeof(text) - 1){
+                text[length] = '\0';
+                console_puts(text);
+                length = 0;
+            }
+            piece = segments[i].iov_len - offset;
+            piece = piece < sizeof(text) - 1 - length ? piece : sizeof(text) - 1 - length;
+            memcpy(text + length, (const char *)segments[i].iov_base + offset, piece);
+            length += piece;
+        }
+    }
+    text[length] = '\0';
+    console_puts(text);
+}
 
 /**
  * @brief Default output function.
- * @note If user do not overload it, fputs in libc will be the default method. 
- *       And fputs is thread-safed. 
- * @param fmt
+ * @note If user do not overload it, the segments are written to a terminal by writev at 
+ *       once, without being joined. Otherwise they are buffered by stdio, as a pipe or a 
+ *       file takes a write per log much slower than a copy. If the port defines 
+ *       console_puts instead, the segments are joined and handed to it.
+ * @param segments
+ * @param count
+ */
+__weak void console_write(const struct iovec *segments, int count){
+    static int terminal = -1;
+    int isTerminal = __atomic_load_n(&terminal, __ATOMIC_RELAXED);
+
+    if(console_puts != NULL){
+        _console_puts(segments, count);
+        return;
+    }
+
+    if(isTerminal < 0){
+        isTerminal = isatty(STDOUT_FILENO);
+        __atomic_store_n(&terminal, isTerminal, __ATOMIC_RELAXED);
+    }
+
+    if(isTerminal){
+        fflush(stdout);     //! keep the order with the output of stdio.
+        _console_writev(segments, count);
+        return;
+    }
+
+    flockfile(stdout);
+    for(int i = 0; i < count; ++i){
+        fwrite_unlocked(segments[i].iov_base, 1, segments[i].iov_len, stdout);
+    }
+    funlockfile(stdout);
+}
+
+/**
+ * @brief Default cpu counter, the time stamp counter on x86_64 and the virtual counter on aarch64.
+ * @note  It must be constant rate, otherwise overload it to return 0.
  */
-__weak void console_puts(const char *str){
-    fputs(str, stdout);
+__weak uint64_t tsc_read(void){
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t low, high;
+    __asm__ volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+#elif defined(__aarch64__)
+    uint64_t value;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return 0;
+#endif
 }
 
 /**
  * @brief By default, pthread mutex API is used for thread safety.
- * @note  
+ * @note  each call creates a new mutex, which is destroyed by {@code locker_deinit}.
  */
 __weak void *locker_init(void *args){
-    static pthread_mutex_t mid;
-    pthread_mutex_t *_locker = &mid;
+    pthread_mutex_t *_locker = malloc(sizeof(pthread_mutex_t));
+    if(_locker == NULL){
+        return NULL;
+    }
     pthread_mutex_init(_locker, NULL);   
     return _locker; 
 }
@@ -42,6 +149,15 @@ __weak void locker_lock(void *args){
     pthread_mutex_lock(_locker);
 }
 
+/**
+ * @brief Try to lock without waiting.
+ * @return true if the lock is acquired.
+ */
+__weak bool locker_trylock(void *args){
+    pthread_mutex_t *_locker = args;
+    return pthread_mutex_trylock(_locker) == 0;
+}
+
 __weak void locker_unlock(void *args){
     pthread_mutex_t *_locker = args;
     pthread_mutex_unlock(_locker);
@@ -50,4 +166,5 @@ __weak void locker_unlock(void *args){
 __weak void locker_deinit(void *args){
     pthread_mutex_t *_locker = args;
     pthread_mutex_destroy(_locker);
+    free(_locker);
 }
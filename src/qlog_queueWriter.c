@@ -0,0 +1,308 @@
+/**
+ * @file    qlog_queueWriter.c
+ * @author  qufeiyan
+ * @brief   Define a writer putting a bounded queue and a worker in front of another writer.
+ * @version 1.0.0
+ * @date    2026/10/18 21:40:52
+ * @version Copyright (c) 2023
+ */
+
+/* Includes --------------------------------------------------------------------------------*/
+#include "qlog_queueWriter.h"
+#include "qlog.h"
+#include "qlog_def.h"
+#include "qlog_deferred.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+//! the most bytes a log takes in the queue.
+#define SIZE_OF_QUEUE_LOG       (sizeof(struct queueEntry) + MEMORY_ALIGN_UP(SIZE_OF_LOG_TEXT, MEMORY_ALIGN) + \
+                                 SIZE_OF_LOG_BUFFER)
+
+/**
+ * @brief   take the oldest log out of the queue into the buffers of the writer decorated.
+ * @param   queueWriter is pointer to queue writer, with the mutex held.
+ * @return  false if the queue is empty.
+ */
+static bool _queueWriter_pop(queueWriter_t *queueWriter){
+    writer_t *target = queueWriter->super.inner;
+    struct queueEntry *entry;
+
+    entry = (struct queueEntry *)ringPop(&queueWriter->ring);
+    if(entry == NULL){
+        return false;
+    }
+
+    memcpy(queueWriter->text, entry + 1, entry->length + 1);
+    memcpy(queueWriter->record, (char *)(entry + 1) + MEMORY_ALIGN_UP(entry->length + 1, MEMORY_ALIGN),
+        entry->sizeOfRecord);
+    target->length = entry->length;
+    target->color = entry->color;
+    target->level = entry->level;
+    target->record = entry->sizeOfRecord ? (const deferredRecord_t *)queueWriter->record : NULL;
+    return true;
+}
+
+/**
+ * @brief   the worker, writes the logs queued until it is stopped and the queue is empty.
+ * @param   args is pointer to queue writer.
+ */
+static void *_queueWriter_worker(void *args){
+    queueWriter_t *queueWriter = (queueWriter_t *)args;
+    writer_t *target = queueWriter->super.inner;
+
+    pthread_mutex_lock(&queueWriter->mutex);
+    for(;;){
+        while(queueWriter->running && ringEmpty(&queueWriter->ring)){
+            pthread_cond_wait(&queueWriter->ready, &queueWriter->mutex);
+        }
+        if(!_queueWriter_pop(queueWriter)){
+            break;
+        }
+        queueWriter->busy = true;
+        pthread_mutex_unlock(&queueWriter->mutex);
+
+        target->write(target);
+
+        pthread_mutex_lock(&queueWriter->mutex);
+        queueWriter->busy = false;
+        if(queueWriter->waiters){
+            pthread_cond_broadcast(&queueWriter->done);
+        }
+    }
+    pthread_mutex_unlock(&queueWriter->mutex);
+    return NULL;
+}
+
+/**
+ * @brief   copy current log into the queue, or drop logs as the policy says if it is full.
+ * @param   queueWriter is pointer to queue writer, with the mutex held.
+ * @param   size is the bytes of the entry of current log.
+ */
+static void _queueWriter_push(queueWriter_t *queueWriter, uint32_t size){
+    writer_t *writer = &queueWriter->super;
+    struct queueEntry *entry;
+
+    while((entry = (struct queueEntry *)ringReserve(&queueWriter->ring, size)) == NULL){
+        //! the dropped logs are counted by the queue, the writer decorated counts its own.
+        if(queueWriter->policy == LOG_QUEUE_DROP_OLDEST){
+            ringPop(&queueWriter->ring);
+            statsAdd(&writer->stats.dropped, 1);
+            continue;
+        }
+        if(queueWriter->policy == LOG_QUEUE_DROP_NEWEST ||
+            (queueWriter->policy == LOG_QUEUE_DROP_BELOW_LEVEL && writer->level > queueWriter->level)){
+            statsAdd(&writer->stats.dropped, 1);
+            return;
+        }
+        queueWriter->waiters++;
+        pthread_cond_wait(&queueWriter->done, &queueWriter->mutex);
+        queueWriter->waiters--;
+    }
+
+    entry->length = writer->length;
+    entry->sizeOfRecord = 0;
+    entry->level = writer->level;
+    entry->color = writer->color;
+    memcpy(entry + 1, writer->buffer, writer->length);
+    ((char *)(entry + 1))[writer->length] = '\0';
+    if(writer->record && writer->inner->binary){
+        entry->sizeOfRecord = sizeof(deferredRecord_t) + writer->record->size;
+        memcpy((char *)(entry + 1) + MEMORY_ALIGN_UP(writer->length + 1, MEMORY_ALIGN), writer->record,
+            entry->sizeOfRecord);
+    }
+    ringCommit(&queueWriter->ring, &entry->super);
+}
+
+/**
+ * @brief   queue current log for the writer decorated, and pass it to the next writer.
+ * @param   writer is pointer to queue writer.
+ * @note    once the worker is stopped, the log is written to the writer decorated at once.
+ */
+void _queueWriter_write(writer_t *writer){
+    queueWriter_t *queueWriter;
+    writer_t *target;
+    uint32_t size;
+    assert(writer != NULL && writer->inner != NULL);
+    queueWriter = (queueWriter_t *)writer;
+    target = writer->inner;
+
+    //! the text is empty if only the writers consuming records are enabled.
+    if(!__atomic_load_n(&target->enable, __ATOMIC_RELAXED) ||
+        (__atomic_load_n(&target->skipped, __ATOMIC_RELAXED) & (1u << writer->level)) ||
+        (writer->length == 0 && !(writer->record && target->binary))){
+        goto next;
+    }
+
+    pthread_mutex_lock(&queueWriter->mutex);
+    if(queueWriter->running){
+        size = sizeof(struct queueEntry) + MEMORY_ALIGN_UP(writer->length + 1, MEMORY_ALIGN);
+        if(writer->record && target->binary){
+            size += sizeof(deferredRecord_t) + writer->record->size;
+        }
+        _queueWriter_push(queueWriter, size);
+        pthread_cond_signal(&queueWriter->ready);
+        pthread_mutex_unlock(&queueWriter->mutex);
+        goto next;
+    }
+    pthread_mutex_unlock(&queueWriter->mutex);
+
+    memcpy(queueWriter->text, writer->buffer, writer->length);
+    queueWriter->text[writer->length] = '\0';
+    target->length = writer->length;
+    target->color = writer->color;
+    target->level = writer->level;
+    target->record = writer->record;
+    target->write(target);
+
+next:
+    //! call another writer.
+    writer_t *nextWriter = writer->next;
+    if(nextWriter){
+        nextWriter->length = writer->length;
+        nextWriter->color = writer->color;
+        nextWriter->level = writer->level;
+        nextWriter->record = writer->record;
+        nextWriter->write(nextWriter);
+    }
+}
+
+/**
+ * @brief   wait until the logs queued are written, then flush the writer decorated.
+ * @param   writer is pointer to queue writer.
+ */
+void _queueWriter_flush(writer_t *writer){
+    queueWriter_t *queueWriter;
+    writer_t *target;
+    assert(writer != NULL);
+    queueWriter = (queueWriter_t *)writer;
+    target = writer->inner;
+
+    pthread_mutex_lock(&queueWriter->mutex);
+    queueWriter->waiters++;
+    while(!ringEmpty(&queueWriter->ring) || queueWriter->busy){
+        pthread_cond_wait(&queueWriter->done, &queueWriter->mutex);
+    }
+    queueWriter->waiters--;
+    //! the worker is idle until the mutex is released.
+    if(target->flush){
+        target->flush(target);
+    }
+    pthread_mutex_unlock(&queueWriter->mutex);
+}
+
+/**
+ * @brief   write what the writer decorated keeps and then the logs queued, or a text, straight
+ *          to the sink of the writer decorated at crash.
+ * @param   writer is pointer to queue writer.
+ * @param   text is the text to write, NULL means the logs kept.
+ * @param   length is the length of {@code text}.
+ * @note    no lock is taken, the log being written by the worker may be lost, and the logs
+ *          queued as records only are skipped, as rendering them is not async-signal-safe.
+ */
+void _queueWriter_emergency(writer_t *writer, const char *text, int32_t length){
+    queueWriter_t *queueWriter = (queueWriter_t *)writer;
+    writer_t *target = writer->inner;
+    struct queueEntry *entry;
+    uint64_t head, tail;
+
+    if(target->emergency == NULL){
+        return;
+    }
+    target->emergency(target, text, length);
+    if(text != NULL){
+        return;
+    }
+
+    head = queueWriter->ring.head;
+    tail = queueWriter->ring.tail;
+    while((entry = (struct queueEntry *)ringWalk(&queueWriter->ring, &head, tail)) != NULL){
+        if(entry->length > 0){
+            target->emergency(target, (const char *)(entry + 1), entry->length);
+        }
+    }
+}
+
+/**
+ * @brief   write the logs queued and stop the worker, the writer decorated is left open.
+ * @param   writer is pointer to queue writer.
+ */
+void _queueWriter_deInit(writer_t *writer){
+    queueWriter_t *queueWriter;
+    assert(writer != NULL);
+    queueWriter = (queueWriter_t *)writer;
+
+    pthread_mutex_lock(&queueWriter->mutex);
+    if(!queueWriter->running){
+        pthread_mutex_unlock(&queueWriter->mutex);
+        return;
+    }
+    queueWriter->running = false;
+    pthread_cond_signal(&queueWriter->ready);
+    pthread_mutex_unlock(&queueWriter->mutex);
+
+    pthread_join(queueWriter->worker, NULL);
+}
+
+/**
+ * @brief   free the queue of a queue writer stopped by deInit.
+ * @param   writer is pointer to queue writer.
+ */
+void _queueWriter_release(writer_t *writer){
+    queueWriter_t *queueWriter;
+    assert(writer != NULL);
+    queueWriter = (queueWriter_t *)writer;
+    assert(!queueWriter->running);
+
+    ringRelease(&queueWriter->ring);
+    pthread_cond_destroy(&queueWriter->done);
+    pthread_cond_destroy(&queueWriter->ready);
+    pthread_mutex_destroy(&queueWriter->mutex);
+}
+
+bool queueWriterInit(writer_t *writer, writer_t *target, uint32_t size,
+                     log_queue_policy_t policy, level_t level){
+    queueWriter_t *queueWriter;
+    int ret;
+    assert(writer != NULL && target != NULL && target->inner == NULL);
+    assert(policy < LOG_QUEUE_BUTT && level < LOG_LEVEL_BUTT);
+
+    queueWriter = (queueWriter_t *)writer;
+    memset(queueWriter, 0, sizeof(*queueWriter));
+
+    if(!ringInit(&queueWriter->ring, size, SIZE_OF_QUEUE_LOG)){
+        return false;
+    }
+    queueWriter->policy = policy;
+    queueWriter->level = level;
+    pthread_mutex_init(&queueWriter->mutex, NULL);
+    pthread_cond_init(&queueWriter->ready, NULL);
+    pthread_cond_init(&queueWriter->done, NULL);
+
+    //! the queue writer takes the place of the writer decorated in the chain, which writes
+    //! from the buffer of queue.
+    strcpy(writer->name, target->name);
+    writer->buffer = target->buffer;
+    writer->next = target->next;
+    target->buffer = queueWriter->text;
+    target->next = NULL;
+
+    writer->inner = target;
+    writer->binary = target->binary;
+    writer->enable = true;
+    writer->write = _queueWriter_write;
+    writer->flush = _queueWriter_flush;
+    writer->deInit = _queueWriter_deInit;
+    writer->release = _queueWriter_release;
+    writer->emergency = _queueWriter_emergency;
+
+    queueWriter->running = true;
+    ret = pthread_create(&queueWriter->worker, NULL, _queueWriter_worker, queueWriter);
+    assert(ret == 0);
+    (void)ret;
+    return true;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file    qlog_ring.c
+ * @author  qufeiyan
+ * @brief   A byte ring of variable-sized entries, which never wrap.
+ * @version 1.0.0
+ * @date    2026/10/19 09:31:05
+ * @version Copyright (c) 2023
+ */
+
+/* Includes --------------------------------------------------------------------------------*/
+#include "qlog_ring.h"
+#include "qlog_def.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool ringInit(ring_t *ring, uint32_t size, uint32_t maximum){
+    assert(ring != NULL && maximum > 0);
+
+    memset(ring, 0, sizeof(*ring));
+    //! the padding before an entry is less than an entry.
+    maximum = MEMORY_ALIGN_UP(maximum, RING_ALIGN);
+    size = MEMORY_ALIGN_UP(size, RING_ALIGN);
+    if(size < 4 * maximum){
+        size = 4 * maximum;
+    }
+    ring->buffer = (char *)aligned_alloc(RING_ALIGN, size);
+    if(ring->buffer == NULL){
+        return false;
+    }
+    ring->size = size;
+    return true;
+}
+
+void ringRelease(ring_t *ring){
+    assert(ring != NULL);
+
+    free(ring->buffer);
+    ring->buffer = NULL;
+    ring->size = 0;
+    ring->head = ring->tail = 0;
+}
+
+ringEntry_t *ringReserve(ring_t *ring, uint32_t size){
+    ringEntry_t *entry;
+    uint32_t position, pad;
+    assert(ring != NULL && size >= sizeof(ringEntry_t));
+
+    size = MEMORY_ALIGN_UP(size, RING_ALIGN);
+    position = ring->tail % ring->size;
+    pad = ring->size - position < size ? ring->size - position : 0;
+    if(ring->size - (ring->tail - ring->head) < pad + size){
+        return NULL;
+    }
+
+    if(pad){
+        entry = (ringEntry_t *)(ring->buffer + position);
+        entry->size = pad;
+        entry->pad = 1;
+        ring->tail += pad;
+        position = 0;
+    }
+
+    entry = (ringEntry_t *)(ring->buffer + position);
+    entry->size = size;
+    entry->pad = 0;
+    return entry;
+}
+
+void ringCommit(ring_t *ring, ringEntry_t *entry){
+    assert(ring != NULL && entry != NULL);
+    assert((char *)entry == ring->buffer + ring->tail % ring->size);
+
+    ring->tail += entry->size;
+}
+
+ringEntry_t *ringPop(ring_t *ring){
+    ringEntry_t *entry;
+    assert(ring != NULL);
+
+    while(ring->head != ring->tail){
+        entry = (ringEntry_t *)(ring->buffer + ring->head % ring->size);
+        ring->head += entry->size;
+        if(!entry->pad){
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+ringEntry_t *ringWalk(const ring_t *ring, uint64_t *offset, uint64_t tail){
+    ringEntry_t *entry;
+    assert(ring != NULL && offset != NULL);
+
+    while(*offset < tail){
+        entry = (ringEntry_t *)(ring->buffer + *offset % ring->size);
+        if(entry->size == 0){
+            return NULL;        //! torn by a writer, give up rather than loop.
+        }
+        *offset += entry->size;
+        if(!entry->pad){
+            return entry;
+        }
+    }
+    return NULL;
+}
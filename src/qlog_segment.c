@@ -0,0 +1,251 @@
+/**
+ * @file    qlog_segment.c
+ * @author  qufeiyan
+ * @brief   Sequence-numbered segment files, rotated without renaming and deleted
+ *          by a background reaper.
+ * @version 1.0.0
+ * @date    2026/10/18 17:20:44
+ * @version Copyright (c) 2023
+ */
+
+/* Includes --------------------------------------------------------------------------------*/
+#include "qlog_segment.h"
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief   get the path of a segment.
+ * @param   path is where the path is written to, {@code SIZE_OF_SEGMENT_PATH} bytes.
+ */
+static void _segment_path(const segment_t *segment, uint32_t sequence, char *path){
+    snprintf(path, SIZE_OF_SEGMENT_PATH, "%s.%06u", segment->filePath, sequence);
+}
+
+/**
+ * @brief   get the time when the current segment expires, aligned to the interval.
+ */
+static time_t _segment_deadline(const segment_t *segment, time_t now){
+    uint32_t interval = segment->interval;
+    return interval ? (now / interval + 1) * interval : 0;
+}
+
+/**
+ * @brief   drop the oldest segments beyond the limits, they are deleted by the reaper.
+ * @note    the mutex must be held.
+ */
+static void _segment_trim(segment_t *segment){
+    uint32_t numberOfFiles = segment->numberOfFiles;
+
+    while(segment->oldest < segment->sequence &&
+          (segment->sequence - segment->oldest > numberOfFiles ||
+           (segment->budget && segment->total + segment->sizeOfFile > segment->budget))){
+        segment->total -= segment->sizes[segment->oldest % numberOfFiles];
+        segment->oldest++;
+    }
+
+    if(segment->reaped != segment->oldest){
+        pthread_cond_signal(&segment->wakeup);
+    }
+}
+
+/**
+ * @brief   delete the segments dropped.
+ * @note    the mutex must be held, it is released while deleting.
+ */
+static void _segment_reap(segment_t *segment){
+    char path[SIZE_OF_SEGMENT_PATH];
+
+    while(segment->reaped != segment->oldest){
+        _segment_path(segment, segment->reaped, path);
+        pthread_mutex_unlock(&segment->mutex);
+        unlink(path);
+        pthread_mutex_lock(&segment->mutex);
+        segment->reaped++;
+    }
+}
+
+/**
+ * @brief   the reaper thread, deletes the segments dropped by rotations.
+ * @param   args is pointer to segment.
+ */
+static void *_segment_reaper(void *args){
+    segment_t *segment = (segment_t *)args;
+
+    pthread_mutex_lock(&segment->mutex);
+    while(segment->running || segment->reaped != segment->oldest){
+        if(segment->reaped == segment->oldest){
+            pthread_cond_wait(&segment->wakeup, &segment->mutex);
+            continue;
+        }
+        _segment_reap(segment);
+    }
+    pthread_mutex_unlock(&segment->mutex);
+    return NULL;
+}
+
+/**
+ * @brief   find the segments left in the directory.
+ * @param   segment is pointer to segment.
+ * @param   first is the smallest sequence found.
+ * @return  false if there is no segment.
+ */
+static bool _segment_scan(segment_t *segment, uint32_t *first){
+    char directory[SIZE_OF_FILE_PATH];
+    const char *name;
+    char *slash, *end;
+    size_t length;
+    struct dirent *entry;
+    unsigned long sequence;
+    bool found = false;
+    DIR *dir;
+
+    strcpy(directory, segment->filePath);
+    slash = strrchr(directory, '/');
+    if(slash != NULL){
+        *slash = '\0';
+        name = segment->filePath + (slash - directory) + 1;
+    }else{
+        strcpy(directory, ".");
+        name = segment->filePath;
+    }
+    length = strlen(name);
+
+    dir = opendir(directory);
+    if(dir == NULL){
+        return false;
+    }
+    while((entry = readdir(dir)) != NULL){
+        if(strncmp(entry->d_name, name, length) != 0 || entry->d_name[length] != '.' ||
+           entry->d_name[length + 1] < '0' || entry->d_name[length + 1] > '9'){
+            continue;
+        }
+        errno = 0;
+        sequence = strtoul(entry->d_name + length + 1, &end, 10);
+        if(*end != '\0' || errno != 0 || sequence >= UINT32_MAX){
+            continue;
+        }
+
+        if(!found || sequence < *first){
+            *first = sequence;
+        }
+        if(!found || sequence >= segment->sequence){
+            segment->sequence = sequence + 1;
+        }
+        found = true;
+    }
+    closedir(dir);
+    return found;
+}
+
+void segmentInit(segment_t *segment, const char *filePath, int numberOfFiles, int sizeOfFile){
+    char path[SIZE_OF_SEGMENT_PATH];
+    struct stat st;
+    uint32_t first = 0, sequence;
+    int ret;
+    assert(segment != NULL && filePath != NULL);
+    assert(numberOfFiles > 0 && sizeOfFile > 0);
+
+    memset(segment, 0, sizeof(*segment));
+    strcpy(segment->filePath, filePath);
+    segment->numberOfFiles = numberOfFiles;
+    segment->sizeOfFile = sizeOfFile;
+    segment->sizes = (uint64_t *)calloc(numberOfFiles, sizeof(uint64_t));
+    assert(segment->sizes != NULL);
+
+    //! continue after the segments left by the last run, they are retained as old segments.
+    segment->sequence = 0;
+    if(!_segment_scan(segment, &first)){
+        first = 0;
+    }
+    segment->reaped = first;
+    segment->oldest = first;
+    if(segment->sequence - first > (uint32_t)numberOfFiles){
+        segment->oldest = segment->sequence - numberOfFiles;
+    }
+    for(sequence = segment->oldest; sequence != segment->sequence; ++sequence){
+        _segment_path(segment, sequence, path);
+        segment->sizes[sequence % numberOfFiles] = (stat(path, &st) == 0) ? st.st_size : 0;
+        segment->total += segment->sizes[sequence % numberOfFiles];
+    }
+    _segment_path(segment, segment->sequence, segment->currentPath);
+
+    pthread_mutex_init(&segment->mutex, NULL);
+    pthread_cond_init(&segment->wakeup, NULL);
+    segment->running = true;
+    ret = pthread_create(&segment->reaper, NULL, _segment_reaper, segment);
+    assert(ret == 0);
+
+    pthread_mutex_lock(&segment->mutex);
+    _segment_trim(segment);
+    pthread_mutex_unlock(&segment->mutex);
+}
+
+void segmentDeInit(segment_t *segment){
+    assert(segment != NULL);
+
+    pthread_mutex_lock(&segment->mutex);
+    if(!segment->running){
+        pthread_mutex_unlock(&segment->mutex);
+        return;
+    }
+    segment->running = false;
+    pthread_cond_signal(&segment->wakeup);
+    pthread_mutex_unlock(&segment->mutex);
+
+    pthread_join(segment->reaper, NULL);
+}
+
+void segmentRelease(segment_t *segment){
+    assert(segment != NULL && !segment->running);
+
+    free(segment->sizes);
+    segment->sizes = NULL;
+    pthread_cond_destroy(&segment->wakeup);
+    pthread_mutex_destroy(&segment->mutex);
+}
+
+void segmentRotate(segment_t *segment, uint64_t size){
+    assert(segment != NULL);
+
+    pthread_mutex_lock(&segment->mutex);
+    //! the slot of the segment closed is that of the oldest one if all the old segments
+    //! retained are there, the oldest one is dropped before its size is overwritten.
+    while(segment->sequence - segment->oldest >= (uint32_t)segment->numberOfFiles){
+        segment->total -= segment->sizes[segment->oldest % segment->numberOfFiles];
+        segment->oldest++;
+    }
+    segment->sizes[segment->sequence % segment->numberOfFiles] = size;
+    segment->total += size;
+    segment->sequence++;
+    _segment_path(segment, segment->sequence, segment->currentPath);
+    __atomic_store_n(&segment->deadline, _segment_deadline(segment, time(NULL)), __ATOMIC_RELAXED);
+
+    _segment_trim(segment);
+    if(!segment->running){
+        _segment_reap(segment);
+    }
+    pthread_mutex_unlock(&segment->mutex);
+}
+
+void segmentSetPolicy(segment_t *segment, uint32_t interval, uint64_t budget){
+    assert(segment != NULL);
+
+    pthread_mutex_lock(&segment->mutex);
+    segment->budget = budget;
+    __atomic_store_n(&segment->interval, interval, __ATOMIC_RELAXED);
+    __atomic_store_n(&segment->deadline, _segment_deadline(segment, time(NULL)), __ATOMIC_RELAXED);
+
+    _segment_trim(segment);
+    if(!segment->running){
+        _segment_reap(segment);
+    }
+    pthread_mutex_unlock(&segment->mutex);
+}
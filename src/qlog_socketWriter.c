@@ -0,0 +1,749 @@
+/**
+ * @file    qlog_socketWriter.c
+ * @author  qufeiyan
+ * @brief   Define a socket writer sending logs in batches to a local collector.
+ * @version 1.0.0
+ * @date    2026/10/19 04:12:27
+ * @version Copyright (c) 2023
+ */
+
+/* Includes --------------------------------------------------------------------------------*/
+#define _GNU_SOURCE     //! sendmmsg, program_invocation_short_name
+#include "qlog_socketWriter.h"
+#include "qlog.h"
+#include "qlog_def.h"
+#include <assert.h>
+#include <errno.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define SIZE_OF_SOCKET_PORT     (16)
+//! the most bytes of the prefix and the header of a frame, "LEN <PRI>1 TIMESTAMP " and the identity.
+#define SIZE_OF_SOCKET_HEADER   (64 + sizeof(((socketWriter_t *)0)->identity))
+//! the most bytes a log takes in the ring.
+#define SIZE_OF_SOCKET_LOG      (sizeof(struct socketEntry) + SIZE_OF_SOCKET_HEADER + SIZE_OF_LOG_TEXT)
+
+//! the syslog severities of levels.
+static const uint8_t severities[] = {
+    [LOG_LEVEL_FATAL] = 2,          //! critical.
+    [LOG_LEVEL_ERROR] = 3,
+    [LOG_LEVEL_WARNING] = 4,
+    [LOG_LEVEL_INFO] = 6,
+    [LOG_LEVEL_DEBUG] = 7,
+};
+
+/**
+ * @brief   check whether the socket of a writer keeps the boundaries of messages.
+ */
+static bool _socketWriter_datagram(const socketWriter_t *socketWriter){
+    return socketWriter->transport == LOG_SOCKET_UNIX_DGRAM || socketWriter->transport == LOG_SOCKET_UDP;
+}
+
+/**
+ * @brief   append a decimal number to a buffer, async-signal-safe.
+ * @return  the length of the number.
+ */
+static int32_t _socketWriter_number(char *buffer, uint32_t value){
+    char digits[10];
+    int32_t count = 0, length;
+
+    do{
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    }while(value);
+    for(length = 0; count > 0; ++length){
+        buffer[length] = digits[--count];
+    }
+    return length;
+}
+
+/**
+ * @brief   render the syslog header of a log, "<PRI>1 TIMESTAMP " and the identity.
+ * @param   socketWriter is pointer to socket writer.
+ * @param   level is the level of the log.
+ * @param   now is false to render the timestamp as "-", it is async-signal-safe then.
+ * @param   header is where the header is rendered to, {@code SIZE_OF_SOCKET_HEADER} bytes.
+ * @return  the length of the header.
+ */
+static int32_t _socketWriter_header(socketWriter_t *socketWriter, level_t level, bool now, char *header){
+    char *cursor = header;
+    struct timespec ts;
+    struct tm tm;
+    uint32_t micros;
+
+    *cursor++ = '<';
+    cursor += _socketWriter_number(cursor, SOCKET_SYSLOG_FACILITY * 8 + severities[level]);
+    memcpy(cursor, ">1 ", 3);
+    cursor += 3;
+
+    if(now){
+        //! the date and time are rendered once per second, in UTC as RFC 5424 prefers.
+        clock_gettime(CLOCK_REALTIME, &ts);
+        if(ts.tv_sec != socketWriter->second){
+            gmtime_r(&ts.tv_sec, &tm);
+            strftime(socketWriter->timestamp, sizeof(socketWriter->timestamp), "%Y-%m-%dT%H:%M:%S", &tm);
+            socketWriter->second = ts.tv_sec;
+        }
+        memcpy(cursor, socketWriter->timestamp, 19);
+        cursor += 19;
+        *cursor++ = '.';
+        micros = ts.tv_nsec / 1000;
+        for(int i = 5; i >= 0; --i){
+            cursor[i] = '0' + micros % 10;
+            micros /= 10;
+        }
+        cursor += 6;
+        *cursor++ = 'Z';
+    }else{
+        *cursor++ = '-';
+    }
+    *cursor++ = ' ';
+
+    memcpy(cursor, socketWriter->identity, socketWriter->identityLength);
+    return cursor + socketWriter->identityLength - header;
+}
+
+/**
+ * @brief   render the prefix of a frame, the length of a syslog message on a stream socket,
+ *          or the length of the text in 4 bytes of big endian, async-signal-safe.
+ * @param   socketWriter is pointer to socket writer.
+ * @param   length is the length of the frame without prefix.
+ * @param   prefix is where the prefix is rendered to, 16 bytes.
+ * @return  the length of the prefix, 0 if there is none.
+ */
+static int32_t _socketWriter_prefix(socketWriter_t *socketWriter, uint32_t length, char *prefix){
+    int32_t prefixLength;
+
+    if(socketWriter->framing == LOG_FRAMING_LENGTH){
+        prefix[0] = (char)(length >> 24);
+        prefix[1] = (char)(length >> 16);
+        prefix[2] = (char)(length >> 8);
+        prefix[3] = (char)length;
+        return 4;
+    }
+    if(_socketWriter_datagram(socketWriter)){
+        return 0;
+    }
+    //! octet counting of RFC 6587.
+    prefixLength = _socketWriter_number(prefix, length);
+    prefix[prefixLength++] = ' ';
+    return prefixLength;
+}
+
+/**
+ * @brief   frame current log into the ring, it is dropped if the ring is full.
+ * @param   socketWriter is pointer to socket writer, with the mutex held.
+ */
+static void _socketWriter_frame(socketWriter_t *socketWriter){
+    writer_t *writer = &socketWriter->super;
+    char header[SIZE_OF_SOCKET_HEADER], prefix[16];
+    int32_t length = writer->length, headerLength = 0, prefixLength;
+    struct socketEntry *entry;
+    char *frame;
+
+    //! a frame is a record by itself, the line break is left to the collector.
+    while(length > 0 && writer->buffer[length - 1] == '\n'){
+        length--;
+    }
+    if(socketWriter->framing == LOG_FRAMING_SYSLOG){
+        headerLength = _socketWriter_header(socketWriter, writer->level, true, header);
+    }
+    prefixLength = _socketWriter_prefix(socketWriter, headerLength + length, prefix);
+
+    entry = (struct socketEntry *)ringReserve(&socketWriter->ring,
+        sizeof(struct socketEntry) + prefixLength + headerLength + length);
+    if(entry == NULL){
+        //! the collector is behind or unavailable, the logs kept are sent first.
+        statsAdd(&writer->stats.dropped, 1);
+        return;
+    }
+
+    entry->length = prefixLength + headerLength + length;
+    frame = (char *)(entry + 1);
+    memcpy(frame, prefix, prefixLength);
+    memcpy(frame + prefixLength, header, headerLength);
+    memcpy(frame + prefixLength + headerLength, writer->buffer, length);
+    ringCommit(&socketWriter->ring, &entry->super);
+    socketWriter->numberOfLogs++;
+}
+
+/**
+ * @brief   point the iovecs at the oldest logs in the ring.
+ * @param   socketWriter is pointer to socket writer, with the mutex held.
+ * @return  the number of logs taken, at most {@code COUNT_OF_SOCKET_BATCH}.
+ */
+static uint32_t _socketWriter_gather(socketWriter_t *socketWriter){
+    struct socketEntry *entry;
+    uint32_t count = 0;
+    uint64_t head = socketWriter->ring.head;
+
+    while(count < COUNT_OF_SOCKET_BATCH &&
+          (entry = (struct socketEntry *)ringWalk(&socketWriter->ring, &head, socketWriter->ring.tail)) != NULL){
+        socketWriter->iovecs[count].iov_base = entry + 1;
+        socketWriter->iovecs[count].iov_len = entry->length;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief   give back the room of the oldest logs in the ring.
+ * @param   socketWriter is pointer to socket writer, with the mutex held.
+ * @param   count is the number of logs, the pads among them are skipped.
+ */
+static void _socketWriter_advance(socketWriter_t *socketWriter, uint32_t count){
+    for(; count > 0 && ringPop(&socketWriter->ring) != NULL; count--){
+        socketWriter->numberOfLogs--;
+    }
+}
+
+/**
+ * @brief   drop all the logs in the ring.
+ * @param   socketWriter is pointer to socket writer, with the mutex held.
+ */
+static void _socketWriter_drop(socketWriter_t *socketWriter){
+    while(ringPop(&socketWriter->ring) != NULL){
+        statsAdd(&socketWriter->super.stats.dropped, 1);
+    }
+    socketWriter->numberOfLogs = 0;
+}
+
+/**
+ * @brief   close the broken connection, and put off the next reconnection.
+ * @param   socketWriter is pointer to socket writer, with the mutex held.
+ */
+static void _socketWriter_disconnect(socketWriter_t *socketWriter){
+    if(socketWriter->fd >= 0){
+        close(socketWriter->fd);
+        socketWriter->fd = -1;
+    }
+    socketWriter->retryTime = statsNow() + socketWriter->backoff * 1000000ull;
+    socketWriter->backoff = socketWriter->backoff * 2 < SOCKET_RETRY_MAX ? socketWriter->backoff * 2 : SOCKET_RETRY_MAX;
+}
+
+/**
+ * @brief   split "host:port" or "[host]:port".
+ * @return  false if the address is invalid.
+ */
+static bool _socketWriter_split(const char *address, char *host, char *port){
+    const char *colon, *end;
+
+    if(address[0] == '['){
+        end = strchr(address, ']');
+        if(end == NULL || end[1] != ':'){
+            return false;
+        }
+        address++;
+        colon = end + 1;
+    }else{
+        colon = end = strrchr(address, ':');
+        if(colon == NULL){
+            return false;
+        }
+    }
+    if(end == address || colon[1] == '\0' || strlen(colon + 1) >= SIZE_OF_SOCKET_PORT){
+        return false;
+    }
+    memcpy(host, address, end - address);
+    host[end - address] = '\0';
+    strcpy(port, colon + 1);
+    return true;
+}
+
+/**
+ * @brief   connect a socket, with the timeout of sending set first, which bounds the connect
+ *          as well, e.g. to a collector never accepting, or a unix socket with its backlog full.
+ * @return  false if the socket is not connected, it is closed then.
+ */
+static bool _socketWriter_open(int fd, const struct sockaddr *address, socklen_t length){
+    struct timeval timeout = { SOCKET_SEND_TIMEOUT / 1000, (SOCKET_SEND_TIMEOUT % 1000) * 1000 };
+
+    //! a stalled collector holds the sender for a while at most.
+    if(setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) < 0 || connect(fd, address, length) < 0){
+        close(fd);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief   connect to the collector.
+ * @param   socketWriter is pointer to socket writer.
+ * @return  the socket connected, -1 if the collector is unavailable.
+ * @note    called without the mutex, the address is never changed.
+ */
+static int _socketWriter_connect(socketWriter_t *socketWriter){
+    int type = _socketWriter_datagram(socketWriter) ? SOCK_DGRAM : SOCK_STREAM;
+    char host[SIZE_OF_SOCKET_ADDRESS], port[SIZE_OF_SOCKET_PORT];
+    struct addrinfo hints, *result, *info;
+    struct sockaddr_un path;
+    int fd = -1;
+
+    if(socketWriter->transport == LOG_SOCKET_UNIX_DGRAM || socketWriter->transport == LOG_SOCKET_UNIX_STREAM){
+        memset(&path, 0, sizeof(path));
+        path.sun_family = AF_UNIX;
+        strcpy(path.sun_path, socketWriter->address);
+        fd = socket(AF_UNIX, type | SOCK_CLOEXEC, 0);
+        if(fd >= 0 && !_socketWriter_open(fd, (struct sockaddr *)&path, sizeof(path))){
+            fd = -1;
+        }
+    }else{
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = type;
+        if(!_socketWriter_split(socketWriter->address, host, port) || getaddrinfo(host, port, &hints, &result) != 0){
+            return -1;
+        }
+        for(info = result; info != NULL && fd < 0; info = info->ai_next){
+            fd = socket(info->ai_family, info->ai_socktype | SOCK_CLOEXEC, info->ai_protocol);
+            if(fd >= 0 && !_socketWriter_open(fd, info->ai_addr, info->ai_addrlen)){
+                fd = -1;
+            }
+        }
+        freeaddrinfo(result);
+    }
+    return fd;
+}
+
+/**
+ * @brief   send the logs gathered in the iovecs.
+ * @param   socketWriter is pointer to socket writer.
+ * @param   count is the number of logs gathered.
+ * @param   dropped is where the number of logs the collector never takes is added, e.g.
+ *          a datagram too large.
+ * @param   bytes is where the bytes sent are added.
+ * @return  the number of logs done with, less than {@code count} if the connection is broken.
+ */
+static uint32_t _socketWriter_send(socketWriter_t *socketWriter, uint32_t count, uint32_t *dropped, uint64_t *bytes){
+    struct msghdr message;
+    uint32_t done = 0, i;
+    ssize_t sent;
+    int ret;
+
+    if(_socketWriter_datagram(socketWriter)){
+        for(i = 0; i < count; ++i){
+            memset(&socketWriter->messages[i], 0, sizeof(socketWriter->messages[i]));
+            socketWriter->messages[i].msg_hdr.msg_iov = &socketWriter->iovecs[i];
+            socketWriter->messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        while(done < count){
+            ret = sendmmsg(socketWriter->fd, socketWriter->messages + done, count - done, MSG_NOSIGNAL);
+            if(ret < 0){
+                if(errno == EINTR){
+                    continue;
+                }
+                if(errno == EMSGSIZE){
+                    (*dropped)++;
+                    done++;
+                    continue;
+                }
+                break;
+            }
+            for(i = done; i < done + ret; ++i){
+                *bytes += socketWriter->iovecs[i].iov_len;
+            }
+            done += ret;
+        }
+        return done;
+    }
+
+    //! a stream takes the batch by one gathering send, a partial send resumes where it stopped.
+    while(done < count){
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = &socketWriter->iovecs[done];
+        message.msg_iovlen = count - done;
+        sent = sendmsg(socketWriter->fd, &message, MSG_NOSIGNAL);
+        if(sent < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            break;
+        }
+        *bytes += sent;
+        while(done < count && (size_t)sent >= socketWriter->iovecs[done].iov_len){
+            sent -= socketWriter->iovecs[done].iov_len;
+            done++;
+        }
+        if(done < count){
+            socketWriter->iovecs[done].iov_base = (char *)socketWriter->iovecs[done].iov_base + sent;
+            socketWriter->iovecs[done].iov_len -= sent;
+        }
+    }
+    return done;
+}
+
+/**
+ * @brief   send a batch of the oldest logs in the ring, the connection is closed if broken.
+ * @param   socketWriter is pointer to socket writer, with the mutex held and connected.
+ * @param   unlock is true to release the mutex while sending, so that logs are framed meanwhile.
+ * @return  false if the connection is broken, the logs not sent are kept for the next one.
+ */
+static bool _socketWriter_batch(socketWriter_t *socketWriter, bool unlock){
+    writerStats_t *stats = &socketWriter->super.stats;
+    uint32_t count, done, dropped = 0;
+    uint64_t bytes = 0, start;
+
+    count = _socketWriter_gather(socketWriter);
+    if(unlock){
+        socketWriter->busy = true;
+        pthread_mutex_unlock(&socketWriter->mutex);
+    }
+
+    start = statsNow();
+    done = _socketWriter_send(socketWriter, count, &dropped, &bytes);
+
+    if(unlock){
+        pthread_mutex_lock(&socketWriter->mutex);
+        socketWriter->busy = false;
+    }
+    _socketWriter_advance(socketWriter, done);
+    statsAdd(&stats->records, done - dropped);
+    statsAdd(&stats->bytes, bytes);
+    statsAdd(&stats->dropped, dropped);
+    statsAdd(&stats->flushes, 1);
+    histogramRecord(&stats->flushLatency, statsNow() - start);
+
+    if(done < count){
+        _socketWriter_disconnect(socketWriter);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief   the sender thread, sends the logs in batches and reconnects once disconnected,
+ *          until it is stopped and the ring is empty.
+ * @param   args is pointer to socket writer.
+ */
+static void *_socketWriter_sender(void *args){
+    socketWriter_t *socketWriter = (socketWriter_t *)args;
+    struct timespec deadline;
+    uint64_t expire;
+    int fd;
+
+    pthread_mutex_lock(&socketWriter->mutex);
+    for(;;){
+        if(ringEmpty(&socketWriter->ring)){
+            if(!socketWriter->running){
+                break;
+            }
+            pthread_cond_wait(&socketWriter->ready, &socketWriter->mutex);
+            continue;
+        }
+
+        if(socketWriter->fd >= 0){
+            expire = socketWriter->firstTime + SOCKET_FLUSH_INTERVAL * 1000000ull;
+            if(socketWriter->running && !socketWriter->urgent &&
+                socketWriter->numberOfLogs < COUNT_OF_SOCKET_BATCH && statsNow() < expire){
+                deadline.tv_sec = expire / 1000000000ull;
+                deadline.tv_nsec = expire % 1000000000ull;
+                pthread_cond_timedwait(&socketWriter->ready, &socketWriter->mutex, &deadline);
+                continue;
+            }
+
+            socketWriter->urgent = false;
+            _socketWriter_batch(socketWriter, true);
+            //! the logs framed meanwhile wait for a batch from now on.
+            socketWriter->firstTime = statsNow();
+            pthread_cond_broadcast(&socketWriter->done);
+            continue;
+        }
+
+        if(statsNow() < socketWriter->retryTime){
+            //! once stopped, the logs are not kept waiting for the collector.
+            if(!socketWriter->running){
+                _socketWriter_drop(socketWriter);
+                pthread_cond_broadcast(&socketWriter->done);
+                continue;
+            }
+            deadline.tv_sec = socketWriter->retryTime / 1000000000ull;
+            deadline.tv_nsec = socketWriter->retryTime % 1000000000ull;
+            pthread_cond_timedwait(&socketWriter->ready, &socketWriter->mutex, &deadline);
+            continue;
+        }
+
+        socketWriter->busy = true;
+        pthread_mutex_unlock(&socketWriter->mutex);
+        fd = _socketWriter_connect(socketWriter);
+        pthread_mutex_lock(&socketWriter->mutex);
+        socketWriter->busy = false;
+
+        if(fd < 0){
+            _socketWriter_disconnect(socketWriter);
+        }else{
+            socketWriter->fd = fd;
+            socketWriter->backoff = SOCKET_RETRY_MIN;
+        }
+        pthread_cond_broadcast(&socketWriter->done);
+    }
+    socketWriter->exited = true;
+    pthread_cond_broadcast(&socketWriter->done);
+    pthread_mutex_unlock(&socketWriter->mutex);
+
+    return NULL;
+}
+
+/**
+ * @brief   frame current log for the sender.
+ * @param   writer is pointer to socket writer.
+ * @note    the log is only copied into the ring, it never waits for the collector, the sender
+ *          is woken up once a batch is full or the log is at or above {@code SOCKET_FLUSH_LEVEL}.
+ *          once the sender is stopped, the log is sent at once if the socket is connected.
+ */
+void _socketWriter_write(writer_t *writer){
+    socketWriter_t *socketWriter;
+    bool empty;
+    assert(writer != NULL);
+    socketWriter = (socketWriter_t *)writer;
+
+    if(!writerAccepts(writer) || writer->length == 0) goto next;
+
+    pthread_mutex_lock(&socketWriter->mutex);
+    empty = ringEmpty(&socketWriter->ring);
+    _socketWriter_frame(socketWriter);
+    if(socketWriter->running){
+        if(empty){
+            socketWriter->firstTime = statsNow();
+        }
+        if(writer->level <= SOCKET_FLUSH_LEVEL){
+            socketWriter->urgent = true;
+        }
+        //! the sender waits without timeout only while the ring is empty.
+        if(empty || socketWriter->urgent || socketWriter->numberOfLogs == COUNT_OF_SOCKET_BATCH){
+            pthread_cond_signal(&socketWriter->ready);
+        }
+    }else{
+        while(socketWriter->fd >= 0 && !ringEmpty(&socketWriter->ring) &&
+              _socketWriter_batch(socketWriter, false));
+        _socketWriter_drop(socketWriter);
+    }
+    pthread_mutex_unlock(&socketWriter->mutex);
+
+next:
+    //! call another writer.
+    writer_t *nextWriter = writer->next;
+    if(nextWriter){
+        nextWriter->length = writer->length;
+        nextWriter->color = writer->color;
+        nextWriter->level = writer->level;
+        nextWriter->record = writer->record;
+        nextWriter->write(nextWriter);
+    }
+}
+
+/**
+ * @brief   flush a socket writer.
+ * @param   writer is pointer to socket writer.
+ * @note    returns after all the logs framed are sent, or once the collector is found
+ *          unavailable, the logs are kept for the next connection then.
+ */
+void _socketWriter_flush(writer_t *writer){
+    socketWriter_t *socketWriter;
+    assert(writer != NULL);
+    socketWriter = (socketWriter_t *)writer;
+
+    pthread_mutex_lock(&socketWriter->mutex);
+    socketWriter->urgent = true;
+    pthread_cond_signal(&socketWriter->ready);
+    while(socketWriter->running && (socketWriter->busy || (!ringEmpty(&socketWriter->ring) &&
+          (socketWriter->fd >= 0 || statsNow() >= socketWriter->retryTime)))){
+        pthread_cond_wait(&socketWriter->done, &socketWriter->mutex);
+    }
+    pthread_mutex_unlock(&socketWriter->mutex);
+}
+
+/**
+ * @brief   send the logs in the ring, or a text, straight to the collector at crash.
+ * @param   writer is pointer to socket writer.
+ * @param   text is the text to send, NULL means the logs in the ring.
+ * @param   length is the length of {@code text}.
+ * @note    no lock is taken and nothing blocks, a batch being sent by the sender may be sent
+ *          twice. the text is framed without timestamp, as rendering it is not async-signal-safe.
+ */
+void _socketWriter_emergency(writer_t *writer, const char *text, int32_t length){
+    socketWriter_t *socketWriter = (socketWriter_t *)writer;
+    char header[SIZE_OF_SOCKET_HEADER], prefix[16];
+    int32_t headerLength = 0, prefixLength;
+    struct socketEntry *entry;
+    struct iovec iovecs[3];
+    struct msghdr message;
+    uint64_t head, tail;
+    int fd = socketWriter->fd;
+
+    if(fd < 0){
+        return;
+    }
+
+    if(text == NULL){
+        head = socketWriter->ring.head;
+        tail = socketWriter->ring.tail;
+        while((entry = (struct socketEntry *)ringWalk(&socketWriter->ring, &head, tail)) != NULL){
+            if(entry->length > 0){
+                send(fd, entry + 1, entry->length, MSG_DONTWAIT | MSG_NOSIGNAL);
+            }
+        }
+        return;
+    }
+
+    while(length > 0 && text[length - 1] == '\n'){
+        length--;
+    }
+    if(socketWriter->framing == LOG_FRAMING_SYSLOG){
+        headerLength = _socketWriter_header(socketWriter, LOG_LEVEL_FATAL, false, header);
+    }
+    prefixLength = _socketWriter_prefix(socketWriter, headerLength + length, prefix);
+
+    iovecs[0].iov_base = prefix;
+    iovecs[0].iov_len = prefixLength;
+    iovecs[1].iov_base = header;
+    iovecs[1].iov_len = headerLength;
+    iovecs[2].iov_base = (void *)text;
+    iovecs[2].iov_len = length;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = iovecs;
+    message.msg_iovlen = 3;
+    sendmsg(fd, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+/**
+ * @brief   stop the sender after the logs framed are sent, or dropped if the collector is
+ *          unavailable.
+ * @param   writer is pointer to socket writer.
+ * @note    the socket is kept open, logs output later are sent by the caller. a collector
+ *          still taking the logs after {@code SOCKET_CLOSE_TIMEOUT} has its connection shut
+ *          down, so that the sender drops the rest, and it returns within one more
+ *          {@code SOCKET_SEND_TIMEOUT}.
+ */
+void _socketWriter_deInit(writer_t *writer){
+    socketWriter_t *socketWriter;
+    struct timespec deadline;
+    uint64_t expire;
+    assert(writer != NULL);
+    socketWriter = (socketWriter_t *)writer;
+
+    pthread_mutex_lock(&socketWriter->mutex);
+    if(!socketWriter->running){
+        pthread_mutex_unlock(&socketWriter->mutex);
+        return;
+    }
+    socketWriter->running = false;
+    pthread_cond_signal(&socketWriter->ready);
+
+    expire = statsNow() + SOCKET_CLOSE_TIMEOUT * 1000000ull;
+    deadline.tv_sec = expire / 1000000000ull;
+    deadline.tv_nsec = expire % 1000000000ull;
+    while(!socketWriter->exited){
+        if(pthread_cond_timedwait(&socketWriter->done, &socketWriter->mutex, &deadline) == ETIMEDOUT){
+            //! the sender closes the socket once its send fails.
+            if(!socketWriter->exited && socketWriter->fd >= 0){
+                shutdown(socketWriter->fd, SHUT_RDWR);
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&socketWriter->mutex);
+
+    pthread_join(socketWriter->sender, NULL);
+}
+
+/**
+ * @brief   close the socket and free the ring of a socket writer stopped by deInit.
+ * @param   writer is pointer to socket writer.
+ */
+void _socketWriter_release(writer_t *writer){
+    socketWriter_t *socketWriter;
+    assert(writer != NULL);
+    socketWriter = (socketWriter_t *)writer;
+    assert(!socketWriter->running);
+
+    if(socketWriter->fd >= 0){
+        close(socketWriter->fd);
+        socketWriter->fd = -1;
+    }
+    ringRelease(&socketWriter->ring);
+    free(socketWriter->messages);
+    socketWriter->messages = NULL;
+    pthread_cond_destroy(&socketWriter->done);
+    pthread_cond_destroy(&socketWriter->ready);
+    pthread_mutex_destroy(&socketWriter->mutex);
+}
+
+bool socketWriterInit(writer_t *writer, char *buffer, log_socket_t transport, const char *address,
+                      log_framing_t framing, uint32_t size){
+    socketWriter_t *socketWriter;
+    char host[SIZE_OF_SOCKET_ADDRESS], port[SIZE_OF_SOCKET_PORT], hostname[64], appName[49];
+    pthread_condattr_t attr;
+    int ret;
+    assert(writer != NULL && buffer != NULL && address != NULL);
+    assert(transport < LOG_SOCKET_BUTT && framing < LOG_FRAMING_BUTT);
+
+    socketWriter = (socketWriter_t *)writer;
+    memset(socketWriter, 0, sizeof(*socketWriter));
+
+    if(strlen(address) >= SIZE_OF_SOCKET_ADDRESS || ((transport == LOG_SOCKET_UDP ||
+        transport == LOG_SOCKET_TCP) && !_socketWriter_split(address, host, port))){
+        return false;
+    }
+
+    socketWriter->messages = (struct mmsghdr *)calloc(COUNT_OF_SOCKET_BATCH, sizeof(struct mmsghdr));
+    if(socketWriter->messages == NULL || !ringInit(&socketWriter->ring, size, SIZE_OF_SOCKET_LOG)){
+        ringRelease(&socketWriter->ring);
+        free(socketWriter->messages);
+        return false;
+    }
+    socketWriter->transport = transport;
+    socketWriter->framing = framing;
+    strcpy(socketWriter->address, address);
+    socketWriter->fd = -1;
+    socketWriter->backoff = SOCKET_RETRY_MIN;
+    socketWriter->second = -1;
+
+    //! the fields of RFC 5424 are printable without space, "-" if unknown.
+    if(gethostname(hostname, sizeof(hostname)) != 0 || hostname[0] == '\0'){
+        strcpy(hostname, "-");
+    }
+    hostname[sizeof(hostname) - 1] = '\0';
+    snprintf(appName, sizeof(appName), "%s", program_invocation_short_name[0] ? program_invocation_short_name : "-");
+    for(char *cursor = appName; *cursor; ++cursor){
+        if(*cursor <= ' ' || *cursor > '~'){
+            *cursor = '_';
+        }
+    }
+    socketWriter->identityLength = snprintf(socketWriter->identity, sizeof(socketWriter->identity),
+        "%s %s %d - - ", hostname, appName, (int)getpid());
+    if(socketWriter->identityLength >= (int32_t)sizeof(socketWriter->identity)){
+        socketWriter->identityLength = sizeof(socketWriter->identity) - 1;
+    }
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);   //! the reconnections are timed in monotonic time.
+    pthread_cond_init(&socketWriter->ready, &attr);
+    pthread_cond_init(&socketWriter->done, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&socketWriter->mutex, NULL);
+
+    strcpy(writer->name, "socket");
+    writer->buffer = buffer;
+    writer->write = _socketWriter_write;
+    writer->flush = _socketWriter_flush;
+    writer->deInit = _socketWriter_deInit;
+    writer->release = _socketWriter_release;
+    writer->emergency = _socketWriter_emergency;
+    writer->next = NULL;
+    writer->enable = false;
+
+    socketWriter->running = true;
+    ret = pthread_create(&socketWriter->sender, NULL, _socketWriter_sender, socketWriter);
+    assert(ret == 0);
+    (void)ret;
+    return true;
+}
@@ -0,0 +1,268 @@
+/**
+ * @file    qlog_stats.c
+ * @author  qufeiyan
+ * @brief   Snapshot and periodic dump of the counters of logger and writers.
+ * @version 1.0.0
+ * @date    2026/10/18 19:10:52
+ * @version Copyright (c) 2023
+ */
+
+/* Includes --------------------------------------------------------------------------------*/
+#include "qlog_stats.h"
+#include "qlog.h"
+#include "qlog_limiter.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define STATS_TAG   "qlog"      //! tag of the logs dumped.
+
+__thread uint32_t statsStripe;
+
+static pthread_mutex_t stripesLock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t stripesOwned;       //! mask of the stripes owned by living threads.
+static pthread_key_t stripeKey;     //! stripe of current thread + 1, given back at exit.
+static pthread_once_t stripeOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief   give the stripe back when its thread exits, the counts in it are kept.
+ * @param   args is the stripe + 1.
+ */
+static void _stats_stripeRelease(void *args){
+    uint32_t stripe = (uint32_t)(uintptr_t)args - 1;
+
+    pthread_mutex_lock(&stripesLock);
+    stripesOwned &= ~(1u << stripe);
+    pthread_mutex_unlock(&stripesLock);
+}
+
+static void _stats_stripeKey(void){
+    pthread_key_create(&stripeKey, _stats_stripeRelease);
+}
+
+void statsStripeAssign(void){
+    uint32_t stripe;
+
+    pthread_once(&stripeOnce, _stats_stripeKey);
+
+    //! the last stripe is shared, it is never owned.
+    pthread_mutex_lock(&stripesLock);
+    for(stripe = 0; stripe < COUNT_OF_STATS_STRIPE - 1 && (stripesOwned & (1u << stripe)); ++stripe);
+    if(stripe < COUNT_OF_STATS_STRIPE - 1){
+        stripesOwned |= 1u << stripe;
+        pthread_setspecific(stripeKey, (void *)(uintptr_t)(stripe + 1));
+    }
+    pthread_mutex_unlock(&stripesLock);
+    statsStripe = stripe + 1;
+}
+
+uint64_t stripedCounterRead(const stripedCounter_t *counter){
+    uint64_t value = 0;
+
+    for(int i = 0; i < COUNT_OF_STATS_STRIPE; ++i){
+        value += __atomic_load_n(&counter->stripes[i].value, __ATOMIC_RELAXED);
+    }
+    return value;
+}
+
+void histogramRead(log_histogram_t *to, const log_histogram_t *from){
+    to->count = __atomic_load_n(&from->count, __ATOMIC_RELAXED);
+    to->sum = __atomic_load_n(&from->sum, __ATOMIC_RELAXED);
+    to->max = __atomic_load_n(&from->max, __ATOMIC_RELAXED);
+    for(int i = 0; i < COUNT_OF_STATS_BUCKET; ++i){
+        to->buckets[i] = __atomic_load_n(&from->buckets[i], __ATOMIC_RELAXED);
+    }
+}
+
+uint64_t histogramPercentile(const log_histogram_t *histogram, uint32_t permille){
+    uint64_t count = 0, rank, upper;
+    int i;
+    assert(histogram != NULL && permille <= 1000);
+
+    rank = (histogram->count * permille + 999) / 1000;
+    for(i = 0; i < COUNT_OF_STATS_BUCKET - 1; ++i){
+        count += histogram->buckets[i];
+        if(count >= rank){
+            upper = i ? (1ull << i) - 1 : 0;
+            return upper < histogram->max ? upper : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+void statsSnapshot(logger_t *logger, log_stats_t *stats){
+    loggerStats_t *from;
+    log_writer_stats_t *to;
+    writer_t *writer, *target;
+    locker_t *locker;
+    memoryArena_t *arena;
+    memoryPoolStats_t pool;
+    assert(logger != NULL && stats != NULL);
+
+    memset(stats, 0, sizeof(*stats));
+    from = &logger->stats;
+    stats->accepted = __atomic_load_n(&from->accepted, __ATOMIC_RELAXED);
+    stats->filtered = stripedCounterRead(&from->filtered);
+    stats->suppressed = stripedCounterRead(&from->suppressed);
+    stats->dropped = __atomic_load_n(&from->dropped, __ATOMIC_RELAXED);
+    stats->truncated = __atomic_load_n(&from->truncated, __ATOMIC_RELAXED);
+    histogramRead(&stats->lockWait, &from->lockWait);
+
+    arena = logger->formatter->arena;
+    if(arena != NULL){
+        stats->arenaFailures = __atomic_load_n(&arena->failures, __ATOMIC_RELAXED);
+        for(size_t i = 0; i < arena->numberOfPools && i < COUNT_OF_STATS_CLASS; ++i){
+            memoryPoolStats(&arena->pools[i], &pool);
+            stats->arena[i].size = arena->pools[i].block_size;
+            stats->arena[i].total = pool.total;
+            stats->arena[i].used = pool.used;
+            stats->arena[i].highWater = pool.highWater;
+            stats->numberOfClasses++;
+        }
+    }
+
+    locker = logger->locker;
+    locker->lock(locker);
+    for(writer = logger->writer; writer != NULL && stats->numberOfWriters < COUNT_OF_STATS_WRITER;
+        writer = writer->next){
+        //! a decorator is reported as the writer it decorates, with the logs it dropped.
+        target = writer->inner ? writer->inner : writer;
+        to = &stats->writers[stats->numberOfWriters++];
+        snprintf(to->name, sizeof(to->name), "%s", target->name);
+        to->enable = target->enable;
+        to->records = __atomic_load_n(&target->stats.records, __ATOMIC_RELAXED);
+        to->bytes = __atomic_load_n(&target->stats.bytes, __ATOMIC_RELAXED);
+        to->dropped = __atomic_load_n(&target->stats.dropped, __ATOMIC_RELAXED);
+        if(target != writer){
+            to->dropped += __atomic_load_n(&writer->stats.dropped, __ATOMIC_RELAXED);
+        }
+        to->flushes = __atomic_load_n(&target->stats.flushes, __ATOMIC_RELAXED);
+        histogramRead(&to->flushLatency, &target->stats.flushLatency);
+    }
+    locker->unlock(locker);
+}
+
+/**
+ * @brief   output a log through the logger.
+ * @param   logger is pointer to the logger.
+ * @param   format is format string.
+ */
+static void _stats_log(logger_t *logger, const char *format, ...){
+    va_list args;
+
+    if(!loggerFilter(logger, STATS_TAG, LOG_LEVEL_INFO)){
+        return;
+    }
+    va_start(args, format);
+    logger->run(logger, NULL, STATS_TAG, LOG_LEVEL_INFO, format, args);
+    va_end(args);
+}
+
+/**
+ * @brief   dump a snapshot of the counters through the logger.
+ * @param   logger is pointer to the logger.
+ */
+static void _stats_dump(logger_t *logger){
+    log_stats_t stats;
+    const log_histogram_t *histogram;
+    const log_writer_stats_t *writer;
+    limiter_t *limiter;
+
+    //! the suppressed logs not reported yet are reported periodically as well.
+    limiter = __atomic_load_n(&logger->limiter, __ATOMIC_ACQUIRE);
+    if(limiter != NULL){
+        limiter->report(limiter, logger);
+    }
+    statsSnapshot(logger, &stats);
+
+    histogram = &stats.lockWait;
+    _stats_log(logger, "accepted %" PRIu64 ", filtered %" PRIu64 ", suppressed %" PRIu64 ", dropped %" PRIu64
+        ", truncated %" PRIu64 ", lock wait avg %" PRIu64 " ns, p99 <= %" PRIu64 " ns, max %" PRIu64 " ns\n",
+        stats.accepted, stats.filtered, stats.suppressed, stats.dropped, stats.truncated,
+        histogram->count ? histogram->sum / histogram->count : 0,
+        histogramPercentile(histogram, 990), histogram->max);
+
+    for(uint32_t i = 0; i < stats.numberOfClasses; ++i){
+        _stats_log(logger, "arena %" PRIu32 " bytes: used %" PRIu32 " of %" PRIu32 ", high water %" PRIu32
+            ", failures %" PRIu64 "\n", stats.arena[i].size, stats.arena[i].used, stats.arena[i].total,
+            stats.arena[i].highWater, stats.arenaFailures);
+    }
+
+    for(uint32_t i = 0; i < stats.numberOfWriters; ++i){
+        writer = &stats.writers[i];
+        histogram = &writer->flushLatency;
+        if(!writer->enable){
+            continue;
+        }
+        _stats_log(logger, "writer %s: records %" PRIu64 ", bytes %" PRIu64 ", dropped %" PRIu64
+            ", flushes %" PRIu64 ", flush avg %" PRIu64 " ns, p99 <= %" PRIu64 " ns, max %" PRIu64 " ns\n",
+            writer->name, writer->records, writer->bytes, writer->dropped, writer->flushes,
+            histogram->count ? histogram->sum / histogram->count : 0,
+            histogramPercentile(histogram, 990), histogram->max);
+    }
+}
+
+/**
+ * @brief   the reporter thread, dumps the counters every {@code interval} seconds.
+ * @param   args is pointer to reporter.
+ */
+static void *_stats_reporter(void *args){
+    statsReporter_t *reporter = (statsReporter_t *)args;
+    struct timespec deadline;
+
+    pthread_mutex_lock(&reporter->mutex);
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    while(reporter->running){
+        deadline.tv_sec += reporter->interval;
+        while(reporter->running &&
+            pthread_cond_timedwait(&reporter->wakeup, &reporter->mutex, &deadline) == 0);
+        if(!reporter->running){
+            break;
+        }
+
+        pthread_mutex_unlock(&reporter->mutex);
+        _stats_dump(reporter->logger);
+        pthread_mutex_lock(&reporter->mutex);
+    }
+    pthread_mutex_unlock(&reporter->mutex);
+    return NULL;
+}
+
+void statsReporterStart(statsReporter_t *reporter, logger_t *logger, uint32_t interval){
+    pthread_condattr_t attr;
+    int ret;
+    assert(reporter != NULL && logger != NULL);
+    assert(!reporter->running && interval > 0);
+
+    reporter->logger = logger;
+    reporter->interval = interval;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&reporter->wakeup, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&reporter->mutex, NULL);
+
+    reporter->running = true;
+    ret = pthread_create(&reporter->reporter, NULL, _stats_reporter, reporter);
+    assert(ret == 0);
+}
+
+void statsReporterStop(statsReporter_t *reporter){
+    assert(reporter != NULL);
+
+    if(!reporter->running){
+        return;
+    }
+    pthread_mutex_lock(&reporter->mutex);
+    reporter->running = false;
+    pthread_cond_signal(&reporter->wakeup);
+    pthread_mutex_unlock(&reporter->mutex);
+
+    pthread_join(reporter->reporter, NULL);
+    pthread_cond_destroy(&reporter->wakeup);
+    pthread_mutex_destroy(&reporter->mutex);
+}
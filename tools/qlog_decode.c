@@ -0,0 +1,304 @@
+/**
+ * @file    qlog_decode.c
+ * @author  qufeiyan
+ * @brief   Convert the log files of binary writer to text.
+ * @version 1.0.0
+ * @date    2026/10/18 20:41:06
+ * @version Copyright (c) 2023
+ */
+
+/* Includes --------------------------------------------------------------------------------*/
+#include "qlog_binaryWriter.h"
+#include "qlog_deferred.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//! a log is never longer than the text the logger renders it into.
+#define SIZE_OF_DECODE_BUFFER   (SIZE_OF_LOG_TEXT)
+
+static const char level_letter[] = { 'F', 'E', 'W', 'I', 'D' };
+
+/**
+ * the definitions of a segment, ids start from 1.
+ */
+struct dictionary{
+    char *formats[COUNT_OF_BINARY_FORMAT];
+    char *locations[COUNT_OF_BINARY_FORMAT];   //! location of the callsite of a format, NULL if none.
+    char *tags[COUNT_OF_BINARY_TAG];
+};
+
+/**
+ * @brief   decode an unsigned varint.
+ * @return  the size of the varint, 0 if it is truncated or too long.
+ */
+static uint32_t _decode_varint(const uint8_t *p, const uint8_t *end, uint64_t *value){
+    uint32_t size = 0;
+
+    *value = 0;
+    while(p + size < end && size < SIZE_OF_BINARY_VARINT){
+        *value |= (uint64_t)(p[size] & 0x7F) << (7 * size);
+        if((p[size++] & 0x80) == 0){
+            return size;
+        }
+    }
+    return 0;
+}
+
+static void _decode_reset(struct dictionary *dictionary){
+    for(int i = 0; i < COUNT_OF_BINARY_FORMAT; ++i){
+        free(dictionary->formats[i]);
+        free(dictionary->locations[i]);
+    }
+    for(int i = 0; i < COUNT_OF_BINARY_TAG; ++i){
+        free(dictionary->tags[i]);
+    }
+    memset(dictionary, 0, sizeof(*dictionary));
+}
+
+/**
+ * @brief   define a format string or a tag.
+ */
+static void _decode_define(char **table, uint32_t count, const uint8_t *payload, uint64_t size){
+    uint64_t id;
+    uint32_t used = _decode_varint(payload, payload + size, &id);
+
+    if(used == 0 || id == 0 || id >= count){
+        return;
+    }
+    free(table[id]);
+    table[id] = strndup((const char *)payload + used, size - used);
+}
+
+/**
+ * @brief   define the format string of a callsite with its location, the id of callsite is
+ *          skipped, as the location tells it.
+ */
+static void _decode_site(struct dictionary *dictionary, const uint8_t *payload, uint64_t size){
+    const uint8_t *p = payload, *end = payload + size, *location;
+    uint64_t id, site;
+    uint32_t used;
+
+    if((used = _decode_varint(p, end, &id)) == 0 || id == 0 || id >= COUNT_OF_BINARY_FORMAT){
+        return;
+    }
+    p += used;
+    if((used = _decode_varint(p, end, &site)) == 0){
+        return;
+    }
+    location = p + used;
+    if((p = memchr(location, '\0', end - location)) == NULL){
+        return;
+    }
+    free(dictionary->locations[id]);
+    free(dictionary->formats[id]);
+    dictionary->locations[id] = strdup((const char *)location);
+    dictionary->formats[id] = strndup((const char *)p + 1, end - p - 1);
+}
+
+/**
+ * @brief   print the prefix of a log, e.g. "10-18 20:41:06.123 I/tag: ".
+ */
+static void _decode_prefix(uint64_t time, uint8_t level, const char *tag){
+    time_t seconds = (time_t)(time / 1000000000ull);
+    struct tm tm;
+
+    localtime_r(&seconds, &tm);
+    printf("%02d-%02d %02d:%02d:%02d.%03u %c/%s: ", tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+        tm.tm_min, tm.tm_sec, (unsigned)(time / 1000000ull % 1000),
+        level < sizeof(level_letter) ? level_letter[level] : '?', tag);
+}
+
+/**
+ * @brief   print the log of a frame.
+ * @param   dictionary is the definitions of current segment.
+ * @param   type is the type of frame.
+ * @param   payload is the payload of frame.
+ * @param   size is the size of {@code payload}.
+ * @param   time is the realtime of the last log in ns.
+ * @return  false if the frame is malformed.
+ */
+static bool _decode_frame(struct dictionary *dictionary, uint8_t type, const uint8_t *payload,
+                          uint64_t size, uint64_t *time){
+    static char buffer[SIZE_OF_DECODE_BUFFER];
+    const uint8_t *p = payload, *end = payload + size;
+    uint64_t delta, tagId, formatId;
+    uint32_t used;
+    int32_t length;
+    uint8_t level;
+
+    switch(type){
+    case BINARY_FRAME_FORMAT:
+        _decode_define(dictionary->formats, COUNT_OF_BINARY_FORMAT, payload, size);
+        if(_decode_varint(payload, payload + size, &formatId) && formatId < COUNT_OF_BINARY_FORMAT){
+            free(dictionary->locations[formatId]);
+            dictionary->locations[formatId] = NULL;
+        }
+        return true;
+    case BINARY_FRAME_SITE:
+        _decode_site(dictionary, payload, size);
+        return true;
+    case BINARY_FRAME_TAG:
+        _decode_define(dictionary->tags, COUNT_OF_BINARY_TAG, payload, size);
+        return true;
+    case BINARY_FRAME_LOG:
+    case BINARY_FRAME_TEXT:
+        break;
+    default:
+        return false;
+    }
+
+    if((used = _decode_varint(p, end, &delta)) == 0 || p + used >= end){
+        return false;
+    }
+    p += used;
+    *time += (int64_t)((delta >> 1) ^ -(delta & 1));
+    level = *p++;
+
+    if(type == BINARY_FRAME_TEXT){
+        fwrite(p, 1, end - p, stdout);
+        return true;
+    }
+
+    if((used = _decode_varint(p, end, &tagId)) == 0){
+        return false;
+    }
+    p += used;
+    if((used = _decode_varint(p, end, &formatId)) == 0){
+        return false;
+    }
+    p += used;
+    if(tagId >= COUNT_OF_BINARY_TAG || dictionary->tags[tagId] == NULL ||
+        formatId >= COUNT_OF_BINARY_FORMAT || dictionary->formats[formatId] == NULL){
+        fprintf(stderr, "undefined tag %" PRIu64 " or format %" PRIu64 "\n", tagId, formatId);
+        return true;
+    }
+
+    _decode_prefix(*time, level, dictionary->tags[tagId]);
+    if(dictionary->locations[formatId] != NULL){
+        fputs(dictionary->locations[formatId], stdout);
+    }
+    length = deferredFormat(buffer, sizeof(buffer), dictionary->formats[formatId], (const char *)p, end - p);
+    fputs(buffer, stdout);
+    if(length < 0){
+        fprintf(stderr, "arguments of format %" PRIu64 " do not match it\n", formatId);
+    }else if(length >= (int32_t)sizeof(buffer)){
+        //! the end of line is cut off with the rest of the log.
+        fputc('\n', stdout);
+        fprintf(stderr, "log of format %" PRIu64 " truncated from %d to %zu bytes\n",
+            formatId, length, sizeof(buffer) - 1);
+    }
+    return true;
+}
+
+/**
+ * @brief   check the header of a segment.
+ * @return  the realtime of the segment in ns, 0 if the header is not valid.
+ */
+static uint64_t _decode_header(const char *path, const uint8_t *header, size_t size){
+    uint64_t time = 0;
+
+    if(size < SIZE_OF_BINARY_HEADER || memcmp(header, BINARY_MAGIC, 4) != 0){
+        fprintf(stderr, "%s: not a binary log file\n", path);
+        return 0;
+    }
+    if(header[4] == 0 || header[4] > BINARY_VERSION){
+        fprintf(stderr, "%s: unsupported version %u\n", path, header[4]);
+        return 0;
+    }
+    //! the raw arguments are decoded in the layout of current machine.
+    if(header[5] != ((__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) ? 1 : 2) ||
+        header[6] != sizeof(long) || header[7] != sizeof(void *) || header[8] != sizeof(size_t) ||
+        header[9] != sizeof(intmax_t) || header[10] != sizeof(ptrdiff_t) || header[11] != sizeof(long double)){
+        fprintf(stderr, "%s: written by a machine with another ABI\n", path);
+        return 0;
+    }
+    for(int i = 0; i < 8; ++i){
+        time |= (uint64_t)header[16 + i] << (8 * i);
+    }
+    return time;
+}
+
+/**
+ * @brief   print the logs of a file.
+ * @return  false if the file can not be decoded.
+ */
+static bool _decode_file(const char *path){
+    static struct dictionary dictionary;
+    const uint8_t *p, *end, *payload;
+    uint8_t *data;
+    uint64_t time, size;
+    uint32_t used;
+    long length;
+    FILE *file;
+    size_t skipped = 0;
+
+    file = fopen(path, "rb");
+    if(file == NULL){
+        perror(path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    length = ftell(file);
+    rewind(file);
+    data = (uint8_t *)malloc(length > 0 ? length : 1);
+    if(data == NULL || fread(data, 1, length, file) != (size_t)length){
+        fprintf(stderr, "%s: failed to read\n", path);
+        free(data);
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+
+    time = _decode_header(path, data, length);
+    if(time == 0){
+        free(data);
+        return false;
+    }
+
+    _decode_reset(&dictionary);
+    p = data + SIZE_OF_BINARY_HEADER;
+    end = data + length;
+    while(p < end){
+        used = _decode_varint(p + 1, end, &size);
+        payload = p + 1 + used;
+
+        //! resynchronize on the next byte if the frame is corrupted or truncated by a crash.
+        if(used == 0 || size + 4 > (uint64_t)(end - payload) ||
+            binaryCrc32(0, p, payload + size - p) != (payload[size] | payload[size + 1] << 8 |
+                payload[size + 2] << 16 | (uint32_t)payload[size + 3] << 24) ||
+            !_decode_frame(&dictionary, p[0], payload, size, &time)){
+            skipped++;
+            p++;
+            continue;
+        }
+        p = payload + size + 4;
+    }
+
+    if(skipped){
+        fprintf(stderr, "%s: %zu bytes corrupted or truncated\n", path, skipped);
+    }
+    free(data);
+    return true;
+}
+
+int main(int argc, char *argv[]){
+    int ret = 0;
+
+    if(argc < 2){
+        fprintf(stderr, "usage: %s file.qlb[.sequence]...\n", argv[0]);
+        return 2;
+    }
+    for(int i = 1; i < argc; ++i){
+        if(!_decode_file(argv[i])){
+            ret = 1;
+        }
+    }
+    fflush(stdout);
+    return ret;
+}